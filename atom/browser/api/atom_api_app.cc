@@ -4,6 +4,7 @@
 
 #include "atom/browser/api/atom_api_app.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -35,10 +36,16 @@
 #include "base/files/file_util.h"
 #include "base/memory/memory_pressure_listener.h"
 #include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
+#include "base/sys_info.h"
 #include "brave/browser/brave_content_browser_client.h"
 #include "brave/common/workers/v8_worker_thread.h"
 #include "brave/common/workers/worker_bindings.h"
+#include "brave/common/workers/worker_channel.h"
+#include "brave/common/workers/worker_message.h"
+#include "brave/common/workers/worker_pool.h"
+#include "brave/common/workers/worker_stats.h"
 #include "chrome/common/chrome_paths.h"
 #include "components/component_updater/component_updater_paths.h"
 #include "content/browser/plugin_service_impl.h"
@@ -468,9 +475,28 @@ void PassLoginInformation(scoped_refptr<LoginHandler> login_handler,
     login_handler->CancelAuth();
 }
 
+void EmitWorkerTaskDropped(App* app,
+                           int pool_id,
+                           int task_id,
+                           const std::string& error) {
+  app->Emit("worker-task-done", pool_id, task_id, error);
+}
+
+// Called on the thread that drops the task.
+void OnWorkerTaskDropped(App* app,
+                         int pool_id,
+                         int task_id,
+                         const std::string& error) {
+  content::BrowserThread::PostTask(content::BrowserThread::UI, FROM_HERE,
+      base::Bind(&EmitWorkerTaskDropped, base::Unretained(app), pool_id,
+                 task_id, error));
+}
+
 }  // namespace
 
-App::App(v8::Isolate* isolate) {
+App::App(v8::Isolate* isolate)
+    : next_worker_pool_id_(1),
+      next_worker_channel_id_(1) {
   static_cast<brave::BraveContentBrowserClient*>(
     brave::BraveContentBrowserClient::Get())->set_delegate(this);
   atom::Browser::Get()->AddObserver(this);
@@ -797,11 +823,31 @@ void App::SendMemoryPressureAlert() {
       base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL);
 }
 
-void App::PostMessage(int worker_id,
+bool App::PostMessage(int worker_id,
                       v8::Local<v8::Value> message,
                       mate::Arguments* args) {
-  if (!brave::WorkerBindings::OnMessage(isolate(), worker_id, message))
-    args->ThrowError("Eror serializing message");
+  // Report back-pressure while the queue of the worker is full.
+  auto it = worker_stats_.find(worker_id);
+  scoped_refptr<brave::WorkerStats> stats;
+  if (it != worker_stats_.end()) {
+    stats = it->second;
+    if (!stats->CanPostMessage())
+      return false;
+    // Counted before the worker can take it.
+    stats->DidPostMessage();
+  }
+
+  v8::Local<v8::Value> transfer_list;
+  args->GetNext(&transfer_list);
+  std::string error;
+  if (!brave::WorkerBindings::OnMessage(isolate(), worker_id, message,
+                                        transfer_list, &error)) {
+    if (stats)
+      stats->DidTakeMessage();
+    args->ThrowError(error);
+    return false;
+  }
+  return true;
 }
 
 void App::StopWorker(mate::Arguments* args) {
@@ -826,13 +872,207 @@ void App::StartWorker(mate::Arguments* args) {
   std::string worker_name = module_name + "_worker";
   args->GetNext(&worker_name);
 
-  auto worker = new brave::V8WorkerThread(worker_name, module_name, this);
+  // maxHeapSize is in megabytes, both limits default to none.
+  int max_heap_size = 0;
+  int max_queue_length = 0;
+  mate::Dictionary options;
+  if (args->GetNext(&options)) {
+    options.Get("maxHeapSize", &max_heap_size);
+    options.Get("maxQueueLength", &max_queue_length);
+  }
+  scoped_refptr<brave::WorkerStats> stats(new brave::WorkerStats(
+      static_cast<size_t>(std::max(max_heap_size, 0)) * 1024 * 1024,
+      static_cast<size_t>(std::max(max_queue_length, 0))));
+
+  auto worker =
+      new brave::V8WorkerThread(worker_name, module_name, this, stats);
   int worker_id = -1;
-  if (worker->Start())
+  if (worker->Start()) {
     worker_id = worker->GetThreadId();
+    worker_stats_[worker_id] = stats;
+  }
   args->Return(worker_id);
 }
 
+void App::OnWorkerStop(int worker_id) {
+  worker_stats_.erase(worker_id);
+  Emit("worker-stop", worker_id);
+}
+
+v8::Local<v8::Value> App::GetWorkerStats(int worker_id) {
+  auto it = worker_stats_.find(worker_id);
+  if (it == worker_stats_.end())
+    return v8::Null(isolate());
+  return mate::ConvertToV8(isolate(), *it->second->ToValue());
+}
+
+int App::StartWorkerPool(mate::Arguments* args) {
+  std::string module_name;
+  if (!args->GetNext(&module_name)) {
+    args->ThrowError("`module_name` is a required field");
+    return -1;
+  }
+
+  // Leave a core to the UI thread by default.
+  int size = 0;
+  args->GetNext(&size);
+  if (size <= 0)
+    size = std::max(base::SysInfo::NumberOfProcessors() - 1, 1);
+
+  int pool_id = next_worker_pool_id_++;
+  scoped_refptr<brave::WorkerPool> pool(new brave::WorkerPool(pool_id,
+      base::Bind(&OnWorkerTaskDropped, base::Unretained(this), pool_id)));
+  for (int i = 0; i < size; ++i) {
+    auto worker = new brave::V8WorkerThread(
+        module_name + "_worker_" + base::IntToString(i), module_name, this,
+        new brave::WorkerStats(0, 0));
+    // Join before the thread starts, which is the only one to touch the
+    // pool afterwards.
+    size_t index = pool->AddWorker();
+    worker->JoinPool(pool, index);
+    if (!worker->Start()) {
+      pool->RemoveWorker(index);
+      delete worker;
+    }
+  }
+  worker_pools_[pool_id] = pool;
+  return pool_id;
+}
+
+int App::PostWorkerTask(int pool_id,
+                        v8::Local<v8::Value> data,
+                        mate::Arguments* args) {
+  auto it = worker_pools_.find(pool_id);
+  if (it == worker_pools_.end()) {
+    args->ThrowError("The worker pool has been stopped");
+    return -1;
+  }
+
+  v8::Local<v8::Value> transfer_list;
+  args->GetNext(&transfer_list);
+  std::string error;
+  std::unique_ptr<brave::WorkerMessage> message =
+      brave::WorkerMessage::Serialize(isolate(), isolate()->GetCurrentContext(),
+                                      data, transfer_list, &error);
+  if (!message) {
+    args->ThrowError(error);
+    return -1;
+  }
+
+  int task_id = it->second->PostTask(std::move(message));
+  if (task_id < 0)
+    args->ThrowError("The worker pool has no workers left");
+  return task_id;
+}
+
+void App::StopWorkerPool(int pool_id) {
+  auto it = worker_pools_.find(pool_id);
+  if (it == worker_pools_.end())
+    return;
+  it->second->Close(base::Bind(&brave::V8WorkerThread::Shutdown));
+  worker_pools_.erase(it);
+}
+
+int App::CreateWorkerChannel(int worker_id, mate::Arguments* args) {
+  uint32_t capacity = 0;
+  args->GetNext(&capacity);
+  if (!capacity)
+    capacity = brave::WorkerChannel::kDefaultCapacity;
+
+  int channel_id = next_worker_channel_id_++;
+  scoped_refptr<brave::WorkerChannel> channel(
+      new brave::WorkerChannel(channel_id, capacity));
+  channel->Connect(brave::WorkerChannel::BROWSER_END,
+      content::BrowserThread::GetTaskRunnerForThread(
+          content::BrowserThread::UI),
+      base::Bind(&App::OnWorkerChannelReadable,
+                 base::Unretained(this),
+                 channel_id),
+      base::Bind(&App::OnWorkerChannelWritable,
+                 base::Unretained(this),
+                 channel_id));
+  worker_channels_[channel_id] = channel;
+
+  content::WorkerThreadRegistry::Instance()->
+      GetTaskRunnerFor(worker_id)->PostTask(
+          FROM_HERE,
+          base::Bind(&brave::V8WorkerThread::ConnectChannel, channel));
+  return channel_id;
+}
+
+bool App::SendWorkerChannelMessage(int channel_id,
+                                   v8::Local<v8::Value> message,
+                                   mate::Arguments* args) {
+  auto it = worker_channels_.find(channel_id);
+  if (it == worker_channels_.end()) {
+    args->ThrowError("The channel is closed");
+    return false;
+  }
+
+  std::string error;
+  brave::WorkerChannel::SendResult result = it->second->Send(
+      brave::WorkerChannel::BROWSER_END, isolate(), message, &error);
+  if (result == brave::WorkerChannel::SEND_FAILED)
+    args->ThrowError(error);
+  return result == brave::WorkerChannel::SENT;
+}
+
+v8::Local<v8::Value> App::ReceiveWorkerChannelMessage(int channel_id) {
+  auto it = worker_channels_.find(channel_id);
+  if (it == worker_channels_.end())
+    return v8::Undefined(isolate());
+
+  // Look at the close first, the messages sent before it are then visible.
+  bool closed = it->second->IsClosed();
+  v8::Local<v8::Value> message;
+  if (it->second->Receive(brave::WorkerChannel::BROWSER_END, isolate())
+          .ToLocal(&message))
+    return message;
+
+  // The last message has been received, emit the close from a task of its
+  // own.
+  if (closed) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE,
+        base::Bind(&App::OnWorkerChannelReadable,
+                   base::Unretained(this),
+                   channel_id));
+  }
+  return v8::Undefined(isolate());
+}
+
+void App::CloseWorkerChannel(int channel_id) {
+  // The channel goes away when the wake up for the close arrives.
+  auto it = worker_channels_.find(channel_id);
+  if (it != worker_channels_.end())
+    it->second->Close();
+}
+
+void App::OnWorkerChannelReadable(int channel_id) {
+  auto it = worker_channels_.find(channel_id);
+  if (it == worker_channels_.end())
+    return;
+
+  scoped_refptr<brave::WorkerChannel> channel = it->second;
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  Emit("worker-channel-readable", channel_id);
+  // Messages left without a listener keep the channel open until they are
+  // received.
+  if (channel->IsDrained(brave::WorkerChannel::BROWSER_END)) {
+    worker_channels_.erase(channel_id);
+    Emit("worker-channel-close", channel_id);
+  }
+}
+
+void App::OnWorkerChannelWritable(int channel_id) {
+  if (!worker_channels_.count(channel_id))
+    return;
+
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  Emit("worker-channel-drain", channel_id);
+}
+
 #if defined(OS_WIN)
 v8::Local<v8::Value> App::GetJumpListSettings() {
   JumpList jump_list(atom::Browser::Get()->GetAppUserModelID());
@@ -963,6 +1203,15 @@ void App::BuildPrototype(
       .SetMethod("_postMessage", &App::PostMessage)
       .SetMethod("_startWorker", &App::StartWorker)
       .SetMethod("stopWorker", &App::StopWorker)
+      .SetMethod("getWorkerStats", &App::GetWorkerStats)
+      .SetMethod("_startWorkerPool", &App::StartWorkerPool)
+      .SetMethod("_postWorkerTask", &App::PostWorkerTask)
+      .SetMethod("_stopWorkerPool", &App::StopWorkerPool)
+      .SetMethod("_createWorkerChannel", &App::CreateWorkerChannel)
+      .SetMethod("_sendWorkerChannelMessage", &App::SendWorkerChannelMessage)
+      .SetMethod("_receiveWorkerChannelMessage",
+                 &App::ReceiveWorkerChannelMessage)
+      .SetMethod("_closeWorkerChannel", &App::CloseWorkerChannel)
       .SetMethod("disableHardwareAcceleration",
                  &App::DisableHardwareAcceleration);
 }
@@ -5,6 +5,7 @@
 #ifndef ATOM_BROWSER_API_ATOM_API_APP_H_
 #define ATOM_BROWSER_API_ATOM_API_APP_H_
 
+#include <map>
 #include <memory>
 #include <string>
 
@@ -24,6 +25,12 @@ namespace base {
 class FilePath;
 }
 
+namespace brave {
+class WorkerChannel;
+class WorkerPool;
+class WorkerStats;
+}
+
 namespace mate {
 class Arguments;
 }  // namespace mate
@@ -55,6 +62,9 @@ class App : public AtomBrowserClient::Delegate,
                       int render_process_id,
                       int render_frame_id);
 
+  // Called when the worker |worker_id| has stopped.
+  void OnWorkerStop(int worker_id);
+
  protected:
   explicit App(v8::Isolate* isolate);
   ~App() override;
@@ -126,11 +136,26 @@ class App : public AtomBrowserClient::Delegate,
   void DisableHardwareAcceleration(mate::Arguments* args);
   bool IsAccessibilitySupportEnabled();
   void SendMemoryPressureAlert();
-  void PostMessage(int worker_id,
-                  v8::Local<v8::Value> message,
-                  mate::Arguments* args);
+  // Returns false while the inbound queue of the worker is full.
+  bool PostMessage(int worker_id,
+                   v8::Local<v8::Value> message,
+                   mate::Arguments* args);
   void StartWorker(mate::Arguments* args);
   void StopWorker(mate::Arguments* args);
+  v8::Local<v8::Value> GetWorkerStats(int worker_id);
+  int StartWorkerPool(mate::Arguments* args);
+  int PostWorkerTask(int pool_id,
+                     v8::Local<v8::Value> data,
+                     mate::Arguments* args);
+  void StopWorkerPool(int pool_id);
+  int CreateWorkerChannel(int worker_id, mate::Arguments* args);
+  bool SendWorkerChannelMessage(int channel_id,
+                                v8::Local<v8::Value> message,
+                                mate::Arguments* args);
+  v8::Local<v8::Value> ReceiveWorkerChannelMessage(int channel_id);
+  void CloseWorkerChannel(int channel_id);
+  void OnWorkerChannelReadable(int channel_id);
+  void OnWorkerChannelWritable(int channel_id);
 
 #if defined(OS_WIN)
   // Get the current Jump List settings.
@@ -144,6 +169,12 @@ class App : public AtomBrowserClient::Delegate,
 
   std::unique_ptr<ProcessSingleton> process_singleton_;
 
+  std::map<int, scoped_refptr<brave::WorkerStats>> worker_stats_;
+  std::map<int, scoped_refptr<brave::WorkerPool>> worker_pools_;
+  int next_worker_pool_id_;
+  std::map<int, scoped_refptr<brave::WorkerChannel>> worker_channels_;
+  int next_worker_channel_id_;
+
   DISALLOW_COPY_AND_ASSIGN(App);
 };
 
@@ -4,17 +4,21 @@
 
 #include "atom/browser/api/atom_api_protocol.h"
 
+#include <algorithm>
+
 #include "atom/browser/atom_browser_client.h"
 #include "atom/browser/atom_browser_main_parts.h"
 #include "atom/browser/browser.h"
 #include "atom/browser/net/url_request_buffer_job.h"
 #include "atom/browser/net/url_request_fetch_job.h"
+#include "atom/browser/net/url_request_stream_job.h"
 #include "atom/browser/net/url_request_string_job.h"
 #include "atom/common/native_mate_converters/callback.h"
 #include "atom/common/native_mate_converters/v8_value_converter.h"
 #include "atom/common/native_mate_converters/value_converter.h"
 #include "atom/common/node_includes.h"
 #include "atom/common/options_switches.h"
+#include "base/bind_helpers.h"
 #include "base/command_line.h"
 #include "base/strings/string_util.h"
 #include "chrome/browser/custom_handlers/protocol_handler_registry.h"
@@ -75,6 +79,7 @@ Protocol::Protocol(v8::Isolate* isolate, Profile* profile)
     : profile_(profile),
       request_context_getter_(static_cast<brightray::URLRequestContextGetter*>(
           profile->GetRequestContext())),
+      response_cache_(new ProtocolResponseCache),
       weak_factory_(this) {
   Init(isolate);
 }
@@ -97,7 +102,7 @@ void Protocol::RegisterProtocol(const std::string& scheme,
   content::BrowserThread::PostTaskAndReplyWithResult(
       content::BrowserThread::IO, FROM_HERE,
       base::Bind(&Protocol::RegisterProtocolInIO<RequestJob>,
-          request_context_getter_,
+          request_context_getter_, response_cache_,
           isolate(), scheme, handler),
       base::Bind(&Protocol::OnIOCompleted,
                  GetWeakPtr(), callback));
@@ -107,6 +112,7 @@ void Protocol::RegisterProtocol(const std::string& scheme,
 template<typename RequestJob>
 Protocol::ProtocolError Protocol::RegisterProtocolInIO(
     scoped_refptr<brightray::URLRequestContextGetter> request_context_getter,
+    scoped_refptr<ProtocolResponseCache> response_cache,
     v8::Isolate* isolate,
     const std::string& scheme,
     const Handler& handler) {
@@ -114,9 +120,12 @@ Protocol::ProtocolError Protocol::RegisterProtocolInIO(
       request_context_getter->job_factory());
   if (job_factory->IsHandledProtocol(scheme))
     return PROTOCOL_REGISTERED;
+  // Responses of an earlier handler of the scheme must not be served.
+  response_cache->Invalidate(scheme + ":");
   std::unique_ptr<CustomProtocolHandler<RequestJob>> protocol_handler(
       new CustomProtocolHandler<RequestJob>(
-          isolate, request_context_getter.get(), handler));
+          isolate, request_context_getter.get(), handler,
+          response_cache.get()));
   if (job_factory->SetProtocolHandler(scheme, std::move(protocol_handler)))
     return PROTOCOL_OK;
   else
@@ -130,7 +139,7 @@ void Protocol::UnregisterProtocol(
   content::BrowserThread::PostTaskAndReplyWithResult(
       content::BrowserThread::IO, FROM_HERE,
       base::Bind(&Protocol::UnregisterProtocolInIO,
-          request_context_getter_, scheme),
+          request_context_getter_, response_cache_, scheme),
       base::Bind(&Protocol::OnIOCompleted,
                  GetWeakPtr(), callback));
 }
@@ -138,15 +147,36 @@ void Protocol::UnregisterProtocol(
 // static
 Protocol::ProtocolError Protocol::UnregisterProtocolInIO(
     scoped_refptr<brightray::URLRequestContextGetter> request_context_getter,
+    scoped_refptr<ProtocolResponseCache> response_cache,
     const std::string& scheme) {
   auto job_factory = static_cast<net::URLRequestJobFactoryImpl*>(
       request_context_getter->job_factory());
   if (!job_factory->IsHandledProtocol(scheme))
     return PROTOCOL_NOT_REGISTERED;
   job_factory->SetProtocolHandler(scheme, nullptr);
+  response_cache->Invalidate(scheme + ":");
   return PROTOCOL_OK;
 }
 
+void Protocol::InvalidateResponseCache(mate::Arguments* args) {
+  std::string prefix;
+  args->GetNext(&prefix);
+  base::Closure callback;
+  if (!args->GetNext(&callback))
+    callback = base::Bind(&base::DoNothing);
+  content::BrowserThread::PostTaskAndReply(
+      content::BrowserThread::IO, FROM_HERE,
+      base::Bind(&ProtocolResponseCache::Invalidate, response_cache_, prefix),
+      callback);
+}
+
+void Protocol::SetResponseCacheSize(double size) {
+  content::BrowserThread::PostTask(
+      content::BrowserThread::IO, FROM_HERE,
+      base::Bind(&ProtocolResponseCache::SetMaxSize, response_cache_,
+                 static_cast<size_t>(std::max(size, 0.0))));
+}
+
 void Protocol::IsProtocolHandled(const std::string& scheme,
                                  const BooleanCallback& callback) {
   content::BrowserThread::PostTaskAndReplyWithResult(
@@ -261,7 +291,12 @@ void Protocol::BuildPrototype(
                  &Protocol::RegisterProtocol<URLRequestBufferJob>)
       .SetMethod("registerHttpProtocol",
                  &Protocol::RegisterProtocol<URLRequestFetchJob>)
+      .SetMethod("registerStreamProtocol",
+                 &Protocol::RegisterProtocol<URLRequestStreamJob>)
       .SetMethod("unregisterProtocol", &Protocol::UnregisterProtocol)
+      .SetMethod("invalidateResponseCache",
+                 &Protocol::InvalidateResponseCache)
+      .SetMethod("setResponseCacheSize", &Protocol::SetResponseCacheSize)
       .SetMethod("isProtocolHandled", &Protocol::IsProtocolHandled)
       .SetMethod("isNavigatorProtocolHandled",
                  &Protocol::IsNavigatorProtocolHandled)
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "atom/browser/api/trackable_object.h"
+#include "atom/browser/net/protocol_response_cache.h"
 #include "base/callback.h"
 #include "base/memory/weak_ptr.h"
 #include "chrome/common/custom_handlers/protocol_handler.h"
@@ -84,17 +85,20 @@ class Protocol : public mate::TrackableObject<Protocol> {
     CustomProtocolHandler(
         v8::Isolate* isolate,
         net::URLRequestContextGetter* request_context,
-        const Handler& handler)
+        const Handler& handler,
+        ProtocolResponseCache* response_cache)
         : isolate_(isolate),
           request_context_(request_context),
-          handler_(handler) {}
+          handler_(handler),
+          response_cache_(response_cache) {}
     ~CustomProtocolHandler() override {}
 
     net::URLRequestJob* MaybeCreateJob(
         net::URLRequest* request,
         net::NetworkDelegate* network_delegate) const override {
       RequestJob* request_job = new RequestJob(request, network_delegate);
-      request_job->SetHandlerInfo(isolate_, request_context_.get(), handler_);
+      request_job->SetHandlerInfo(isolate_, request_context_.get(), handler_,
+                                  response_cache_.get());
       return request_job;
     }
 
@@ -102,6 +106,7 @@ class Protocol : public mate::TrackableObject<Protocol> {
     v8::Isolate* isolate_;
     scoped_refptr<net::URLRequestContextGetter> request_context_;
     Protocol::Handler handler_;
+    scoped_refptr<ProtocolResponseCache> response_cache_;
 
     DISALLOW_COPY_AND_ASSIGN(CustomProtocolHandler);
   };
@@ -118,6 +123,7 @@ class Protocol : public mate::TrackableObject<Protocol> {
   template<typename RequestJob>
   static ProtocolError RegisterProtocolInIO(
       scoped_refptr<brightray::URLRequestContextGetter> request_context_getter,
+      scoped_refptr<ProtocolResponseCache> response_cache,
       v8::Isolate* isolate,
       const std::string& scheme,
       const Handler& handler);
@@ -126,8 +132,15 @@ class Protocol : public mate::TrackableObject<Protocol> {
   void UnregisterProtocol(const std::string& scheme, mate::Arguments* args);
   static ProtocolError UnregisterProtocolInIO(
       scoped_refptr<brightray::URLRequestContextGetter> request_context_getter,
+      scoped_refptr<ProtocolResponseCache> response_cache,
       const std::string& scheme);
 
+  // Drop the cached responses whose url starts with the prefix, or all of
+  // them.
+  void InvalidateResponseCache(mate::Arguments* args);
+  // Set the size cap of the cached responses in bytes.
+  void SetResponseCacheSize(double size);
+
   // Whether the protocol has handler registered.
   void IsProtocolHandled(const std::string& scheme,
                          const BooleanCallback& callback);
@@ -154,6 +167,7 @@ class Protocol : public mate::TrackableObject<Protocol> {
 
   Profile* profile_;  // not owned
   scoped_refptr<brightray::URLRequestContextGetter> request_context_getter_;
+  scoped_refptr<ProtocolResponseCache> response_cache_;
   base::WeakPtrFactory<Protocol> weak_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(Protocol);
@@ -4,17 +4,26 @@
 
 #include "atom/browser/api/atom_api_web_request.h"
 
+#include <algorithm>
+
 #include "atom/browser/net/atom_network_delegate.h"
+#include "atom/browser/net/fetch_response_writer.h"
+#include "atom/browser/net/web_request_rules.h"
 #include "atom/common/native_mate_converters/callback.h"
 #include "atom/common/native_mate_converters/file_path_converter.h"
 #include "atom/common/native_mate_converters/gurl_converter.h"
 #include "atom/common/native_mate_converters/net_converter.h"
 #include "base/files/file_path.h"
+#include "base/macros.h"
 #include "chrome/browser/profiles/profile.h"
 #include "content/public/browser/browser_thread.h"
 #include "extensions/features/features.h"
 #include "native_mate/dictionary.h"
 #include "native_mate/object_template_builder.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_response_headers.h"
 #include "net/url_request/url_request_context.h"
 #include "v8/include/v8.h"
 
@@ -22,10 +31,98 @@
 #include "extensions/browser/api/web_request/web_request_api_helpers.h"
 #endif
 
+#include "atom/common/node_includes.h"
+
 using content::BrowserThread;
 
+namespace {
+
+v8::Local<v8::String> ToOneByteString(v8::Isolate* isolate,
+                                      const std::string& value) {
+  return v8::String::NewFromOneByte(
+      isolate, reinterpret_cast<const uint8_t*>(value.data()),
+      v8::NewStringType::kNormal, value.size()).ToLocalChecked();
+}
+
+std::string FromOneByteString(v8::Local<v8::Value> value) {
+  v8::Local<v8::String> str = value.As<v8::String>();
+  std::string result(str->Length(), '\0');
+  str->WriteOneByte(reinterpret_cast<uint8_t*>(&result[0]));
+  return result;
+}
+
+// Converts the serialized request headers of a details object on first
+// access.
+void GetRequestHeaders(v8::Local<v8::Name> name,
+                       const v8::PropertyCallbackInfo<v8::Value>& info) {
+  net::HttpRequestHeaders headers;
+  headers.AddHeadersFromString(FromOneByteString(info.Data()));
+
+  base::DictionaryValue dict;
+  net::HttpRequestHeaders::Iterator it(headers);
+  while (it.GetNext())
+    dict.SetKey(it.name(), base::Value(it.value()));
+  info.GetReturnValue().Set(mate::ConvertToV8(info.GetIsolate(), dict));
+}
+
+// Converts the raw response headers of a details object on first access.
+void GetResponseHeaders(v8::Local<v8::Name> name,
+                        const v8::PropertyCallbackInfo<v8::Value>& info) {
+  scoped_refptr<net::HttpResponseHeaders> headers(
+      new net::HttpResponseHeaders(FromOneByteString(info.Data())));
+
+  base::DictionaryValue dict;
+  size_t iter = 0;
+  std::string key;
+  std::string value;
+  while (headers->EnumerateHeaderLines(&iter, &key, &value)) {
+    base::ListValue* values = nullptr;
+    if (!dict.GetList(key, &values)) {
+      std::unique_ptr<base::ListValue> list(new base::ListValue);
+      values = list.get();
+      dict.Set(key, std::move(list));
+    }
+    values->AppendString(value);
+  }
+  info.GetReturnValue().Set(mate::ConvertToV8(info.GetIsolate(), dict));
+}
+
+}  // namespace
+
 namespace mate {
 
+template<>
+struct Converter<atom::WebRequestDetails> {
+  static v8::Local<v8::Value> ToV8(v8::Isolate* isolate,
+                                   const atom::WebRequestDetails& details) {
+    v8::Local<v8::Object> object =
+        ConvertToV8(isolate, details.values).As<v8::Object>();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    if (details.has_request_headers) {
+      ignore_result(object->SetLazyDataProperty(
+          context, StringToV8(isolate, "requestHeaders"), GetRequestHeaders,
+          ToOneByteString(isolate, details.request_headers)));
+    }
+    if (details.has_response_headers) {
+      ignore_result(object->SetLazyDataProperty(
+          context, StringToV8(isolate, "responseHeaders"), GetResponseHeaders,
+          ToOneByteString(isolate, details.response_headers)));
+    }
+    return object;
+  }
+};
+
+template<>
+struct Converter<atom::WebRequestDetailsList> {
+  static v8::Local<v8::Value> ToV8(v8::Isolate* isolate,
+                                   const atom::WebRequestDetailsList& list) {
+    v8::Local<v8::Array> result = v8::Array::New(isolate, list.size());
+    for (size_t i = 0; i < list.size(); ++i)
+      result->Set(static_cast<uint32_t>(i), ConvertToV8(isolate, *list[i]));
+    return result;
+  }
+};
+
 template<>
 struct Converter<URLPattern> {
   static bool FromV8(v8::Isolate* isolate, v8::Local<v8::Value> val,
@@ -58,62 +155,312 @@ struct Converter<net::URLFetcher::RequestType> {
   }
 };
 
+template<>
+struct Converter<atom::FetchScheduler::Priority> {
+  static bool FromV8(v8::Isolate* isolate, v8::Local<v8::Value> val,
+                     atom::FetchScheduler::Priority* out) {
+    std::string priority;
+    if (!ConvertFromV8(isolate, val, &priority))
+      return false;
+    if (priority == "high")
+      *out = atom::FetchScheduler::PRIORITY_HIGH;
+    else if (priority == "medium")
+      *out = atom::FetchScheduler::PRIORITY_MEDIUM;
+    else if (priority == "low")
+      *out = atom::FetchScheduler::PRIORITY_LOW;
+    else if (priority == "idle")
+      *out = atom::FetchScheduler::PRIORITY_IDLE;
+    else
+      return false;
+    return true;
+  }
+};
+
 }  // namespace mate
 
 namespace atom {
 
 namespace api {
 
+namespace {
+
+// The defaults of the batch option of listeners.
+const int kDefaultBatchIntervalMs = 100;
+const int kDefaultBatchMaxSize = 1000;
+
+// The fetches running at once. The limit per host is below the 6 connections
+// Chromium opens to a host, so that fetches leave some to page loads.
+const size_t kMaxFetchesPerHost = 4;
+const size_t kMaxFetches = 16;
+
+// The optional filter passed before a listener.
+struct ListenerFilter {
+  ListenerFilter() : fields(WebRequestDetails::kAllFields), batched(false) {
+    batch.interval = base::TimeDelta::FromMilliseconds(kDefaultBatchIntervalMs);
+    batch.max_size = kDefaultBatchMaxSize;
+    timeout.cancel = false;
+  }
+
+  URLPatterns patterns;
+  uint32_t fields;
+  bool batched;
+  AtomNetworkDelegate::BatchOptions batch;
+  AtomNetworkDelegate::TimeoutOptions timeout;
+};
+
+// Reads { urls, fields, batch, timeout, timeoutAction } when it is passed,
+// throws and returns false when it is invalid.
+bool GetListenerFilter(mate::Arguments* args, ListenerFilter* filter) {
+  mate::Dictionary dict;
+  if (!args->GetNext(&dict))
+    return true;
+
+  dict.Get("urls", &filter->patterns);
+
+  std::vector<std::string> field_names;
+  if (dict.Get("fields", &field_names)) {
+    filter->fields = 0;
+    for (const auto& name : field_names) {
+      WebRequestDetails::Field field;
+      if (!WebRequestDetails::GetField(name, &field)) {
+        args->ThrowError("Unknown details field " + name);
+        return false;
+      }
+      filter->fields |= field;
+    }
+  }
+
+  // { interval, maxSize }.
+  mate::Dictionary batch;
+  if (dict.Get("batch", &batch)) {
+    int interval = kDefaultBatchIntervalMs;
+    int max_size = kDefaultBatchMaxSize;
+    batch.Get("interval", &interval);
+    batch.Get("maxSize", &max_size);
+    if (interval < 0 || max_size <= 0) {
+      args->ThrowError("Invalid batch options");
+      return false;
+    }
+    filter->batched = true;
+    filter->batch.interval = base::TimeDelta::FromMilliseconds(interval);
+    filter->batch.max_size = static_cast<size_t>(max_size);
+  }
+
+  int timeout = 0;
+  std::string action = "continue";
+  dict.Get("timeout", &timeout);
+  dict.Get("timeoutAction", &action);
+  if (timeout < 0 || (action != "continue" && action != "cancel")) {
+    args->ThrowError("Invalid timeout options");
+    return false;
+  }
+  filter->timeout.timeout = base::TimeDelta::FromMilliseconds(timeout);
+  filter->timeout.cancel = action == "cancel";
+  return true;
+}
+
+// Reads a Function, or null which leaves |listener| null.
+template<typename Listener>
+bool GetListener(mate::Arguments* args, Listener* listener) {
+  v8::Local<v8::Value> value;
+  if (!args->GetNext(listener) &&
+      !(args->GetNext(&value) && value->IsNull())) {
+    args->ThrowError("Must pass null or a Function");
+    return false;
+  }
+  return true;
+}
+
+AtomNetworkDelegate* GetNetworkDelegate(
+    const scoped_refptr<net::URLRequestContextGetter>& getter) {
+  return static_cast<AtomNetworkDelegate*>(
+      getter->GetURLRequestContext()->network_delegate());
+}
+
+void SetSimpleListenerOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    AtomNetworkDelegate::SimpleEvent type,
+    const ListenerFilter& filter,
+    const AtomNetworkDelegate::SimpleListener& listener) {
+  GetNetworkDelegate(getter)->SetSimpleListenerInIO(
+      type, filter.patterns, filter.fields, listener);
+}
+
+void SetBatchListenerOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    AtomNetworkDelegate::SimpleEvent type,
+    const ListenerFilter& filter,
+    const AtomNetworkDelegate::BatchListener& listener) {
+  GetNetworkDelegate(getter)->SetBatchListenerInIO(
+      type, filter.patterns, filter.fields, filter.batch, listener);
+}
+
+void SetResponseListenerOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    AtomNetworkDelegate::ResponseEvent type,
+    const ListenerFilter& filter,
+    const AtomNetworkDelegate::ResponseListener& listener) {
+  GetNetworkDelegate(getter)->SetResponseListenerInIO(
+      type, filter.patterns, filter.fields, filter.timeout, listener);
+}
+
+std::unique_ptr<base::DictionaryValue> GetStatsOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter) {
+  return GetNetworkDelegate(getter)->GetStatsInIO();
+}
+
+void OnGetStats(
+    const base::Callback<void(const base::DictionaryValue&)>& callback,
+    std::unique_ptr<base::DictionaryValue> stats) {
+  callback.Run(*stats);
+}
+
+void FreeString(char* data, void* hint) {
+  delete static_cast<std::string*>(hint);
+}
+
+// Wraps |str| in a Buffer without copying it.
+v8::Local<v8::Value> StringToBuffer(v8::Isolate* isolate,
+                                    std::unique_ptr<std::string> str) {
+  if (str->empty())
+    return node::Buffer::New(isolate, 0).ToLocalChecked();
+  char* data = &(*str)[0];
+  size_t length = str->size();
+  return node::Buffer::New(
+      isolate, data, length, &FreeString, str.release()).ToLocalChecked();
+}
+
+void SetRulesOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    std::unique_ptr<WebRequestRules> rules) {
+  GetNetworkDelegate(getter)->SetRulesInIO(std::move(rules));
+}
+
+}  // namespace
+
 WebRequest::WebRequest(v8::Isolate* isolate,
                        Profile* profile)
-    : profile_(profile) {
+    : profile_(profile),
+      scheduler_(kMaxFetchesPerHost, kMaxFetches),
+      next_fetch_id_(1),
+      weak_factory_(this) {
   Init(isolate);
 }
 
+WebRequest::PendingFetch::PendingFetch()
+    : id(0),
+      writer(nullptr) {
+}
+
+WebRequest::PendingFetch::~PendingFetch() {
+}
+
 WebRequest::~WebRequest() {
   fetchers_.clear();
 }
 
 void WebRequest::OnURLFetchComplete(
     const net::URLFetcher* source) {
-  FetchCallback callback = fetchers_[source];
-  fetchers_.erase(source);
+  auto it = fetchers_.find(source);
+  if (it == fetchers_.end())
+    return;
+  std::unique_ptr<PendingFetch> fetch = std::move(it->second);
+  fetchers_.erase(it);
+  for (const auto& waiter : fetch->waiters)
+    fetch_ids_.erase(waiter.id);
+  if (!fetch->share_key.empty())
+    shared_fetches_.erase(fetch->share_key);
+  scheduler_.Remove(fetch->id);
 
-  mate::Dictionary response = mate::Dictionary::CreateEmpty(isolate());
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
   int response_code = source->GetResponseCode();
-  response.Set("statusCode", response_code);
-
-  std::string body;
-  v8::Local<v8::Value> err = v8::Null(isolate());
-  if (response_code == net::URLFetcher::ResponseCode::RESPONSE_CODE_INVALID ||
-      !source->GetStatus().is_success()) {
-    base::DictionaryValue dict;
-    dict.SetInteger("errorCode", source->GetStatus().error());
-    err = mate::ConvertToV8(isolate(), dict);
-  } else {
-    const net::HttpResponseHeaders* headers = source->GetResponseHeaders();
-    response.Set("headers", headers);
-    source->GetResponseAsString(&body);
+  bool success =
+      response_code != net::URLFetcher::ResponseCode::RESPONSE_CODE_INVALID &&
+      source->GetStatus().is_success();
+
+  std::unique_ptr<std::string> data;
+  if (fetch->writer)
+    data = fetch->writer->TakeBody();
+  if (!success)
+    data.reset(new std::string);
+
+  for (size_t i = 0; i < fetch->waiters.size(); ++i) {
+    const FetchWaiter& waiter = fetch->waiters[i];
+    mate::Dictionary response = mate::Dictionary::CreateEmpty(isolate());
+    response.Set("statusCode", response_code);
+
+    v8::Local<v8::Value> err = v8::Null(isolate());
+    if (!success) {
+      base::DictionaryValue dict;
+      dict.SetInteger("errorCode", source->GetStatus().error());
+      err = mate::ConvertToV8(isolate(), dict);
+    } else {
+      const net::HttpResponseHeaders* headers = source->GetResponseHeaders();
+      response.Set("headers", headers);
+    }
+
+    // error, response, body
+    v8::Local<v8::Value> body = v8::Null(isolate());
+    switch (waiter.response_type) {
+      case FETCH_RESPONSE_TEXT:
+        body = v8::String::NewFromOneByte(
+            isolate(), reinterpret_cast<const uint8_t*>(data->data()),
+            v8::NewStringType::kNormal, data->size()).ToLocalChecked();
+        break;
+      case FETCH_RESPONSE_BUFFER:
+        if (!success)
+          break;
+        // Only the last waiter can take the body without copying it.
+        if (i + 1 == fetch->waiters.size())
+          body = StringToBuffer(isolate(), std::move(data));
+        else
+          body = node::Buffer::Copy(
+              isolate(), data->data(), data->size()).ToLocalChecked();
+        break;
+      case FETCH_RESPONSE_FILE:
+        body = v8::String::Empty(isolate());
+        break;
+      case FETCH_RESPONSE_STREAM:
+        break;
+    }
+    waiter.callback.Run(err, response, body);
   }
+}
 
-  // error, response, body
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(body.c_str());
-  callback.Run(err, response, v8::String::NewFromOneByte(isolate(),
-      data, v8::NewStringType::kNormal, body.length()).ToLocalChecked());
+void WebRequest::FailFetch(const FetchWaiter& waiter, int net_error) {
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  mate::Dictionary response = mate::Dictionary::CreateEmpty(isolate());
+  response.Set("statusCode",
+               static_cast<int>(
+                   net::URLFetcher::ResponseCode::RESPONSE_CODE_INVALID));
+  base::DictionaryValue dict;
+  dict.SetInteger("errorCode", net_error);
+  v8::Local<v8::Value> body = v8::Null(isolate());
+  if (waiter.response_type == FETCH_RESPONSE_TEXT ||
+      waiter.response_type == FETCH_RESPONSE_FILE)
+    body = v8::String::Empty(isolate());
+  waiter.callback.Run(mate::ConvertToV8(isolate(), dict), response, body);
 }
 
-void WebRequest::Fetch(mate::Arguments* args) {
+int WebRequest::Fetch(mate::Arguments* args) {
   GURL url;
   if (!args->GetNext(&url) || !url.is_valid()) {
     args->ThrowError("invalid url parameter");
-    return;
+    return 0;
   }
 
+  FetchWaiter waiter;
+  waiter.id = 0;
+  waiter.response_type = FETCH_RESPONSE_TEXT;
+  FetchScheduler::Priority priority = FetchScheduler::PRIORITY_MEDIUM;
   net::URLFetcher::RequestType request_type = net::URLFetcher::RequestType::GET;
   net::HttpRequestHeaders headers;
   base::FilePath path;
   std::string payload;
   std::string payload_content_type;
+  base::Callback<void(v8::Local<v8::Value>)> on_data;
   mate::Dictionary dict;
   if (args->GetNext(&dict)) {
     dict.Get("method", &request_type);
@@ -122,76 +469,232 @@ void WebRequest::Fetch(mate::Arguments* args) {
     if (dict.Get("payload", &payload)) {
       if (!dict.Get("payload_content_type", &payload_content_type)) {
         args->ThrowError("payload_content_type is required for payload");
+        return 0;
+      }
+    }
+
+    std::string response_type;
+    if (dict.Get("responseType", &response_type)) {
+      if (response_type == "buffer") {
+        waiter.response_type = FETCH_RESPONSE_BUFFER;
+      } else if (response_type != "text") {
+        args->ThrowError("responseType must be 'text' or 'buffer'");
+        return 0;
+      }
+    }
+
+    if (dict.Has("onData")) {
+      if (!dict.Get("onData", &on_data)) {
+        args->ThrowError("onData must be a Function");
+        return 0;
       }
+      waiter.response_type = FETCH_RESPONSE_STREAM;
+    }
+
+    if (dict.Has("priority") && !dict.Get("priority", &priority)) {
+      args->ThrowError(
+          "priority must be 'high', 'medium', 'low' or 'idle'");
+      return 0;
+    }
+  }
+
+  if (!path.empty()) {
+    if (waiter.response_type != FETCH_RESPONSE_TEXT) {
+      args->ThrowError("path can not be used with responseType or onData");
+      return 0;
     }
+    waiter.response_type = FETCH_RESPONSE_FILE;
   }
 
-  FetchCallback callback;
-  if (!args->GetNext(&callback)) {
+  if (!args->GetNext(&waiter.callback)) {
     args->ThrowError("invalid callback parameter");
-    return;
+    return 0;
   }
 
-  net::URLFetcher* fetcher = net::URLFetcher::Create(url, request_type, this)
-      .release();
+  waiter.id = next_fetch_id_++;
+
+  // Identical GETs whose body is returned to the callback share one fetch.
+  std::string share_key;
+  if (request_type == net::URLFetcher::RequestType::GET &&
+      (waiter.response_type == FETCH_RESPONSE_TEXT ||
+       waiter.response_type == FETCH_RESPONSE_BUFFER)) {
+    share_key = url.spec() + '\n' + headers.ToString();
+    auto shared = shared_fetches_.find(share_key);
+    if (shared != shared_fetches_.end()) {
+      PendingFetch* fetch = fetchers_[shared->second].get();
+      scheduler_.Prioritize(fetch->id, priority);
+      fetch->waiters.push_back(waiter);
+      fetch_ids_[waiter.id] = shared->second;
+      return waiter.id;
+    }
+  }
+
+  auto fetch = std::make_unique<PendingFetch>();
+  fetch->id = waiter.id;
+  fetch->share_key = share_key;
+  fetch->fetcher = net::URLFetcher::Create(url, request_type, this);
+  net::URLFetcher* fetcher = fetch->fetcher.get();
   fetcher->SetRequestContext(profile_->GetRequestContext());
   if (!payload.empty())
     fetcher->SetUploadData(payload_content_type, payload);
   if (!headers.IsEmpty())
     fetcher->SetExtraRequestHeaders(headers.ToString());
-  if (!path.empty())
+  if (waiter.response_type == FETCH_RESPONSE_FILE) {
     fetcher->SaveResponseToFileAtPath(
         path,
         BrowserThread::GetTaskRunnerForThread(BrowserThread::FILE));
-  fetcher->Start();
-  fetchers_[fetcher] = FetchCallback(callback);
+  } else {
+    std::unique_ptr<FetchResponseWriter> writer;
+    if (waiter.response_type == FETCH_RESPONSE_STREAM)
+      writer.reset(new FetchResponseWriter(
+          base::Bind(&WebRequest::OnFetchData, weak_factory_.GetWeakPtr(),
+                     waiter.id, on_data)));
+    else
+      writer.reset(new FetchResponseWriter);
+    fetch->writer = writer.get();
+    fetcher->SaveResponseWithWriter(std::move(writer));
+  }
+  fetch->waiters.push_back(waiter);
+
+  fetchers_[fetcher] = std::move(fetch);
+  fetch_ids_[waiter.id] = fetcher;
+  if (!share_key.empty())
+    shared_fetches_[share_key] = fetcher;
+  scheduler_.Add(waiter.id, net::HostPortPair::FromURL(url).ToString(),
+                 priority,
+                 base::Bind(&net::URLFetcher::Start,
+                            base::Unretained(fetcher)));
+  return waiter.id;
+}
+
+// static
+void WebRequest::OnFetchData(
+    base::WeakPtr<WebRequest> web_request,
+    int id,
+    const base::Callback<void(v8::Local<v8::Value>)>& on_data,
+    std::unique_ptr<std::string> chunk,
+    const base::Closure& done) {
+  // Chunks still queued when the fetch is cancelled are dropped, but count
+  // as consumed.
+  if (web_request && web_request->fetch_ids_.count(id)) {
+    v8::Isolate* isolate = web_request->isolate();
+    v8::Locker locker(isolate);
+    v8::HandleScope handle_scope(isolate);
+    on_data.Run(StringToBuffer(isolate, std::move(chunk)));
+  }
+  done.Run();
+}
+
+bool WebRequest::CancelFetch(int id) {
+  auto it = fetch_ids_.find(id);
+  if (it == fetch_ids_.end())
+    return false;
+  const net::URLFetcher* fetcher = it->second;
+  fetch_ids_.erase(it);
+
+  PendingFetch* fetch = fetchers_[fetcher].get();
+  auto waiter = std::find_if(
+      fetch->waiters.begin(), fetch->waiters.end(),
+      [id](const FetchWaiter& waiter) { return waiter.id == id; });
+  FetchWaiter cancelled = *waiter;
+  fetch->waiters.erase(waiter);
+
+  // Stop the fetch once nobody waits on it.
+  if (fetch->waiters.empty()) {
+    scheduler_.Remove(fetch->id);
+    if (!fetch->share_key.empty())
+      shared_fetches_.erase(fetch->share_key);
+    fetchers_.erase(fetcher);
+  }
+
+  FailFetch(cancelled, net::ERR_ABORTED);
+  return true;
 }
 
 template<AtomNetworkDelegate::SimpleEvent type>
 void WebRequest::SetSimpleListener(mate::Arguments* args) {
-  SetListener<AtomNetworkDelegate::SimpleListener>(
-      &AtomNetworkDelegate::SetSimpleListenerInIO, type, args);
+  ListenerFilter filter;
+  if (!GetListenerFilter(args, &filter))
+    return;
+  if (!filter.timeout.timeout.is_zero()) {
+    args->ThrowError("Only blocking events can time out");
+    return;
+  }
+
+  scoped_refptr<net::URLRequestContextGetter> getter(
+      profile_->GetRequestContext());
+  if (filter.batched) {
+    AtomNetworkDelegate::BatchListener listener;
+    if (!args->GetNext(&listener)) {
+      args->ThrowError("Must pass a Function");
+      return;
+    }
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+        base::Bind(&SetBatchListenerOnIOThread, getter, type, filter,
+                   listener));
+    return;
+  }
+
+  AtomNetworkDelegate::SimpleListener listener;
+  if (!GetListener(args, &listener))
+    return;
+  BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+      base::Bind(&SetSimpleListenerOnIOThread, getter, type, filter,
+                 listener));
 }
 
 template<AtomNetworkDelegate::ResponseEvent type>
 void WebRequest::SetResponseListener(mate::Arguments* args) {
-  SetListener<AtomNetworkDelegate::ResponseListener>(
-      &AtomNetworkDelegate::SetResponseListenerInIO, type, args);
-}
+  ListenerFilter filter;
+  if (!GetListenerFilter(args, &filter))
+    return;
+  if (filter.batched) {
+    args->ThrowError("Only non-blocking events can be batched");
+    return;
+  }
 
-template<typename Listener, typename Method, typename Event>
-void WebRequest::SetListenerOnIOThread(
-    const scoped_refptr<net::URLRequestContextGetter>& getter,
-    Method method, Event type, URLPatterns patterns, Listener listener) {
-  auto delegate = static_cast<AtomNetworkDelegate*>(
-      getter->GetURLRequestContext()->network_delegate());
+  AtomNetworkDelegate::ResponseListener listener;
+  if (!GetListener(args, &listener))
+    return;
   BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
-                            base::Bind(method, base::Unretained(delegate),
-                            type, patterns, listener));
+      base::Bind(&SetResponseListenerOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext()),
+                 type, filter, listener));
 }
 
-template<typename Listener, typename Method, typename Event>
-void WebRequest::SetListener(Method method, Event type, mate::Arguments* args) {
-  // { urls }.
-  URLPatterns patterns;
-  mate::Dictionary dict;
-  args->GetNext(&dict) && dict.Get("urls", &patterns);
-
-  // Function or null.
+void WebRequest::SetRules(mate::Arguments* args) {
+  // Array of rules or null.
+  base::ListValue list;
   v8::Local<v8::Value> value;
-  Listener listener;
-  if (!args->GetNext(&listener) &&
-      !(args->GetNext(&value) && value->IsNull())) {
-    args->ThrowError("Must pass null or a Function");
+  std::unique_ptr<WebRequestRules> rules;
+  if (args->GetNext(&list)) {
+    std::string error;
+    rules = WebRequestRules::Create(list, &error);
+    if (!rules) {
+      args->ThrowError(error);
+      return;
+    }
+  } else if (!(args->GetNext(&value) && value->IsNull())) {
+    args->ThrowError("Must pass null or an Array of rules");
     return;
   }
 
   BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
-      base::Bind(&WebRequest::SetListenerOnIOThread<Listener, Method, Event>,
-        base::Unretained(this),
-        scoped_refptr<net::URLRequestContextGetter>(
-          profile_->GetRequestContext()),
-          method, type, patterns, listener));
+      base::Bind(&SetRulesOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext()),
+                 base::Passed(&rules)));
+}
+
+void WebRequest::GetStats(
+    const base::Callback<void(const base::DictionaryValue&)>& callback) {
+  BrowserThread::PostTaskAndReplyWithResult(
+      BrowserThread::IO, FROM_HERE,
+      base::Bind(&GetStatsOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext())),
+      base::Bind(&OnGetStats, callback));
 }
 
 void WebRequest::HandleBehaviorChanged() {
@@ -238,10 +741,16 @@ void WebRequest::BuildPrototype(v8::Isolate* isolate,
       .SetMethod("onErrorOccurred",
                  &WebRequest::SetSimpleListener<
                     AtomNetworkDelegate::kOnErrorOccurred>)
+      .SetMethod("setRules",
+                 &WebRequest::SetRules)
+      .SetMethod("getStats",
+                 &WebRequest::GetStats)
       .SetMethod("handleBehaviorChanged",
                  &WebRequest::HandleBehaviorChanged)
       .SetMethod("fetch",
-                 &WebRequest::Fetch);
+                 &WebRequest::Fetch)
+      .SetMethod("cancelFetch",
+                 &WebRequest::CancelFetch);
 }
 
 }  // namespace api
@@ -9,10 +9,13 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "atom/browser/api/trackable_object.h"
 #include "atom/browser/net/atom_network_delegate.h"
+#include "atom/browser/net/fetch_scheduler.h"
 #include "atom/common/native_mate_converters/value_converter.h"
+#include "base/memory/weak_ptr.h"
 #include "base/strings/string_util.h"
 #include "native_mate/arguments.h"
 #include "native_mate/handle.h"
@@ -31,6 +34,8 @@ class Profile;
 
 namespace atom {
 
+class FetchResponseWriter;
+
 namespace api {
 
 class WebRequest : public mate::TrackableObject<WebRequest>,
@@ -49,9 +54,13 @@ class WebRequest : public mate::TrackableObject<WebRequest>,
   typedef base::Callback<void(
       v8::Local<v8::Value>,
       const mate::Dictionary&,
-      v8::Local<v8::String>)> FetchCallback;
+      v8::Local<v8::Value>)> FetchCallback;
   void HandleBehaviorChanged();
-  void Fetch(mate::Arguments* args);
+  void SetRules(mate::Arguments* args);
+  void GetStats(const base::Callback<void(const base::DictionaryValue&)>&
+                    callback);
+  int Fetch(mate::Arguments* args);
+  bool CancelFetch(int id);
   void OnURLFetchComplete(const net::URLFetcher* source) override;
 
   // C++ can not distinguish overloaded member function.
@@ -59,17 +68,58 @@ class WebRequest : public mate::TrackableObject<WebRequest>,
   void SetSimpleListener(mate::Arguments* args);
   template<AtomNetworkDelegate::ResponseEvent type>
   void SetResponseListener(mate::Arguments* args);
-  template<typename Listener, typename Method, typename Event>
-  void SetListenerOnIOThread(
-      const scoped_refptr<net::URLRequestContextGetter>& request_context,
-      Method method, Event type,
-      URLPatterns patterns, Listener listener);
-  template<typename Listener, typename Method, typename Event>
-  void SetListener(Method method, Event type, mate::Arguments* args);
 
  private:
+  // How the body of a fetch is returned.
+  enum FetchResponseType {
+    FETCH_RESPONSE_TEXT,    // A one-byte string passed to the callback.
+    FETCH_RESPONSE_BUFFER,  // A Buffer passed to the callback.
+    FETCH_RESPONSE_STREAM,  // Buffers passed to onData as they arrive.
+    FETCH_RESPONSE_FILE,    // Written to a file.
+  };
+
+  // A caller of fetch waiting for the response.
+  struct FetchWaiter {
+    int id;
+    FetchResponseType response_type;
+    FetchCallback callback;
+  };
+
+  struct PendingFetch {
+    PendingFetch();
+    ~PendingFetch();
+
+    // The id of the fetch in |scheduler_|, that of its first waiter.
+    int id;
+    std::unique_ptr<net::URLFetcher> fetcher;
+    // Owned by |fetcher|, null for FETCH_RESPONSE_FILE.
+    FetchResponseWriter* writer;
+    // The key in |shared_fetches_|, empty when the fetch is not shared.
+    std::string share_key;
+    std::vector<FetchWaiter> waiters;
+  };
+
+  // Runs |waiter| with the error |net_error|.
+  void FailFetch(const FetchWaiter& waiter, int net_error);
+  // Passes a chunk of the streamed fetch |id| to its onData listener unless
+  // the fetch is gone, then runs |done|.
+  static void OnFetchData(
+      base::WeakPtr<WebRequest> web_request,
+      int id,
+      const base::Callback<void(v8::Local<v8::Value>)>& on_data,
+      std::unique_ptr<std::string> chunk,
+      const base::Closure& done);
+
   Profile* profile_;
-  std::map<const net::URLFetcher*, FetchCallback> fetchers_;
+  FetchScheduler scheduler_;
+  int next_fetch_id_;
+  std::map<const net::URLFetcher*, std::unique_ptr<PendingFetch>> fetchers_;
+  // The fetcher of every waiter, by id.
+  std::map<int, const net::URLFetcher*> fetch_ids_;
+  // The in-flight GETs that identical GETs wait on, by url and headers.
+  std::map<std::string, const net::URLFetcher*> shared_fetches_;
+
+  base::WeakPtrFactory<WebRequest> weak_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(WebRequest);
 };
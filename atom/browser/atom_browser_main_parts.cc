@@ -27,6 +27,7 @@
 #include "base/threading/thread_task_runner_handle.h"
 #include "base/time/default_tick_clock.h"
 #include "base/trace_event/trace_event.h"
+#include "brave/common/extensions/module_code_cache.h"
 #include "browser/media/media_capture_devices_dispatcher.h"
 #include "chrome/browser/browser_shutdown.h"
 #include "chrome/browser/profiles/profile_manager.h"
@@ -179,6 +180,9 @@ int AtomBrowserMainParts::PreCreateThreads() {
   if (!PathService::Get(chrome::DIR_USER_DATA, &user_data_dir))
     return chrome::RESULT_CODE_MISSING_DATA;
 
+  brave::ModuleCodeCache::GetInstance()->Init(
+      user_data_dir.Append(FILE_PATH_LITERAL("Module Code Cache")));
+
   // Force MediaCaptureDevicesDispatcher to be created on UI thread.
   brightray::MediaCaptureDevicesDispatcher::GetInstance();
   scoped_refptr<base::SequencedTaskRunner> local_state_task_runner =
@@ -17,6 +17,7 @@
 #include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
 #include "base/threading/thread_task_runner_handle.h"
+#include "brave/common/extensions/code_cache_bindings.h"
 #include "brave/common/extensions/crash_reporter_bindings.h"
 #include "brave/common/extensions/crypto_bindings.h"
 #include "brave/common/extensions/file_bindings.h"
@@ -129,7 +130,8 @@ JavascriptEnvironment::JavascriptEnvironment()
       locker_(isolate_),
       handle_scope_(isolate_),
       context_holder_(new gin::ContextHolder(isolate_)),
-      source_map_(GetModuleSearchPaths()) {
+      source_map_(GetModuleSearchPaths()),
+      code_cache_bindings_(nullptr) {
   v8::Local<v8::ObjectTemplate> templ = ObjectTemplateBuilder(isolate_).Build();
   ModuleRegistry::RegisterGlobals(isolate_, templ);
 
@@ -153,6 +155,11 @@ JavascriptEnvironment::JavascriptEnvironment()
     script_context_->module_system()->RegisterNativeHandler(
       "path", std::unique_ptr<extensions::NativeHandler>(
           new brave::PathBindings(script_context_.get(), &source_map_)));
+    code_cache_bindings_ =
+        new brave::CodeCacheBindings(script_context_.get(), &source_map_);
+    script_context_->module_system()->RegisterNativeHandler(
+      "code_cache",
+      std::unique_ptr<extensions::NativeHandler>(code_cache_bindings_));
   }
 
   ModuleRegistry* registry = ModuleRegistry::From(context());
@@ -15,6 +15,10 @@
 #include "gin/public/isolate_holder.h"
 #include "v8/include/v8.h"
 
+namespace brave {
+class CodeCacheBindings;
+}
+
 namespace extensions {
 class ModuleSystem;
 }
@@ -41,6 +45,10 @@ class JavascriptEnvironment {
   const brave::AsarSourceMap& source_map() const {
     return source_map_;
   }
+  // Owned by the module system.
+  brave::CodeCacheBindings* code_cache_bindings() const {
+    return code_cache_bindings_;
+  }
 
  private:
   bool Initialize();
@@ -54,6 +62,7 @@ class JavascriptEnvironment {
   std::unique_ptr<gin::ContextHolder> context_holder_;
   brave::AsarSourceMap source_map_;
   std::unique_ptr<extensions::ScriptContext> script_context_;
+  brave::CodeCacheBindings* code_cache_bindings_;
 
   DISALLOW_COPY_AND_ASSIGN(JavascriptEnvironment);
 };
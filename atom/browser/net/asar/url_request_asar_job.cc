@@ -4,6 +4,9 @@
 
 #include "atom/browser/net/asar/url_request_asar_job.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,11 +14,18 @@
 #include "atom/common/asar/archive.h"
 #include "atom/common/asar/asar_util.h"
 #include "atom/common/atom_constants.h"
+#include "atom/common/options_switches.h"
 #include "base/bind.h"
+#include "base/command_line.h"
 #include "base/files/file_util.h"
+#include "base/i18n/time_formatting.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
 #include "base/synchronization/lock.h"
 #include "base/task_runner.h"
+#include "base/task_runner_util.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "net/base/file_stream.h"
 #include "net/base/filename_util.h"
 #include "net/base/io_buffer.h"
@@ -35,11 +45,53 @@ namespace asar {
 
 namespace {
 
+// Default number of bytes read from an archive at once, the network stack
+// usually asks for much smaller chunks.
+const int kDefaultReadAheadSize = 256 * 1024;
+
+int GetReadAheadSize() {
+  int size;
+  std::string value = base::CommandLine::ForCurrentProcess()->
+      GetSwitchValueASCII(atom::switches::kAsarReadAheadSize);
+  if (!value.empty() && base::StringToInt(value, &size) && size > 0)
+    return size;
+  return kDefaultReadAheadSize;
+}
+
+int ReadArchive(std::shared_ptr<Archive> archive,
+                const Archive::FileInfo& file_info,
+                int64_t position,
+                scoped_refptr<net::IOBufferWithSize> buffer) {
+  return archive->ReadFile(file_info, position, buffer->data(),
+                           buffer->size());
+}
+
+// Whether |etag| matches one of the entity tags of an If-None-Match header,
+// which uses the weak comparison function.
+bool MatchesIfNoneMatch(const std::string& if_none_match,
+                        const std::string& etag) {
+  if (etag.empty())
+    return false;
+
+  for (base::StringPiece tag : base::SplitStringPiece(
+           if_none_match, ",", base::TRIM_WHITESPACE,
+           base::SPLIT_WANT_NONEMPTY)) {
+    if (tag == "*")
+      return true;
+    if (tag.starts_with("W/"))
+      tag.remove_prefix(2);
+    if (tag == etag)
+      return true;
+  }
+  return false;
+}
+
 void Initialize(
     const base::FilePath& full_path,
     std::shared_ptr<Archive>& archive,  // NOLINT
     base::FilePath* file_path,
     Archive::FileInfo* file_info,
+    Archive::EntryMetadata* entry_metadata,
     URLRequestAsarJob::JobType* type) {
   // Determine whether it is an asar file.
   base::FilePath asar_path, relative_path;
@@ -62,6 +114,8 @@ void Initialize(
     return;
   }
 
+  archive->GetEntryMetadata(relative_path, *file_info, entry_metadata);
+
   *file_path = relative_path;
   *type = URLRequestAsarJob::TYPE_ASAR;
 }
@@ -81,9 +135,11 @@ URLRequestAsarJob::URLRequestAsarJob(
     const scoped_refptr<base::TaskRunner> file_task_runner)
     : net::URLRequestJob(request, network_delegate),
       type_(TYPE_ERROR),
+      read_ahead_size_(GetReadAheadSize()),
       remaining_bytes_(0),
       seek_offset_(0),
       range_parse_result_(net::OK),
+      not_modified_(false),
       file_task_runner_(file_task_runner),
       weak_ptr_factory_(this) {
   net::FileURLToFilePath(request->url(), &full_path_);
@@ -91,34 +147,55 @@ URLRequestAsarJob::URLRequestAsarJob(
 
 URLRequestAsarJob::~URLRequestAsarJob() {}
 
-void URLRequestAsarJob::InitializeAsarJob() {
+void URLRequestAsarJob::InitializeFileJob() {
   stream_.reset(new net::FileStream(file_task_runner_));
 }
 
-void URLRequestAsarJob::InitializeFileJob() {
-  stream_.reset(new net::FileStream(file_task_runner_));
+bool URLRequestAsarJob::InitializeFromOpenedArchive() {
+  base::FilePath asar_path, relative_path;
+  if (!GetAsarArchivePath(full_path_, &asar_path, &relative_path))
+    return false;
+
+  std::shared_ptr<Archive> archive = GetOpenedAsarArchive(asar_path);
+  Archive::FileInfo file_info;
+  if (!archive ||
+      !archive->GetFileInfo(relative_path, &file_info) ||
+      file_info.unpacked ||
+      !archive->GetCachedEntryMetadata(relative_path, &entry_metadata_))
+    return false;
+
+  archive_ = archive;
+  file_path_ = relative_path;
+  file_info_ = file_info;
+  type_ = TYPE_ASAR;
+  return true;
 }
 
 void URLRequestAsarJob::Start() {
+  // Files of an open archive that have been served before need no disk
+  // access to start, so skip the round trip to the file task runner.
+  if (InitializeFromOpenedArchive()) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        base::Bind(&URLRequestAsarJob::DidInitialize,
+                   weak_ptr_factory_.GetWeakPtr()));
+    return;
+  }
+
   file_task_runner_->PostTaskAndReply(
       FROM_HERE,
       base::Bind(&Initialize,
-          full_path_, std::ref(archive_), &file_path_, &file_info_, &type_),
+          full_path_, std::ref(archive_), &file_path_, &file_info_,
+          &entry_metadata_, &type_),
       base::Bind(&URLRequestAsarJob::DidInitialize,
           weak_ptr_factory_.GetWeakPtr()));
 }
 
 void URLRequestAsarJob::DidInitialize() {
   if (type_ == TYPE_ASAR) {
-    InitializeAsarJob();
-    int flags = base::File::FLAG_OPEN |
-                base::File::FLAG_READ |
-                base::File::FLAG_ASYNC;
-    int rv = stream_->Open(archive_->path(), flags,
-                           base::Bind(&URLRequestAsarJob::DidOpen,
-                                      weak_ptr_factory_.GetWeakPtr()));
-    if (rv != net::ERR_IO_PENDING)
-      DidOpen(rv);
+    // Packed files are read from the archive shared by all jobs, so there is
+    // nothing to open.
+    DidOpen(net::OK);
   } else if (type_ == TYPE_FILE) {
     InitializeFileJob();
     auto* meta_info = new FileMetaInfo();
@@ -151,6 +228,9 @@ int URLRequestAsarJob::ReadRawData(net::IOBuffer* dest, int dest_size) {
   if (!dest_size)
     return 0;
 
+  if (type_ == TYPE_ASAR)
+    return ReadFromArchive(dest, dest_size);
+
   int rv = stream_->Read(dest,
                          dest_size,
                          base::Bind(&URLRequestAsarJob::DidRead,
@@ -202,7 +282,10 @@ std::unique_ptr<net::SourceStream> URLRequestAsarJob::SetUpSourceStream() {
 
 bool URLRequestAsarJob::GetMimeType(std::string* mime_type) const {
   if (type_ == TYPE_ASAR) {
-    return net::GetMimeTypeFromFile(file_path_, mime_type);
+    if (entry_metadata_.mime_type.empty())
+      return false;
+    *mime_type = entry_metadata_.mime_type;
+    return true;
   } else {
     if (meta_info_.mime_type_result) {
       *mime_type = meta_info_.mime_type;
@@ -214,6 +297,8 @@ bool URLRequestAsarJob::GetMimeType(std::string* mime_type) const {
 
 void URLRequestAsarJob::SetExtraRequestHeaders(
     const net::HttpRequestHeaders& headers) {
+  headers.GetHeader(net::HttpRequestHeaders::kIfNoneMatch, &if_none_match_);
+
   std::string range_header;
   if (headers.GetHeader(net::HttpRequestHeaders::kRange, &range_header)) {
     // This job only cares about the Range header. This method stashes the value
@@ -233,14 +318,23 @@ void URLRequestAsarJob::SetExtraRequestHeaders(
 
 int URLRequestAsarJob::GetResponseCode() const {
   // Request Job gets created only if path exists.
-  return 200;
+  return not_modified_ ? 304 : 200;
 }
 
 void URLRequestAsarJob::GetResponseInfo(net::HttpResponseInfo* info) {
-  std::string status("HTTP/1.1 200 OK");
+  std::string status(not_modified_ ? "HTTP/1.1 304 Not Modified"
+                                   : "HTTP/1.1 200 OK");
   auto* headers = new net::HttpResponseHeaders(status);
 
   headers->AddHeader(atom::kCORSHeader);
+  if (type_ == TYPE_ASAR) {
+    if (!entry_metadata_.etag.empty())
+      headers->AddHeader("ETag: " + entry_metadata_.etag);
+    if (!archive_->last_modified().is_null()) {
+      headers->AddHeader("Last-Modified: " +
+                         base::TimeFormatHTTP(archive_->last_modified()));
+    }
+  }
   info->headers = headers;
 }
 
@@ -282,20 +376,24 @@ void URLRequestAsarJob::DidOpen(int result) {
     return;
   }
 
+  // Conditional requests are evaluated before the Range header.
+  if (type_ == TYPE_ASAR &&
+      MatchesIfNoneMatch(if_none_match_, entry_metadata_.etag)) {
+    not_modified_ = true;
+    remaining_bytes_ = 0;
+    set_expected_content_size(0);
+    NotifyHeadersComplete();
+    return;
+  }
+
   if (range_parse_result_ != net::OK) {
     NotifyStartError(net::URLRequestStatus(net::URLRequestStatus::FAILED,
                                            range_parse_result_));
     return;
   }
 
-  int64_t file_size, read_offset;
-  if (type_ == TYPE_ASAR) {
-    file_size = file_info_.size;
-    read_offset = file_info_.offset;
-  } else {
-    file_size = meta_info_.file_size;
-    read_offset = 0;
-  }
+  int64_t file_size =
+      type_ == TYPE_ASAR ? file_info_.size : meta_info_.file_size;
 
   if (!byte_range_.ComputeBounds(file_size)) {
     NotifyStartError(
@@ -306,9 +404,13 @@ void URLRequestAsarJob::DidOpen(int result) {
 
   remaining_bytes_ = byte_range_.last_byte_position() -
                      byte_range_.first_byte_position() + 1;
-  seek_offset_ = byte_range_.first_byte_position() + read_offset;
+  seek_offset_ = byte_range_.first_byte_position();
 
-  if (remaining_bytes_ > 0 && seek_offset_ != 0) {
+  if (type_ == TYPE_ASAR) {
+    // Reads of packed files start at |seek_offset_| of the file inside the
+    // shared archive, which also works for compressed files.
+    DidSeek(seek_offset_);
+  } else if (remaining_bytes_ > 0 && seek_offset_ != 0) {
     int rv = stream_->Seek(seek_offset_,
                            base::Bind(&URLRequestAsarJob::DidSeek,
                                       weak_ptr_factory_.GetWeakPtr()));
@@ -347,4 +449,47 @@ void URLRequestAsarJob::DidRead(scoped_refptr<net::IOBuffer> buf, int result) {
   ReadRawDataComplete(result);
 }
 
+int URLRequestAsarJob::ReadFromArchive(net::IOBuffer* dest, int dest_size) {
+  if (read_ahead_buffer_ && read_ahead_buffer_->BytesRemaining() > 0)
+    return CopyFromReadAheadBuffer(dest, dest_size);
+
+  int read_size = static_cast<int>(std::min<int64_t>(
+      remaining_bytes_, std::max(dest_size, read_ahead_size_)));
+  scoped_refptr<net::IOBufferWithSize> buffer(
+      new net::IOBufferWithSize(read_size));
+  base::PostTaskAndReplyWithResult(
+      file_task_runner_.get(),
+      FROM_HERE,
+      base::Bind(&ReadArchive, archive_, file_info_, seek_offset_, buffer),
+      base::Bind(&URLRequestAsarJob::DidReadArchive,
+                 weak_ptr_factory_.GetWeakPtr(),
+                 base::RetainedRef(dest), dest_size, buffer));
+  return net::ERR_IO_PENDING;
+}
+
+void URLRequestAsarJob::DidReadArchive(
+    scoped_refptr<net::IOBuffer> dest,
+    int dest_size,
+    scoped_refptr<net::IOBufferWithSize> buffer,
+    int result) {
+  if (result < 0) {
+    ReadRawDataComplete(net::ERR_FAILED);
+    return;
+  }
+
+  seek_offset_ += result;
+  read_ahead_buffer_ = new net::DrainableIOBuffer(buffer.get(), result);
+  ReadRawDataComplete(CopyFromReadAheadBuffer(dest.get(), dest_size));
+}
+
+int URLRequestAsarJob::CopyFromReadAheadBuffer(net::IOBuffer* dest,
+                                               int dest_size) {
+  int size = std::min(dest_size, read_ahead_buffer_->BytesRemaining());
+  memcpy(dest->data(), read_ahead_buffer_->data(), size);
+  read_ahead_buffer_->DidConsume(size);
+  remaining_bytes_ -= size;
+  DCHECK_GE(remaining_bytes_, 0);
+  return size;
+}
+
 }  // namespace asar
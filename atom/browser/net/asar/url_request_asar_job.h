@@ -21,7 +21,9 @@ class TaskRunner;
 }
 
 namespace net {
+class DrainableIOBuffer;
 class FileStream;
+class IOBufferWithSize;
 }
 
 namespace asar {
@@ -50,9 +52,12 @@ class URLRequestAsarJob : public net::URLRequestJob {
   virtual ~URLRequestAsarJob();
 
   void DidInitialize();
-  void InitializeAsarJob();
   void InitializeFileJob();
 
+  // Initializes the job on the IO thread when the archive is already open
+  // and the metadata of the file has been memoized.
+  bool InitializeFromOpenedArchive();
+
   // net::URLRequestJob:
   void Start() override;
   void Kill() override;
@@ -103,21 +108,45 @@ class URLRequestAsarJob : public net::URLRequestJob {
   // Callback after data is asynchronously read from the file into |buf|.
   void DidRead(scoped_refptr<net::IOBuffer> buf, int result);
 
+  // Serves a read of a packed file from |read_ahead_buffer_|, refilling it
+  // from the shared archive on the file task runner when it is drained.
+  int ReadFromArchive(net::IOBuffer* dest, int dest_size);
+
+  // Callback after a chunk of the archive has been read into |buffer|.
+  void DidReadArchive(scoped_refptr<net::IOBuffer> dest,
+                      int dest_size,
+                      scoped_refptr<net::IOBufferWithSize> buffer,
+                      int result);
+
+  // Copies the buffered data of the archive into |dest|.
+  int CopyFromReadAheadBuffer(net::IOBuffer* dest, int dest_size);
+
   JobType type_;
 
   std::shared_ptr<Archive> archive_;
   base::FilePath file_path_;
   Archive::FileInfo file_info_;
+  Archive::EntryMetadata entry_metadata_;
 
   std::unique_ptr<net::FileStream> stream_;
   FileMetaInfo meta_info_;
 
+  // Data of a packed file read ahead of what the network stack asked for.
+  scoped_refptr<net::DrainableIOBuffer> read_ahead_buffer_;
+  int read_ahead_size_;
+
   net::HttpByteRange byte_range_;
   int64_t remaining_bytes_;
+  // For packed files, the position in the file of the next read.
   int64_t seek_offset_;
 
   net::Error range_parse_result_;
 
+  // The If-None-Match header of the request, and whether it matched the
+  // ETag of the file so a 304 is returned.
+  std::string if_none_match_;
+  bool not_modified_;
+
   scoped_refptr<base::TaskRunner> file_task_runner_;
 
   base::WeakPtrFactory<URLRequestAsarJob> weak_ptr_factory_;
@@ -4,13 +4,18 @@
 
 #include "atom/browser/net/atom_network_delegate.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 #include "atom/browser/extensions/tab_helper.h"
+#include "atom/browser/net/web_request_rules.h"
+#include "atom/browser/net/web_request_stats.h"
 #include "atom/common/native_mate_converters/net_converter.h"
 #include "base/stl_util.h"
 #include "base/strings/string_util.h"
+#include "base/timer/timer.h"
+#include "base/trace_event/trace_event.h"
 #include "chrome/browser/extensions/api/tabs/tabs_constants.h"
 #include "content/network/throttling/throttling_network_transaction.h"
 #include "content/public/browser/browser_thread.h"
@@ -50,6 +55,39 @@ const char* ResourceTypeToString(content::ResourceType type) {
 
 namespace {
 
+// The most timed out requests whose late answer is still counted.
+const size_t kMaxTimedOutTokens = 1000;
+
+const char* EventToString(AtomNetworkDelegate::SimpleEvent type) {
+  switch (type) {
+    case AtomNetworkDelegate::kOnSendHeaders:
+      return "onSendHeaders";
+    case AtomNetworkDelegate::kOnBeforeRedirect:
+      return "onBeforeRedirect";
+    case AtomNetworkDelegate::kOnResponseStarted:
+      return "onResponseStarted";
+    case AtomNetworkDelegate::kOnCompleted:
+      return "onCompleted";
+    case AtomNetworkDelegate::kOnErrorOccurred:
+      return "onErrorOccurred";
+  }
+  NOTREACHED();
+  return "";
+}
+
+const char* EventToString(AtomNetworkDelegate::ResponseEvent type) {
+  switch (type) {
+    case AtomNetworkDelegate::kOnBeforeRequest:
+      return "onBeforeRequest";
+    case AtomNetworkDelegate::kOnBeforeSendHeaders:
+      return "onBeforeSendHeaders";
+    case AtomNetworkDelegate::kOnHeadersReceived:
+      return "onHeadersReceived";
+  }
+  NOTREACHED();
+  return "";
+}
+
 struct ResponseHeadersContainer {
   scoped_refptr<net::HttpResponseHeaders>* headers;
   std::string status_line;
@@ -78,36 +116,50 @@ int GetTabId(int frame_tree_node_id,
 }
 
 void RunSimpleListener(const AtomNetworkDelegate::SimpleListener& listener,
-                       std::unique_ptr<base::DictionaryValue> details,
+                       scoped_refptr<WebRequestStats> stats,
+                       const char* event,
+                       base::TimeTicks posted,
+                       std::unique_ptr<WebRequestDetails> details,
                        int frame_tree_node_id,
                        int render_frame_id,
                        int render_process_id) {
-  details->SetInteger(extensions::tabs_constants::kTabIdKey,
-      GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
-  return listener.Run(*(details.get()));
+  TRACE_EVENT1("net", "AtomNetworkDelegate::RunListener", "event", event);
+  base::TimeTicks started = base::TimeTicks::Now();
+  stats->AddSample(event, WebRequestStats::kQueueTime, started - posted);
+
+  if (details->Wants(WebRequestDetails::kTabId))
+    details->values.SetInteger(extensions::tabs_constants::kTabIdKey,
+        GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
+  listener.Run(*(details.get()));
+  stats->AddSample(event, WebRequestStats::kListenerTime,
+                   base::TimeTicks::Now() - started);
 }
 
+// The listener time of blocking events lasts until |callback| is called,
+// which records it on the IO thread.
 void RunResponseListener(
     const AtomNetworkDelegate::ResponseListener& listener,
-    std::unique_ptr<base::DictionaryValue> details,
+    scoped_refptr<WebRequestStats> stats,
+    const char* event,
+    base::TimeTicks posted,
+    std::unique_ptr<WebRequestDetails> details,
     int frame_tree_node_id, int render_frame_id, int render_process_id,
-    const AtomNetworkDelegate::ResponseCallback& callback) {
-  details->SetInteger(extensions::tabs_constants::kTabIdKey,
-      GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
-  return listener.Run(*(details.get()), callback);
+    const base::Callback<void(base::TimeTicks,
+                              const base::DictionaryValue&)>& callback) {
+  TRACE_EVENT1("net", "AtomNetworkDelegate::RunListener", "event", event);
+  base::TimeTicks started = base::TimeTicks::Now();
+  stats->AddSample(event, WebRequestStats::kQueueTime, started - posted);
+
+  if (details->Wants(WebRequestDetails::kTabId))
+    details->values.SetInteger(extensions::tabs_constants::kTabIdKey,
+        GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
+  listener.Run(*(details.get()), base::Bind(callback, started));
 }
 
 // Test whether the URL of |request| matches |patterns|.
 bool MatchesFilterCondition(net::URLRequest* request,
-                            const URLPatterns& patterns) {
-  if (patterns.empty())
-    return true;
-
-  for (const auto& pattern : patterns) {
-    if (pattern.MatchesURL(request->url()))
-      return true;
-  }
-  return false;
+                            const URLPatternMatcher& patterns) {
+  return patterns.MatchesURL(request->url());
 }
 
 void GetRenderFrameIdAndProcessId(net::URLRequest* request,
@@ -136,85 +188,105 @@ void GetFrameTreeNodeId(net::URLRequest* request, int* frame_tree_node_id) {
     *frame_tree_node_id = request_info->GetFrameTreeNodeId();
 }
 
-// Overloaded by multiple types to fill the |details| object.
-void ToDictionary(base::DictionaryValue* details, net::URLRequest* request) {
-  FillRequestDetails(details, request);
-  details->SetInteger("id", request->identifier());
-  details->SetDouble("timestamp", base::Time::Now().ToDoubleT() * 1000);
-  details->SetString("firstPartyUrl", request->site_for_cookies().spec());
-  auto info = content::ResourceRequestInfo::ForRequest(request);
-  details->SetString("resourceType",
-                     info ? ResourceTypeToString(info->GetResourceType())
-                          : "other");
-  net::IPEndPoint request_ip_endpoint;
-  bool was_successful = request->GetRemoteEndpoint(&request_ip_endpoint);
-  if (was_successful) {
-    details->SetString("ip", request_ip_endpoint.ToStringWithoutPort());
-    details->SetInteger("port", request_ip_endpoint.port());
+// Overloaded by multiple types to fill the |details| object, each only
+// fills the fields the listener asked for.
+void ToDictionary(WebRequestDetails* details, net::URLRequest* request) {
+  base::DictionaryValue* values = &details->values;
+  // The same fields as the protocol handlers get, the cheap ones are dropped
+  // again when not asked for.
+  if (details->Wants(WebRequestDetails::kMethod) ||
+      details->Wants(WebRequestDetails::kUrl) ||
+      details->Wants(WebRequestDetails::kReferrer) ||
+      details->Wants(WebRequestDetails::kUploadData)) {
+    FillRequestDetails(values, request,
+                       details->Wants(WebRequestDetails::kUploadData));
+    if (!details->Wants(WebRequestDetails::kMethod))
+      values->RemoveWithoutPathExpansion("method", nullptr);
+    if (!details->Wants(WebRequestDetails::kUrl))
+      values->RemoveWithoutPathExpansion("url", nullptr);
+    if (!details->Wants(WebRequestDetails::kReferrer))
+      values->RemoveWithoutPathExpansion("referrer", nullptr);
+  }
+  if (details->Wants(WebRequestDetails::kId))
+    values->SetInteger("id", request->identifier());
+  if (details->Wants(WebRequestDetails::kTimestamp))
+    values->SetDouble("timestamp", base::Time::Now().ToDoubleT() * 1000);
+  if (details->Wants(WebRequestDetails::kFirstPartyUrl))
+    values->SetString("firstPartyUrl", request->site_for_cookies().spec());
+  if (details->Wants(WebRequestDetails::kResourceType)) {
+    auto info = content::ResourceRequestInfo::ForRequest(request);
+    values->SetString("resourceType",
+                      info ? ResourceTypeToString(info->GetResourceType())
+                           : "other");
+  }
+  if (details->Wants(WebRequestDetails::kIp) ||
+      details->Wants(WebRequestDetails::kPort)) {
+    net::IPEndPoint request_ip_endpoint;
+    bool was_successful = request->GetRemoteEndpoint(&request_ip_endpoint);
+    if (was_successful) {
+      if (details->Wants(WebRequestDetails::kIp))
+        values->SetString("ip", request_ip_endpoint.ToStringWithoutPort());
+      if (details->Wants(WebRequestDetails::kPort))
+        values->SetInteger("port", request_ip_endpoint.port());
+    }
   }
 }
 
-void ToDictionary(base::DictionaryValue* details,
+void ToDictionary(WebRequestDetails* details,
                   const net::HttpRequestHeaders& headers) {
-  std::unique_ptr<base::DictionaryValue> dict(new base::DictionaryValue);
-  net::HttpRequestHeaders::Iterator it(headers);
-  while (it.GetNext())
-    dict->SetKey(it.name(), base::Value(it.value()));
-  details->Set("requestHeaders", std::move(dict));
+  if (!details->Wants(WebRequestDetails::kRequestHeaders))
+    return;
+
+  // Converted into an object on first access, see WebRequestDetails.
+  details->has_request_headers = true;
+  details->request_headers = headers.ToString();
 }
 
-void ToDictionary(base::DictionaryValue* details,
+void ToDictionary(WebRequestDetails* details,
                   const net::HttpResponseHeaders* headers) {
   if (!headers)
     return;
 
-  std::unique_ptr<base::DictionaryValue> dict(new base::DictionaryValue);
-  size_t iter = 0;
-  std::string key;
-  std::string value;
-  while (headers->EnumerateHeaderLines(&iter, &key, &value)) {
-    if (dict->HasKey(key)) {
-      base::ListValue* values = nullptr;
-      if (dict->GetList(key, &values))
-        values->AppendString(value);
-    } else {
-      std::unique_ptr<base::ListValue> values(new base::ListValue);
-      values->AppendString(value);
-      dict->Set(key, std::move(values));
-    }
+  if (details->Wants(WebRequestDetails::kResponseHeaders)) {
+    details->has_response_headers = true;
+    details->response_headers = headers->raw_headers();
   }
-  details->Set("responseHeaders", std::move(dict));
-  details->SetString("statusLine", headers->GetStatusLine());
-  details->SetInteger("statusCode", headers->response_code());
+  if (details->Wants(WebRequestDetails::kStatusLine))
+    details->values.SetString("statusLine", headers->GetStatusLine());
+  if (details->Wants(WebRequestDetails::kStatusCode))
+    details->values.SetInteger("statusCode", headers->response_code());
 }
 
-void ToDictionary(base::DictionaryValue* details, const GURL& location) {
-  details->SetString("redirectURL", location.spec());
+void ToDictionary(WebRequestDetails* details, const GURL& location) {
+  if (details->Wants(WebRequestDetails::kRedirectURL))
+    details->values.SetString("redirectURL", location.spec());
 }
 
-void ToDictionary(base::DictionaryValue* details,
+void ToDictionary(WebRequestDetails* details,
                   const net::HostPortPair& host_port) {
-  if (host_port.host().empty())
-    details->SetString("ip", host_port.host());
+  if (details->Wants(WebRequestDetails::kIp) && host_port.host().empty())
+    details->values.SetString("ip", host_port.host());
 }
 
-void ToDictionary(base::DictionaryValue* details, bool from_cache) {
-  details->SetBoolean("fromCache", from_cache);
+void ToDictionary(WebRequestDetails* details, bool from_cache) {
+  if (details->Wants(WebRequestDetails::kFromCache))
+    details->values.SetBoolean("fromCache", from_cache);
 }
 
-void ToDictionary(base::DictionaryValue* details,
+void ToDictionary(WebRequestDetails* details,
                   const net::URLRequestStatus& status) {
-  details->SetString("error", net::ErrorToString(status.error()));
+  if (details->Wants(WebRequestDetails::kError))
+    details->values.SetString("error", net::ErrorToString(status.error()));
 }
 
 // Helper function to fill |details| with arbitrary |args|.
 template<typename Arg>
-void FillDetailsObject(base::DictionaryValue* details, Arg arg) {
+void FillDetailsObject(WebRequestDetails* details, Arg arg) {
   ToDictionary(details, arg);
 }
 
 template<typename Arg, typename... Args>
-void FillDetailsObject(base::DictionaryValue* details, Arg arg, Args... args) {
+void FillDetailsObject(WebRequestDetails* details, Arg arg, Args... args) {
   ToDictionary(details, arg);
   FillDetailsObject(details, args...);
 }
@@ -273,7 +345,34 @@ void ReadFromResponseObject(const base::DictionaryValue& response,
 
 }  // namespace
 
-AtomNetworkDelegate::AtomNetworkDelegate() : weak_factory_(this) {
+struct AtomNetworkDelegate::BatchedEvent {
+  std::unique_ptr<WebRequestDetails> details;
+  int frame_tree_node_id;
+  int render_frame_id;
+  int render_process_id;
+};
+
+struct AtomNetworkDelegate::EventBatch {
+  EventBatch(const BatchOptions& options, const BatchListener& listener)
+      : options(options), listener(listener), dropped(0), delivering(false) {}
+
+  BatchOptions options;
+  BatchListener listener;
+  std::vector<BatchedEvent> events;
+  // Events dropped since the last delivery because |events| was full.
+  uint32_t dropped;
+  // Only one batch is on its way to the UI thread at a time, so a slow
+  // listener can not pile up tasks there.
+  bool delivering;
+  // Runs when the oldest event has waited |options.interval|.
+  base::OneShotTimer timer;
+};
+
+AtomNetworkDelegate::AtomNetworkDelegate()
+    : next_blocked_token_(0),
+      stats_(new WebRequestStats),
+      max_blocked_requests_(0),
+      weak_factory_(this) {
 }
 
 AtomNetworkDelegate::~AtomNetworkDelegate() {
@@ -282,21 +381,60 @@ AtomNetworkDelegate::~AtomNetworkDelegate() {
 void AtomNetworkDelegate::SetSimpleListenerInIO(
     SimpleEvent type,
     const URLPatterns& patterns,
+    uint32_t fields,
     const SimpleListener& callback) {
+  batches_.erase(type);
   if (callback.is_null())
     simple_listeners_.erase(type);
   else
-    simple_listeners_[type] = { patterns, callback };
+    simple_listeners_[type] = {
+        URLPatternMatcher(patterns), fields, callback };
+}
+
+void AtomNetworkDelegate::SetBatchListenerInIO(
+    SimpleEvent type,
+    const URLPatterns& patterns,
+    uint32_t fields,
+    const BatchOptions& options,
+    const BatchListener& callback) {
+  batches_.erase(type);
+  if (callback.is_null()) {
+    simple_listeners_.erase(type);
+    return;
+  }
+
+  simple_listeners_[type] = {
+      URLPatternMatcher(patterns), fields, SimpleListener() };
+  batches_[type].reset(new EventBatch(options, callback));
 }
 
 void AtomNetworkDelegate::SetResponseListenerInIO(
     ResponseEvent type,
     const URLPatterns& patterns,
+    uint32_t fields,
+    const TimeoutOptions& timeout,
     const ResponseListener& callback) {
   if (callback.is_null())
     response_listeners_.erase(type);
   else
-    response_listeners_[type] = { patterns, callback };
+    response_listeners_[type] = {
+        URLPatternMatcher(patterns), fields, callback, timeout };
+}
+
+void AtomNetworkDelegate::SetRulesInIO(
+    std::unique_ptr<WebRequestRules> rules) {
+  if (rules && rules->empty())
+    rules.reset();
+  rules_ = std::move(rules);
+}
+
+std::unique_ptr<base::DictionaryValue>
+AtomNetworkDelegate::GetStatsInIO() const {
+  std::unique_ptr<base::DictionaryValue> result(new base::DictionaryValue);
+  result->Set("events", stats_->ToValue());
+  result->SetInteger("blockedRequests", callbacks_.size());
+  result->SetInteger("maxBlockedRequests", max_blocked_requests_);
+  return result;
 }
 
 void AtomNetworkDelegate::SetDevToolsNetworkEmulationClientId(
@@ -309,6 +447,17 @@ int AtomNetworkDelegate::OnBeforeURLRequest(
     net::URLRequest* request,
     const net::CompletionCallback& callback,
     GURL* new_url) {
+  // Requests blocked or redirected by a rule never reach the listener, a
+  // redirected request comes back here with its new URL.
+  bool cancel = false;
+  GURL redirect_url;
+  if (rules_ && rules_->GetBlockingAction(request, &cancel, &redirect_url)) {
+    if (cancel)
+      return net::ERR_BLOCKED_BY_CLIENT;
+    *new_url = redirect_url;
+    return net::OK;
+  }
+
   if (!base::ContainsKey(response_listeners_, kOnBeforeRequest))
     return brightray::NetworkDelegate::OnBeforeURLRequest(
         request, callback, new_url);
@@ -330,6 +479,8 @@ int AtomNetworkDelegate::OnBeforeStartTransaction(
     headers->SetHeader(content::ThrottlingNetworkTransaction::
                            kDevToolsEmulateNetworkConditionsClientId,
                        client_id);
+  if (rules_)
+    rules_->ModifyRequestHeaders(request, headers);
   if (!base::ContainsKey(response_listeners_, kOnBeforeSendHeaders))
     return brightray::NetworkDelegate::OnBeforeStartTransaction(
         request, callback, headers);
@@ -355,14 +506,19 @@ int AtomNetworkDelegate::OnHeadersReceived(
     const net::HttpResponseHeaders* original,
     scoped_refptr<net::HttpResponseHeaders>* override,
     GURL* new_url) {
+  if (rules_)
+    rules_->ModifyResponseHeaders(request, original, override);
   if (!base::ContainsKey(response_listeners_, kOnHeadersReceived))
     return brightray::NetworkDelegate::OnHeadersReceived(
         request, callback, original, override, new_url);
 
+  // The listener sees the headers as changed by the rules.
+  const net::HttpResponseHeaders* headers =
+      override->get() ? override->get() : original;
   return HandleResponseEvent(
       kOnHeadersReceived, request, callback,
-      ResponseHeadersContainer(override, original->GetStatusLine(), new_url),
-      original);
+      ResponseHeadersContainer(override, headers->GetStatusLine(), new_url),
+      headers);
 }
 
 void AtomNetworkDelegate::OnBeforeRedirect(net::URLRequest* request,
@@ -418,7 +574,9 @@ void AtomNetworkDelegate::OnCompleted(net::URLRequest* request,
 }
 
 void AtomNetworkDelegate::OnURLRequestDestroyed(net::URLRequest* request) {
-  callbacks_.erase(request->identifier());
+  if (callbacks_.erase(request->identifier()))
+    TRACE_EVENT_ASYNC_END1("net", "AtomNetworkDelegate::BlockedRequest",
+                           request->identifier(), "destroyed", true);
 }
 
 void AtomNetworkDelegate::OnErrorOccurred(
@@ -443,11 +601,18 @@ int AtomNetworkDelegate::HandleResponseEvent(
   if (!MatchesFilterCondition(request, info.url_patterns))
     return net::OK;
 
-  std::unique_ptr<base::DictionaryValue> details(new base::DictionaryValue);
+  std::unique_ptr<WebRequestDetails> details(
+      new WebRequestDetails(info.fields));
   FillDetailsObject(details.get(), request, args...);
 
   // The |request| could be destroyed before the |callback| is called.
-  callbacks_[request->identifier()] = callback;
+  uint64_t token = ++next_blocked_token_;
+  callbacks_[request->identifier()] = { callback, token };
+  max_blocked_requests_ = std::max(max_blocked_requests_, callbacks_.size());
+  TRACE_EVENT_ASYNC_BEGIN2("net", "AtomNetworkDelegate::BlockedRequest",
+                           request->identifier(),
+                           "event", EventToString(type),
+                           "url", request->url().spec());
 
   int frame_tree_node_id = -1;
   GetFrameTreeNodeId(request, &frame_tree_node_id);
@@ -456,14 +621,25 @@ int AtomNetworkDelegate::HandleResponseEvent(
   int render_process_id = -1;
   GetRenderFrameIdAndProcessId(request, &render_frame_id, &render_process_id);
 
-  ResponseCallback response =
+  auto response =
       base::Bind(&AtomNetworkDelegate::OnListenerResultInUI<Out>,
-                 weak_factory_.GetWeakPtr(), request->identifier(), out);
+                 weak_factory_.GetWeakPtr(), request->identifier(), token,
+                 type, out);
   BrowserThread::PostTask(
       BrowserThread::UI, FROM_HERE,
-      base::Bind(RunResponseListener, info.listener, base::Passed(&details),
+      base::Bind(RunResponseListener, info.listener, stats_,
+                 EventToString(type), base::TimeTicks::Now(),
+                 base::Passed(&details),
                  frame_tree_node_id, render_frame_id, render_process_id,
                  response));
+  if (!info.timeout.timeout.is_zero()) {
+    BrowserThread::PostDelayedTask(
+        BrowserThread::IO, FROM_HERE,
+        base::Bind(&AtomNetworkDelegate::OnListenerTimeout,
+                   weak_factory_.GetWeakPtr(), request->identifier(), type,
+                   token, info.timeout.cancel),
+        info.timeout.timeout);
+  }
   return net::ERR_IO_PENDING;
 }
 
@@ -474,7 +650,8 @@ void AtomNetworkDelegate::HandleSimpleEvent(
   if (!MatchesFilterCondition(request, info.url_patterns))
     return;
 
-  std::unique_ptr<base::DictionaryValue> details(new base::DictionaryValue);
+  std::unique_ptr<WebRequestDetails> details(
+      new WebRequestDetails(info.fields));
   FillDetailsObject(details.get(), request, args...);
 
   int frame_tree_node_id = -1;
@@ -484,35 +661,164 @@ void AtomNetworkDelegate::HandleSimpleEvent(
   int render_process_id = -1;
   GetRenderFrameIdAndProcessId(request, &render_frame_id, &render_process_id);
 
+  if (base::ContainsKey(batches_, type)) {
+    AddToBatch(type, { std::move(details), frame_tree_node_id,
+                       render_frame_id, render_process_id });
+    return;
+  }
+
   BrowserThread::PostTask(
       BrowserThread::UI, FROM_HERE,
-      base::Bind(RunSimpleListener, info.listener, base::Passed(&details),
+      base::Bind(RunSimpleListener, info.listener, stats_, EventToString(type),
+          base::TimeTicks::Now(), base::Passed(&details),
           frame_tree_node_id, render_frame_id, render_process_id));
 }
 
+void AtomNetworkDelegate::AddToBatch(SimpleEvent type, BatchedEvent event) {
+  EventBatch* batch = batches_[type].get();
+  if (batch->events.size() >= batch->options.max_size) {
+    ++batch->dropped;
+    return;
+  }
+
+  batch->events.push_back(std::move(event));
+  if (batch->events.size() >= batch->options.max_size) {
+    FlushBatch(type);
+  } else if (!batch->timer.IsRunning()) {
+    batch->timer.Start(FROM_HERE, batch->options.interval,
+                       base::Bind(&AtomNetworkDelegate::FlushBatch,
+                                  base::Unretained(this), type));
+  }
+}
+
+void AtomNetworkDelegate::FlushBatch(SimpleEvent type) {
+  EventBatch* batch = batches_[type].get();
+  if (batch->delivering || batch->events.empty())
+    return;
+
+  batch->timer.Stop();
+  batch->delivering = true;
+  std::unique_ptr<std::vector<BatchedEvent>> events(
+      new std::vector<BatchedEvent>);
+  events->swap(batch->events);
+  uint32_t dropped = batch->dropped;
+  batch->dropped = 0;
+
+  BrowserThread::PostTask(
+      BrowserThread::UI, FROM_HERE,
+      base::Bind(&AtomNetworkDelegate::RunBatchListener, batch->listener,
+                 stats_, EventToString(type), base::TimeTicks::Now(),
+                 base::Passed(&events), dropped,
+                 base::Bind(&AtomNetworkDelegate::OnBatchDeliveredInIO,
+                            weak_factory_.GetWeakPtr(), type)));
+}
+
+void AtomNetworkDelegate::OnBatchDeliveredInIO(SimpleEvent type) {
+  // The listener has been replaced in the meantime.
+  auto it = batches_.find(type);
+  if (it == batches_.end())
+    return;
+
+  it->second->delivering = false;
+  // Send what piled up while JavaScript was busy, unless the interval of
+  // those events has not passed yet.
+  if (!it->second->timer.IsRunning())
+    FlushBatch(type);
+}
+
+// static
+void AtomNetworkDelegate::RunBatchListener(
+    const BatchListener& listener,
+    scoped_refptr<WebRequestStats> stats,
+    const char* event,
+    base::TimeTicks posted,
+    std::unique_ptr<std::vector<BatchedEvent>> events,
+    uint32_t dropped,
+    const base::Closure& done) {
+  TRACE_EVENT2("net", "AtomNetworkDelegate::RunBatchListener",
+               "event", event, "size", events->size());
+  base::TimeTicks started = base::TimeTicks::Now();
+  stats->AddSample(event, WebRequestStats::kQueueTime, started - posted);
+
+  WebRequestDetailsList details;
+  details.reserve(events->size());
+  for (auto& event : *events) {
+    if (event.details->Wants(WebRequestDetails::kTabId))
+      event.details->values.SetInteger(extensions::tabs_constants::kTabIdKey,
+          GetTabId(event.frame_tree_node_id, event.render_frame_id,
+                   event.render_process_id));
+    details.push_back(std::move(event.details));
+  }
+  listener.Run(details, dropped);
+  stats->AddSample(event, WebRequestStats::kListenerTime,
+                   base::TimeTicks::Now() - started);
+  BrowserThread::PostTask(BrowserThread::IO, FROM_HERE, done);
+}
+
+void AtomNetworkDelegate::OnListenerTimeout(uint64_t id,
+                                            ResponseEvent type,
+                                            uint64_t token,
+                                            bool cancel) {
+  // The listener has answered in time.
+  auto it = callbacks_.find(id);
+  if (it == callbacks_.end() || it->second.token != token)
+    return;
+
+  net::CompletionCallback callback = it->second.callback;
+  callbacks_.erase(it);
+  stats_->AddTimeout(EventToString(type));
+  timed_out_tokens_.insert(token);
+  if (timed_out_tokens_.size() > kMaxTimedOutTokens)
+    timed_out_tokens_.erase(timed_out_tokens_.begin());
+  TRACE_EVENT_ASYNC_END1("net", "AtomNetworkDelegate::BlockedRequest", id,
+                         "timedOut", true);
+
+  callback.Run(cancel ? net::ERR_ABORTED : net::OK);
+}
+
 template<typename T>
 void AtomNetworkDelegate::OnListenerResultInIO(
-    uint64_t id, T out, std::unique_ptr<base::DictionaryValue> response) {
-  // The request has been destroyed.
-  if (!base::ContainsKey(callbacks_, id))
+    uint64_t id, uint64_t token, ResponseEvent type, T out,
+    base::TimeTicks started, base::TimeTicks answered,
+    std::unique_ptr<base::DictionaryValue> response) {
+  const char* event = EventToString(type);
+  stats_->AddSample(event, WebRequestStats::kListenerTime,
+                    answered - started);
+  stats_->AddSample(event, WebRequestStats::kReturnTime,
+                    base::TimeTicks::Now() - answered);
+
+  // The request has been destroyed or has gone on without the answer, in
+  // which case |out| may no longer be valid.
+  auto it = callbacks_.find(id);
+  if (it == callbacks_.end() || it->second.token != token) {
+    if (timed_out_tokens_.erase(token))
+      stats_->AddLateAnswer(event);
     return;
+  }
+
+  // The request is no longer blocked once its callback runs.
+  net::CompletionCallback callback = it->second.callback;
+  callbacks_.erase(it);
+  TRACE_EVENT_ASYNC_END0("net", "AtomNetworkDelegate::BlockedRequest", id);
 
   ReadFromResponseObject(*response.get(), out);
 
   bool cancel = false;
   response->GetBoolean("cancel", &cancel);
-  callbacks_[id].Run(cancel ? net::ERR_ABORTED : net::OK);
+  callback.Run(cancel ? net::ERR_ABORTED : net::OK);
 }
 
 template<typename T>
 void AtomNetworkDelegate::OnListenerResultInUI(
-    uint64_t id,
-    T out, const base::DictionaryValue& response) {
+    uint64_t id, uint64_t token, ResponseEvent type, T out,
+    base::TimeTicks started, const base::DictionaryValue& response) {
+  base::TimeTicks answered = base::TimeTicks::Now();
   std::unique_ptr<base::DictionaryValue> copy = response.CreateDeepCopy();
   BrowserThread::PostTask(
       BrowserThread::IO, FROM_HERE,
       base::Bind(&AtomNetworkDelegate::OnListenerResultInIO<T>,
-                 weak_factory_.GetWeakPtr(), id, out, base::Passed(&copy)));
+                 weak_factory_.GetWeakPtr(), id, token, type, out, started,
+                 answered, base::Passed(&copy)));
 }
 
 }  // namespace atom
@@ -9,30 +9,38 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "base/callback.h"
 #include "base/memory/weak_ptr.h"
 #include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "atom/browser/net/url_pattern_matcher.h"
+#include "atom/browser/net/web_request_details.h"
 #include "base/values.h"
 #include "brightray/browser/network_delegate.h"
 #include "content/public/browser/resource_request_info.h"
-#include "extensions/common/url_pattern.h"
 #include "net/base/net_errors.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
 
 namespace atom {
 
-using URLPatterns = std::set<URLPattern>;
+class WebRequestRules;
+class WebRequestStats;
 
 const char* ResourceTypeToString(content::ResourceType type);
 
 class AtomNetworkDelegate : public brightray::NetworkDelegate {
  public:
   using ResponseCallback = base::Callback<void(const base::DictionaryValue&)>;
-  using SimpleListener = base::Callback<void(const base::DictionaryValue&)>;
-  using ResponseListener = base::Callback<void(const base::DictionaryValue&,
+  using SimpleListener = base::Callback<void(const WebRequestDetails&)>;
+  using ResponseListener = base::Callback<void(const WebRequestDetails&,
                                                const ResponseCallback&)>;
+  // Gets the events of an interval and the number of events dropped since
+  // the last call.
+  using BatchListener = base::Callback<void(const WebRequestDetailsList&,
+                                            uint32_t)>;
 
   enum SimpleEvent {
     kOnSendHeaders,
@@ -49,13 +57,32 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
   };
 
   struct SimpleListenerInfo {
-    URLPatterns url_patterns;
+    URLPatternMatcher url_patterns;
+    // The WebRequestDetails::Field values the listener asked for.
+    uint32_t fields;
     SimpleListener listener;
   };
 
+  struct TimeoutOptions {
+    // How long a request waits for the listener, zero waits forever.
+    base::TimeDelta timeout;
+    // Whether the request is canceled rather than continued on timeout.
+    bool cancel;
+  };
+
   struct ResponseListenerInfo {
-    URLPatterns url_patterns;
+    URLPatternMatcher url_patterns;
+    uint32_t fields;
     ResponseListener listener;
+    TimeoutOptions timeout;
+  };
+
+  struct BatchOptions {
+    // How long events are collected before they are delivered.
+    base::TimeDelta interval;
+    // The most events delivered at once, more events are dropped while
+    // JavaScript is still busy with the last batch.
+    size_t max_size;
   };
 
   AtomNetworkDelegate();
@@ -63,11 +90,29 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
 
   void SetSimpleListenerInIO(SimpleEvent type,
                              const URLPatterns& patterns,
+                             uint32_t fields,
                              const SimpleListener& callback);
+  // Like SetSimpleListenerInIO, but events are collected on the IO thread and
+  // delivered to |callback| together.
+  void SetBatchListenerInIO(SimpleEvent type,
+                            const URLPatterns& patterns,
+                            uint32_t fields,
+                            const BatchOptions& options,
+                            const BatchListener& callback);
   void SetResponseListenerInIO(ResponseEvent type,
                                const URLPatterns& patterns,
+                               uint32_t fields,
+                               const TimeoutOptions& timeout,
                                const ResponseListener& callback);
 
+  // Replaces the declarative rules evaluated for every request, null
+  // removes all rules.
+  void SetRulesInIO(std::unique_ptr<WebRequestRules> rules);
+
+  // The timing of the listeners, see WebRequestStats, and the number of
+  // requests waiting for blocking listeners.
+  std::unique_ptr<base::DictionaryValue> GetStatsInIO() const;
+
   void SetDevToolsNetworkEmulationClientId(const std::string& client_id);
 
  protected:
@@ -95,8 +140,35 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
   void OnURLRequestDestroyed(net::URLRequest* request) override;
 
  private:
+  struct BatchedEvent;
+  struct EventBatch;
+
+  // A request waiting for the answer of a blocking listener.
+  struct BlockedRequest {
+    net::CompletionCallback callback;
+    // Tells apart the answers for the events of the same request, so a late
+    // answer can not continue a later event.
+    uint64_t token;
+  };
+
   void OnErrorOccurred(net::URLRequest* request, bool started, int net_error);
 
+  // Adds an event of a batched listener, sends the batch right away when it
+  // is full.
+  void AddToBatch(SimpleEvent type, BatchedEvent event);
+  // Sends the collected events of |type| to the UI thread, unless the last
+  // batch is still being delivered.
+  void FlushBatch(SimpleEvent type);
+  void OnBatchDeliveredInIO(SimpleEvent type);
+  static void RunBatchListener(
+      const BatchListener& listener,
+      scoped_refptr<WebRequestStats> stats,
+      const char* event,
+      base::TimeTicks posted,
+      std::unique_ptr<std::vector<BatchedEvent>> events,
+      uint32_t dropped,
+      const base::Closure& done);
+
   template<typename...Args>
   void HandleSimpleEvent(SimpleEvent type,
                          net::URLRequest* request,
@@ -108,18 +180,37 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
                           Out out,
                           Args... args);
 
+  // Continues or cancels a request whose listener did not answer in time.
+  void OnListenerTimeout(uint64_t id,
+                         ResponseEvent type,
+                         uint64_t token,
+                         bool cancel);
+
   // Deal with the results of Listener.
   template<typename T>
   void OnListenerResultInIO(
-      uint64_t id, T out, std::unique_ptr<base::DictionaryValue> response);
+      uint64_t id, uint64_t token, ResponseEvent type, T out,
+      base::TimeTicks started, base::TimeTicks answered,
+      std::unique_ptr<base::DictionaryValue> response);
   template<typename T>
   void OnListenerResultInUI(
-      uint64_t id,
-      T out, const base::DictionaryValue& response);
+      uint64_t id, uint64_t token, ResponseEvent type, T out,
+      base::TimeTicks started, const base::DictionaryValue& response);
 
   std::map<SimpleEvent, SimpleListenerInfo> simple_listeners_;
   std::map<ResponseEvent, ResponseListenerInfo> response_listeners_;
-  std::map<uint64_t, net::CompletionCallback> callbacks_;
+  // The pending events of the simple events with a batched listener.
+  std::map<SimpleEvent, std::unique_ptr<EventBatch>> batches_;
+  std::map<uint64_t, BlockedRequest> callbacks_;
+  uint64_t next_blocked_token_;
+  // The tokens of the requests that timed out, to count the answers that
+  // still come. Bounded in case the listener never answers.
+  std::set<uint64_t> timed_out_tokens_;
+  // Evaluated on the IO thread before the listeners run.
+  std::unique_ptr<WebRequestRules> rules_;
+  scoped_refptr<WebRequestStats> stats_;
+  // The most requests that waited in |callbacks_| at once.
+  size_t max_blocked_requests_;
 
   base::Lock lock_;
 
@@ -0,0 +1,121 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/fetch_response_writer.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/callback_helpers.h"
+#include "content/public/browser/browser_thread.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+
+using content::BrowserThread;
+
+namespace atom {
+
+namespace {
+
+// Writes are held back while more than |kHighWaterMark| bytes wait on the UI
+// thread, and resumed once they are down to |kLowWaterMark|.
+const size_t kHighWaterMark = 1024 * 1024;
+const size_t kLowWaterMark = 256 * 1024;
+
+}  // namespace
+
+// Counts the bytes handed to the UI thread and not consumed yet, and holds
+// the completion of a Write while there are too many.
+class FetchResponseWriter::FlowControl
+    : public base::RefCountedThreadSafe<FlowControl> {
+ public:
+  FlowControl() : in_flight_(0), pending_bytes_(0) {}
+
+  // Returns net::OK when the write can complete now.
+  int OnWrite(int num_bytes, const net::CompletionCallback& callback) {
+    DCHECK_CURRENTLY_ON(BrowserThread::IO);
+    in_flight_ += num_bytes;
+    if (in_flight_ <= kHighWaterMark)
+      return net::OK;
+    pending_callback_ = callback;
+    pending_bytes_ = num_bytes;
+    return net::ERR_IO_PENDING;
+  }
+
+  void OnConsumed(size_t num_bytes) {
+    DCHECK_CURRENTLY_ON(BrowserThread::IO);
+    in_flight_ -= num_bytes;
+    if (pending_callback_.is_null() || in_flight_ > kLowWaterMark)
+      return;
+    int result = pending_bytes_;
+    pending_bytes_ = 0;
+    base::ResetAndReturn(&pending_callback_).Run(result);
+  }
+
+  // Posts OnConsumed to the IO thread.
+  static void PostConsumed(scoped_refptr<FlowControl> self, size_t num_bytes) {
+    BrowserThread::PostTask(
+        BrowserThread::IO, FROM_HERE,
+        base::Bind(&FlowControl::OnConsumed, self, num_bytes));
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<FlowControl>;
+  ~FlowControl() {}
+
+  size_t in_flight_;
+  net::CompletionCallback pending_callback_;
+  int pending_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowControl);
+};
+
+FetchResponseWriter::FetchResponseWriter() {
+}
+
+FetchResponseWriter::FetchResponseWriter(const DataCallback& on_data)
+    : on_data_(on_data),
+      flow_control_(new FlowControl) {
+}
+
+FetchResponseWriter::~FetchResponseWriter() {
+}
+
+std::unique_ptr<std::string> FetchResponseWriter::TakeBody() {
+  if (!body_)
+    return std::make_unique<std::string>();
+  return std::move(body_);
+}
+
+int FetchResponseWriter::Initialize(const net::CompletionCallback& callback) {
+  if (on_data_.is_null())
+    body_ = std::make_unique<std::string>();
+  return net::OK;
+}
+
+int FetchResponseWriter::Write(net::IOBuffer* buffer,
+                               int num_bytes,
+                               const net::CompletionCallback& callback) {
+  if (on_data_.is_null()) {
+    body_->append(buffer->data(), num_bytes);
+    return num_bytes;
+  }
+
+  BrowserThread::PostTask(
+      BrowserThread::UI, FROM_HERE,
+      base::Bind(on_data_,
+                 base::Passed(std::make_unique<std::string>(buffer->data(),
+                                                            num_bytes)),
+                 base::Bind(&FlowControl::PostConsumed, flow_control_,
+                            static_cast<size_t>(num_bytes))));
+  int result = flow_control_->OnWrite(num_bytes, callback);
+  return result == net::OK ? num_bytes : result;
+}
+
+int FetchResponseWriter::Finish(int net_error,
+                                const net::CompletionCallback& callback) {
+  return net::OK;
+}
+
+}  // namespace atom
@@ -0,0 +1,55 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_FETCH_RESPONSE_WRITER_H_
+#define ATOM_BROWSER_NET_FETCH_RESPONSE_WRITER_H_
+
+#include <memory>
+#include <string>
+
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "net/url_request/url_fetcher_response_writer.h"
+
+namespace atom {
+
+// Receives the body of a URLFetcher response on the IO thread. The body is
+// either kept as a whole until the fetch completes, or handed to the UI
+// thread chunk by chunk as it arrives.
+class FetchResponseWriter : public net::URLFetcherResponseWriter {
+ public:
+  // Run on the UI thread with each chunk and a closure to run once the chunk
+  // has been consumed.
+  using DataCallback = base::Callback<void(std::unique_ptr<std::string>,
+                                           const base::Closure&)>;
+
+  // Keeps the body, see TakeBody.
+  FetchResponseWriter();
+  // Streams the body to |on_data|.
+  explicit FetchResponseWriter(const DataCallback& on_data);
+  ~FetchResponseWriter() override;
+
+  // Takes the body kept so far, called once the fetch has completed.
+  std::unique_ptr<std::string> TakeBody();
+
+  // net::URLFetcherResponseWriter:
+  int Initialize(const net::CompletionCallback& callback) override;
+  int Write(net::IOBuffer* buffer,
+            int num_bytes,
+            const net::CompletionCallback& callback) override;
+  int Finish(int net_error, const net::CompletionCallback& callback) override;
+
+ private:
+  class FlowControl;
+
+  DataCallback on_data_;
+  std::unique_ptr<std::string> body_;
+  scoped_refptr<FlowControl> flow_control_;
+
+  DISALLOW_COPY_AND_ASSIGN(FetchResponseWriter);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_FETCH_RESPONSE_WRITER_H_
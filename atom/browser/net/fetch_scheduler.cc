@@ -0,0 +1,98 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/fetch_scheduler.h"
+
+#include "base/logging.h"
+
+namespace atom {
+
+FetchScheduler::Entry::Entry() : id(0), priority(PRIORITY_MEDIUM) {
+}
+
+FetchScheduler::Entry::Entry(const Entry& other) = default;
+
+FetchScheduler::Entry::~Entry() {
+}
+
+FetchScheduler::FetchScheduler(size_t max_per_host, size_t max_total)
+    : max_per_host_(max_per_host),
+      max_total_(max_total) {
+  DCHECK_GT(max_per_host_, 0u);
+  DCHECK_GT(max_total_, 0u);
+}
+
+FetchScheduler::~FetchScheduler() {
+}
+
+void FetchScheduler::Add(int id,
+                         const std::string& host,
+                         Priority priority,
+                         const base::Closure& start) {
+  Entry entry;
+  entry.id = id;
+  entry.host = host;
+  entry.priority = priority;
+  entry.start = start;
+  Enqueue(entry);
+  StartQueued();
+}
+
+void FetchScheduler::Prioritize(int id, Priority priority) {
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    if (it->id != id)
+      continue;
+    if (it->priority < priority) {
+      Entry entry = *it;
+      entry.priority = priority;
+      queue_.erase(it);
+      Enqueue(entry);
+      StartQueued();
+    }
+    return;
+  }
+}
+
+void FetchScheduler::Remove(int id) {
+  auto running = running_.find(id);
+  if (running == running_.end()) {
+    for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+      if (it->id == id) {
+        queue_.erase(it);
+        return;
+      }
+    }
+    return;
+  }
+
+  auto host = running_per_host_.find(running->second);
+  if (--host->second == 0)
+    running_per_host_.erase(host);
+  running_.erase(running);
+  StartQueued();
+}
+
+void FetchScheduler::Enqueue(const Entry& entry) {
+  auto it = queue_.begin();
+  while (it != queue_.end() && it->priority >= entry.priority)
+    ++it;
+  queue_.insert(it, entry);
+}
+
+void FetchScheduler::StartQueued() {
+  auto it = queue_.begin();
+  while (it != queue_.end() && running_.size() < max_total_) {
+    if (running_per_host_[it->host] >= max_per_host_) {
+      ++it;
+      continue;
+    }
+    Entry entry = *it;
+    it = queue_.erase(it);
+    running_[entry.id] = entry.host;
+    ++running_per_host_[entry.host];
+    entry.start.Run();
+  }
+}
+
+}  // namespace atom
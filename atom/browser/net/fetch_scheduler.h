@@ -0,0 +1,75 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_FETCH_SCHEDULER_H_
+#define ATOM_BROWSER_NET_FETCH_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "base/callback.h"
+#include "base/macros.h"
+
+namespace atom {
+
+// Decides when queued fetches start. Fetches of higher priority start first,
+// and the fetches running at once are limited per host and overall so that
+// they leave connections to page loads.
+class FetchScheduler {
+ public:
+  enum Priority {
+    PRIORITY_IDLE,
+    PRIORITY_LOW,
+    PRIORITY_MEDIUM,
+    PRIORITY_HIGH,
+  };
+
+  FetchScheduler(size_t max_per_host, size_t max_total);
+  ~FetchScheduler();
+
+  // Queues the fetch |id| to |host|, |start| is run once it may start, which
+  // can be right away.
+  void Add(int id,
+           const std::string& host,
+           Priority priority,
+           const base::Closure& start);
+  // Raises the priority of the fetch |id| when it is still queued.
+  void Prioritize(int id, Priority priority);
+  // Called when the fetch |id| completes or is cancelled, whether it started
+  // or not.
+  void Remove(int id);
+
+ private:
+  struct Entry {
+    Entry();
+    Entry(const Entry& other);
+    ~Entry();
+
+    int id;
+    std::string host;
+    Priority priority;
+    base::Closure start;
+  };
+
+  // Inserts |entry| after the entries of the same or higher priority.
+  void Enqueue(const Entry& entry);
+  void StartQueued();
+
+  const size_t max_per_host_;
+  const size_t max_total_;
+
+  std::list<Entry> queue_;
+  // The host of each running fetch, by id.
+  std::map<int, std::string> running_;
+  std::map<std::string, size_t> running_per_host_;
+
+  DISALLOW_COPY_AND_ASSIGN(FetchScheduler);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_FETCH_SCHEDULER_H_
@@ -6,12 +6,15 @@
 #define ATOM_BROWSER_NET_JS_ASKER_H_
 
 #include <memory>
+#include <string>
 #include <utility>
 
+#include "atom/browser/net/protocol_response_cache.h"
 #include "atom/common/native_mate_converters/net_converter.h"
 #include "base/callback.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "base/values.h"
 #include "content/public/browser/browser_thread.h"
 #include "net/base/net_errors.h"
@@ -36,12 +39,19 @@ using ResponseCallback =
 void AskForOptions(v8::Isolate* isolate,
                    const JavaScriptHandler& handler,
                    std::unique_ptr<base::DictionaryValue> request_details,
+                   bool convert_buffers,
                    const BeforeStartCallback& before_start,
                    const ResponseCallback& callback);
 
 // Test whether the |options| means an error.
 bool IsErrorOptions(base::Value* value, int* error);
 
+// Reads the cache directives in the |options| of a response.
+void GetCacheOptions(const base::Value& options,
+                     base::TimeDelta* max_age,
+                     std::string* etag,
+                     bool* not_modified);
+
 }  // namespace internal
 
 template<typename RequestJob>
@@ -54,16 +64,31 @@ class JsAsker : public RequestJob {
   void SetHandlerInfo(
       v8::Isolate* isolate,
       net::URLRequestContextGetter* request_context_getter,
-      const JavaScriptHandler& handler) {
+      const JavaScriptHandler& handler,
+      ProtocolResponseCache* response_cache) {
     isolate_ = isolate;
     request_context_getter_ = request_context_getter;
     handler_ = handler;
+    response_cache_ = response_cache;
   }
 
   // Subclass should do initailze work here.
   virtual void BeforeStartInUI(v8::Isolate*, v8::Local<v8::Value>) {}
   virtual void StartAsync(std::unique_ptr<base::Value> options) = 0;
 
+  // Whether the Buffers in the options are copied into the value passed to
+  // StartAsync, subclasses that take them in BeforeStartInUI return false.
+  virtual bool ConvertsBuffers() const { return true; }
+
+  // Whether passing the same options to StartAsync again gives the same
+  // response, so that it can be served from the cache.
+  virtual bool CanCacheResponse() const { return true; }
+  // The body kept by the job outside of the options, cached along with them.
+  virtual scoped_refptr<base::RefCountedMemory> GetCachedData() const {
+    return nullptr;
+  }
+  virtual void SetCachedData(scoped_refptr<base::RefCountedMemory> data) {}
+
   net::URLRequestContextGetter* request_context_getter() const {
     return request_context_getter_;
   }
@@ -74,12 +99,31 @@ class JsAsker : public RequestJob {
     std::unique_ptr<base::DictionaryValue> request_details(
         new base::DictionaryValue);
     FillRequestDetails(request_details.get(), RequestJob::request());
+
+    if (IsCacheableRequest()) {
+      const ProtocolResponseCache::Entry* entry =
+          response_cache_->Get(RequestJob::request()->url());
+      if (entry && entry->IsFresh()) {
+        base::ThreadTaskRunnerHandle::Get()->PostTask(
+            FROM_HERE,
+            base::Bind(&JsAsker::StartFromCache,
+                       weak_factory_.GetWeakPtr(),
+                       base::Passed(entry->options->CreateDeepCopy()),
+                       entry->data));
+        return;
+      }
+      // Let the handler tell that the stale entry is still good.
+      if (entry && !entry->etag.empty())
+        request_details->SetString("ifNoneMatch", entry->etag);
+    }
+
     content::BrowserThread::PostTask(
         content::BrowserThread::UI, FROM_HERE,
         base::Bind(&internal::AskForOptions,
                    isolate_,
                    handler_,
                    base::Passed(&request_details),
+                   ConvertsBuffers(),
                    base::Bind(&JsAsker::BeforeStartInUI,
                               weak_factory_.GetWeakPtr()),
                    base::Bind(&JsAsker::OnResponse,
@@ -93,17 +137,53 @@ class JsAsker : public RequestJob {
   // to start, or fail the job.
   void OnResponse(bool success, std::unique_ptr<base::Value> value) {
     int error = net::ERR_NOT_IMPLEMENTED;
-    if (success && value && !internal::IsErrorOptions(value.get(), &error)) {
-      StartAsync(std::move(value));
-    } else {
+    if (!success || !value || internal::IsErrorOptions(value.get(), &error)) {
       RequestJob::NotifyStartError(
           net::URLRequestStatus(net::URLRequestStatus::FAILED, error));
+      return;
     }
+
+    if (IsCacheableRequest()) {
+      const GURL& url = RequestJob::request()->url();
+      base::TimeDelta max_age;
+      std::string etag;
+      bool not_modified = false;
+      internal::GetCacheOptions(*value, &max_age, &etag, &not_modified);
+      if (not_modified) {
+        const ProtocolResponseCache::Entry* entry = response_cache_->Get(url);
+        if (!entry) {
+          RequestJob::NotifyStartError(net::URLRequestStatus(
+              net::URLRequestStatus::FAILED, net::ERR_CACHE_MISS));
+          return;
+        }
+        response_cache_->Refresh(url, max_age);
+        StartFromCache(entry->options->CreateDeepCopy(), entry->data);
+        return;
+      }
+      if ((!max_age.is_zero() || !etag.empty()) && CanCacheResponse())
+        response_cache_->Put(url, *value, GetCachedData(), max_age, etag);
+    }
+
+    StartAsync(std::move(value));
+  }
+
+  void StartFromCache(std::unique_ptr<base::Value> options,
+                      scoped_refptr<base::RefCountedMemory> data) {
+    SetCachedData(data);
+    StartAsync(std::move(options));
+  }
+
+  // Only the responses to plain GETs are cached.
+  bool IsCacheableRequest() const {
+    const net::URLRequest* request = RequestJob::request();
+    return response_cache_ && request->method() == "GET" &&
+           !request->has_upload();
   }
 
   v8::Isolate* isolate_;
   net::URLRequestContextGetter* request_context_getter_;
   JavaScriptHandler handler_;
+  scoped_refptr<ProtocolResponseCache> response_cache_;
 
   base::WeakPtrFactory<JsAsker> weak_factory_;
 
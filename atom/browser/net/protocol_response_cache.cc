@@ -0,0 +1,148 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/protocol_response_cache.h"
+
+#include <utility>
+
+#include "base/strings/string_util.h"
+#include "content/public/browser/browser_thread.h"
+#include "url/gurl.h"
+
+using content::BrowserThread;
+
+namespace atom {
+
+namespace {
+
+// Roughly the memory taken by |value|, which is dominated by its strings and
+// binary data.
+size_t EstimateSize(const base::Value& value) {
+  switch (value.type()) {
+    case base::Value::Type::STRING:
+      return value.GetString().size();
+    case base::Value::Type::BINARY:
+      return value.GetBlob().size();
+    case base::Value::Type::DICTIONARY: {
+      size_t size = 0;
+      for (base::DictionaryValue::Iterator it(
+               static_cast<const base::DictionaryValue&>(value));
+           !it.IsAtEnd();
+           it.Advance())
+        size += it.key().size() + EstimateSize(it.value());
+      return size;
+    }
+    case base::Value::Type::LIST: {
+      size_t size = 0;
+      for (const auto& item : value.GetList())
+        size += EstimateSize(item);
+      return size;
+    }
+    default:
+      return sizeof(base::Value);
+  }
+}
+
+}  // namespace
+
+// static
+const size_t ProtocolResponseCache::kDefaultMaxSize = 32 * 1024 * 1024;
+
+ProtocolResponseCache::Entry::Entry() : size(0) {
+}
+
+ProtocolResponseCache::Entry::~Entry() {
+}
+
+bool ProtocolResponseCache::Entry::IsFresh() const {
+  return base::TimeTicks::Now() < expires;
+}
+
+ProtocolResponseCache::ProtocolResponseCache()
+    : entries_(EntryMap::NO_AUTO_EVICT),
+      size_(0),
+      max_size_(kDefaultMaxSize) {
+}
+
+ProtocolResponseCache::~ProtocolResponseCache() {
+}
+
+const ProtocolResponseCache::Entry* ProtocolResponseCache::Get(
+    const GURL& url) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  auto it = entries_.Get(url.spec());
+  if (it == entries_.end())
+    return nullptr;
+  return it->second.get();
+}
+
+void ProtocolResponseCache::Put(const GURL& url,
+                                const base::Value& options,
+                                scoped_refptr<base::RefCountedMemory> data,
+                                base::TimeDelta max_age,
+                                const std::string& etag) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  auto entry = std::make_unique<Entry>();
+  entry->options = options.CreateDeepCopy();
+  entry->data = std::move(data);
+  entry->etag = etag;
+  entry->expires = base::TimeTicks::Now() + max_age;
+  entry->size = url.spec().size() + EstimateSize(options) + etag.size();
+  if (entry->data)
+    entry->size += entry->data->size();
+  // Responses that could never fit are not worth evicting everything for.
+  if (entry->size > max_size_)
+    return;
+
+  auto it = entries_.Peek(url.spec());
+  if (it != entries_.end()) {
+    size_ -= it->second->size;
+    entries_.Erase(it);
+  }
+  size_ += entry->size;
+  entries_.Put(url.spec(), std::move(entry));
+  Shrink();
+}
+
+void ProtocolResponseCache::Refresh(const GURL& url, base::TimeDelta max_age) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  auto it = entries_.Peek(url.spec());
+  if (it != entries_.end())
+    it->second->expires = base::TimeTicks::Now() + max_age;
+}
+
+void ProtocolResponseCache::Invalidate(const std::string& prefix) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  if (prefix.empty()) {
+    entries_.Clear();
+    size_ = 0;
+    return;
+  }
+
+  auto it = entries_.begin();
+  while (it != entries_.end()) {
+    if (base::StartsWith(it->first, prefix, base::CompareCase::SENSITIVE)) {
+      size_ -= it->second->size;
+      it = entries_.Erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ProtocolResponseCache::SetMaxSize(size_t max_size) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  max_size_ = max_size;
+  Shrink();
+}
+
+void ProtocolResponseCache::Shrink() {
+  while (size_ > max_size_ && !entries_.empty()) {
+    auto oldest = entries_.rbegin();
+    size_ -= oldest->second->size;
+    entries_.Erase(oldest);
+  }
+}
+
+}  // namespace atom
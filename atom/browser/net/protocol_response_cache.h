@@ -0,0 +1,84 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_PROTOCOL_RESPONSE_CACHE_H_
+#define ATOM_BROWSER_NET_PROTOCOL_RESPONSE_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "base/containers/mru_cache.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/time/time.h"
+#include "base/values.h"
+
+class GURL;
+
+namespace atom {
+
+// Keeps the responses of the JS handlers of custom protocols, so that
+// requests can be served on the IO thread without asking the handler again.
+// Lives on the IO thread, except for its creation.
+class ProtocolResponseCache
+    : public base::RefCountedThreadSafe<ProtocolResponseCache> {
+ public:
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    // Whether the entry can be served without asking the handler.
+    bool IsFresh() const;
+
+    // What the handler passed to its callback.
+    std::unique_ptr<base::Value> options;
+    // The body when the job does not keep it in |options|.
+    scoped_refptr<base::RefCountedMemory> data;
+    // The ETag the handler gave, used to revalidate the entry once stale.
+    std::string etag;
+    base::TimeTicks expires;
+    size_t size;
+  };
+
+  // The size cap of a new cache in bytes.
+  static const size_t kDefaultMaxSize;
+
+  ProtocolResponseCache();
+
+  // Returns the entry of |url|, fresh or stale, or nullptr.
+  const Entry* Get(const GURL& url);
+  // Stores the response of the handler for |url|, cached for |max_age| or
+  // until revalidated with |etag|.
+  void Put(const GURL& url,
+           const base::Value& options,
+           scoped_refptr<base::RefCountedMemory> data,
+           base::TimeDelta max_age,
+           const std::string& etag);
+  // Keeps serving the entry of |url| for |max_age|.
+  void Refresh(const GURL& url, base::TimeDelta max_age);
+
+  // Drops the entries whose url starts with |prefix|, all of them when it is
+  // empty.
+  void Invalidate(const std::string& prefix);
+  void SetMaxSize(size_t max_size);
+
+ private:
+  friend class base::RefCountedThreadSafe<ProtocolResponseCache>;
+  ~ProtocolResponseCache();
+
+  using EntryMap = base::MRUCache<std::string, std::unique_ptr<Entry>>;
+
+  // Drops the least recently used entries until the cache fits.
+  void Shrink();
+
+  EntryMap entries_;
+  size_t size_;
+  size_t max_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProtocolResponseCache);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_PROTOCOL_RESPONSE_CACHE_H_
@@ -0,0 +1,163 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/url_pattern_matcher.h"
+
+#include "base/strings/string_piece.h"
+#include "url/gurl.h"
+
+namespace atom {
+
+namespace {
+
+const uint32_t kRootNode = 0;
+
+// Hosts with and without a trailing dot are matched alike.
+base::StringPiece CanonicalizeHost(base::StringPiece host) {
+  if (!host.empty() && host.back() == '.')
+    host.remove_suffix(1);
+  return host;
+}
+
+// Removes the last label of |host| and returns it, sets |has_labels| to false
+// once the first label has been returned. Labels may be empty, e.g. for
+// "a..b".
+base::StringPiece NextLabel(base::StringPiece* host, bool* has_labels) {
+  size_t dot = host->rfind('.');
+  if (dot == base::StringPiece::npos) {
+    base::StringPiece label = *host;
+    *host = base::StringPiece();
+    *has_labels = false;
+    return label;
+  }
+
+  base::StringPiece label = host->substr(dot + 1);
+  *host = host->substr(0, dot);
+  return label;
+}
+
+}  // namespace
+
+URLPatternMatcher::HostNode::HostNode() {
+}
+
+URLPatternMatcher::HostNode::HostNode(const HostNode& other) = default;
+
+URLPatternMatcher::HostNode::~HostNode() {
+}
+
+URLPatternMatcher::URLPatternMatcher() {
+}
+
+URLPatternMatcher::URLPatternMatcher(const URLPatterns& patterns) {
+  for (const URLPattern& pattern : patterns)
+    AddPattern(pattern, static_cast<uint32_t>(patterns_.size()));
+}
+
+URLPatternMatcher::URLPatternMatcher(const URLPatternMatcher& other) = default;
+
+URLPatternMatcher::~URLPatternMatcher() {
+}
+
+URLPatternMatcher& URLPatternMatcher::operator=(
+    const URLPatternMatcher& other) = default;
+
+void URLPatternMatcher::AddPattern(const URLPattern& pattern, uint32_t id) {
+  if (host_nodes_.empty())
+    host_nodes_.push_back(HostNode());
+  patterns_.push_back(pattern);
+  pattern_ids_.push_back(id);
+  IndexPattern(static_cast<uint32_t>(patterns_.size() - 1));
+}
+
+template <typename Visitor>
+bool URLPatternMatcher::VisitCandidates(const GURL& url,
+                                        const Visitor& visit) const {
+  if (visit(any_host_patterns_))
+    return true;
+
+  // Patterns match the host of the inner URL of filesystem: URLs.
+  const GURL* host_url = url.inner_url() ? url.inner_url() : &url;
+  base::StringPiece host = CanonicalizeHost(host_url->host_piece());
+  bool has_labels = !host.empty();
+  uint32_t node = kRootNode;
+  while (has_labels) {
+    base::StringPiece label = NextLabel(&host, &has_labels);
+    auto child = host_nodes_[node].children.find(label);
+    if (child == host_nodes_[node].children.end())
+      return false;
+
+    node = child->second;
+    if (visit(host_nodes_[node].subdomain_patterns))
+      return true;
+  }
+  return visit(host_nodes_[node].host_patterns);
+}
+
+bool URLPatternMatcher::MatchesURL(const GURL& url) const {
+  if (patterns_.empty())
+    return true;
+
+  return VisitCandidates(
+      url, [this, &url](const std::vector<uint32_t>& indices) {
+        return MatchesAny(indices, url);
+      });
+}
+
+void URLPatternMatcher::GetMatchingIds(const GURL& url,
+                                       std::vector<uint32_t>* ids) const {
+  if (patterns_.empty())
+    return;
+
+  VisitCandidates(
+      url, [this, &url, ids](const std::vector<uint32_t>& indices) {
+        for (uint32_t index : indices) {
+          if (patterns_[index].MatchesURL(url))
+            ids->push_back(pattern_ids_[index]);
+        }
+        return false;
+      });
+}
+
+void URLPatternMatcher::IndexPattern(uint32_t index) {
+  const URLPattern& pattern = patterns_[index];
+  base::StringPiece host = CanonicalizeHost(pattern.host());
+  if (pattern.match_all_urls() ||
+      (pattern.match_subdomains() && host.empty())) {
+    any_host_patterns_.push_back(index);
+    return;
+  }
+
+  bool has_labels = !host.empty();
+  uint32_t node = kRootNode;
+  while (has_labels) {
+    std::string label = NextLabel(&host, &has_labels).as_string();
+    auto child = host_nodes_[node].children.find(label);
+    if (child != host_nodes_[node].children.end()) {
+      node = child->second;
+      continue;
+    }
+
+    uint32_t next = static_cast<uint32_t>(host_nodes_.size());
+    host_nodes_[node].children[label] = next;
+    host_nodes_.push_back(HostNode());
+    node = next;
+  }
+
+  if (pattern.match_subdomains())
+    host_nodes_[node].subdomain_patterns.push_back(index);
+  else
+    host_nodes_[node].host_patterns.push_back(index);
+}
+
+bool URLPatternMatcher::MatchesAny(const std::vector<uint32_t>& indices,
+                                   const GURL& url) const {
+  for (uint32_t index : indices) {
+    if (patterns_[index].MatchesURL(url))
+      return true;
+  }
+  return false;
+}
+
+}  // namespace atom
@@ -0,0 +1,90 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
+#define ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/containers/flat_map.h"
+#include "extensions/common/url_pattern.h"
+
+class GURL;
+
+namespace atom {
+
+using URLPatterns = std::set<URLPattern>;
+
+// Matches URLs against a set of URLPatterns without testing every pattern.
+//
+// Patterns are indexed by host in a trie of host labels, walked from the top
+// level domain down, so a URL only gets tested against the patterns whose
+// host equals its host or one of its parent domains, plus the patterns that
+// match any host. The scheme, port and path of those candidates are then
+// checked by URLPattern itself, which keeps the matching semantics identical
+// to testing every pattern.
+class URLPatternMatcher {
+ public:
+  URLPatternMatcher();
+  explicit URLPatternMatcher(const URLPatterns& patterns);
+  URLPatternMatcher(const URLPatternMatcher& other);
+  ~URLPatternMatcher();
+
+  URLPatternMatcher& operator=(const URLPatternMatcher& other);
+
+  // Adds |pattern| tagged with |id|, which is returned by GetMatchingIds.
+  // Patterns passed to the constructor are tagged with their position in the
+  // set.
+  void AddPattern(const URLPattern& pattern, uint32_t id);
+
+  // Whether |url| matches any of the patterns, a matcher without patterns
+  // matches all URLs.
+  bool MatchesURL(const GURL& url) const;
+
+  // Appends the ids of all patterns matching |url| to |ids|, an id shows up
+  // once per matching pattern tagged with it.
+  void GetMatchingIds(const GURL& url, std::vector<uint32_t>* ids) const;
+
+  bool empty() const { return patterns_.empty(); }
+
+ private:
+  struct HostNode {
+    HostNode();
+    HostNode(const HostNode& other);
+    ~HostNode();
+
+    // The child node of every next lower level label.
+    base::flat_map<std::string, uint32_t> children;
+    // Patterns for exactly the host made of the labels leading here.
+    std::vector<uint32_t> host_patterns;
+    // Patterns for that host and all of its subdomains.
+    std::vector<uint32_t> subdomain_patterns;
+  };
+
+  void IndexPattern(uint32_t index);
+
+  // Walks the trie along the host of |url|, and calls |visit| with the
+  // candidate patterns of every node on the way until it returns true.
+  // Returns whether |visit| returned true.
+  template <typename Visitor>
+  bool VisitCandidates(const GURL& url, const Visitor& visit) const;
+
+  // Whether any of the patterns at |indices| matches |url|.
+  bool MatchesAny(const std::vector<uint32_t>& indices, const GURL& url) const;
+
+  std::vector<URLPattern> patterns_;
+  std::vector<uint32_t> pattern_ids_;
+  // Patterns that match any host.
+  std::vector<uint32_t> any_host_patterns_;
+  // The trie, rooted at the first node.
+  std::vector<HostNode> host_nodes_;
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
@@ -6,17 +6,41 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "atom/common/atom_constants.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
+#include "native_mate/dictionary.h"
 #include "net/base/mime_util.h"
 #include "net/base/net_errors.h"
 
+#include "atom/common/node_includes.h"
+
 namespace atom {
 
 namespace {
 
+// Copies |value| when it is a Buffer, a typed array or an ArrayBuffer. The
+// memory can not be served in place, since JS can change it or transfer the
+// ArrayBuffer to a worker while it is read on the IO thread.
+scoped_refptr<base::RefCountedMemory> CopyBuffer(v8::Local<v8::Value> value) {
+  if (node::Buffer::HasInstance(value)) {
+    const unsigned char* data =
+        reinterpret_cast<const unsigned char*>(node::Buffer::Data(value));
+    return base::RefCountedBytes::TakeVector(new std::vector<unsigned char>(
+        data, data + node::Buffer::Length(value)));
+  } else if (value->IsArrayBuffer()) {
+    v8::ArrayBuffer::Contents contents =
+        value.As<v8::ArrayBuffer>()->GetContents();
+    const unsigned char* data =
+        static_cast<const unsigned char*>(contents.Data());
+    return base::RefCountedBytes::TakeVector(new std::vector<unsigned char>(
+        data, data + contents.ByteLength()));
+  }
+  return nullptr;
+}
+
 std::string GetExtFromURL(const GURL& url) {
   std::string spec = url.spec();
   size_t index = spec.find_last_of('.');
@@ -33,20 +57,25 @@ URLRequestBufferJob::URLRequestBufferJob(
       status_code_(net::HTTP_NOT_IMPLEMENTED) {
 }
 
+void URLRequestBufferJob::BeforeStartInUI(
+    v8::Isolate* isolate, v8::Local<v8::Value> value) {
+  data_ = CopyBuffer(value);
+  if (data_)
+    return;
+
+  mate::Dictionary options;
+  v8::Local<v8::Value> data;
+  if (mate::ConvertFromV8(isolate, value, &options) &&
+      options.Get("data", &data))
+    data_ = CopyBuffer(data);
+}
+
 void URLRequestBufferJob::StartAsync(std::unique_ptr<base::Value> options) {
-  const base::Value::BlobStorage* blob = nullptr;
   if (options->IsType(base::Value::Type::DICTIONARY)) {
-    const base::Value* binary = nullptr;
     base::DictionaryValue* dict =
         static_cast<base::DictionaryValue*>(options.get());
     dict->GetString("mimeType", &mime_type_);
     dict->GetString("charset", &charset_);
-    dict->GetBinary("data", &binary);
-    if (binary) {
-      blob = &binary->GetBlob();
-    }
-  } else if (options->is_blob()) {
-    blob = &options->GetBlob();
   }
 
   if (mime_type_.empty()) {
@@ -58,18 +87,30 @@ void URLRequestBufferJob::StartAsync(std::unique_ptr<base::Value> options) {
 #endif
   }
 
-  if (!blob) {
+  if (!data_) {
     NotifyStartError(net::URLRequestStatus(
           net::URLRequestStatus::FAILED, net::ERR_NOT_IMPLEMENTED));
     return;
   }
 
-  data_ = new base::RefCountedBytes(
-      reinterpret_cast<const unsigned char*>(blob->data()), blob->size());
   status_code_ = net::HTTP_OK;
   net::URLRequestSimpleJob::Start();
 }
 
+bool URLRequestBufferJob::ConvertsBuffers() const {
+  return false;
+}
+
+scoped_refptr<base::RefCountedMemory>
+URLRequestBufferJob::GetCachedData() const {
+  return data_;
+}
+
+void URLRequestBufferJob::SetCachedData(
+    scoped_refptr<base::RefCountedMemory> data) {
+  data_ = data;
+}
+
 void URLRequestBufferJob::GetResponseInfo(net::HttpResponseInfo* info) {
   std::string status("HTTP/1.1 ");
   status.append(base::IntToString(status_code_));
@@ -20,7 +20,11 @@ class URLRequestBufferJob : public JsAsker<net::URLRequestSimpleJob> {
   URLRequestBufferJob(net::URLRequest*, net::NetworkDelegate*);
 
   // JsAsker:
+  void BeforeStartInUI(v8::Isolate*, v8::Local<v8::Value>) override;
   void StartAsync(std::unique_ptr<base::Value> options) override;
+  bool ConvertsBuffers() const override;
+  scoped_refptr<base::RefCountedMemory> GetCachedData() const override;
+  void SetCachedData(scoped_refptr<base::RefCountedMemory> data) override;
 
   // URLRequestJob:
   void GetResponseInfo(net::HttpResponseInfo* info) override;
@@ -34,7 +38,8 @@ class URLRequestBufferJob : public JsAsker<net::URLRequestSimpleJob> {
  private:
   std::string mime_type_;
   std::string charset_;
-  scoped_refptr<base::RefCountedBytes> data_;
+  // A copy of the Buffer passed by the handler, made once on the UI thread.
+  scoped_refptr<base::RefCountedMemory> data_;
   net::HttpStatusCode status_code_;
 
   DISALLOW_COPY_AND_ASSIGN(URLRequestBufferJob);
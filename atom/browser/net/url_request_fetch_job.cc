@@ -101,6 +101,11 @@ void URLRequestFetchJob::BeforeStartInUI(
   }
 }
 
+bool URLRequestFetchJob::CanCacheResponse() const {
+  // A replayed response would not get the request context of its own.
+  return !url_request_context_getter_;
+}
+
 void URLRequestFetchJob::StartAsync(std::unique_ptr<base::Value> options) {
   if (!options->IsType(base::Value::Type::DICTIONARY)) {
     NotifyStartError(net::URLRequestStatus(
@@ -30,6 +30,7 @@ class URLRequestFetchJob : public JsAsker<net::URLRequestJob>,
   // JsAsker:
   void BeforeStartInUI(v8::Isolate*, v8::Local<v8::Value>) override;
   void StartAsync(std::unique_ptr<base::Value> options) override;
+  bool CanCacheResponse() const override;
 
   // net::URLRequestJob:
   void Kill() override;
@@ -0,0 +1,425 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/url_request_stream_job.h"
+
+#include <algorithm>
+
+#include "atom/common/atom_constants.h"
+#include "atom/common/native_mate_converters/callback.h"
+#include "base/strings/string_number_conversions.h"
+#include "native_mate/dictionary.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+
+#include "atom/common/node_includes.h"
+
+using content::BrowserThread;
+
+namespace atom {
+
+namespace {
+
+// The stream is paused while more than |kHighWaterMark| bytes wait on the IO
+// thread, and resumed once they are down to |kLowWaterMark|.
+const size_t kHighWaterMark = 1024 * 1024;
+const size_t kLowWaterMark = 256 * 1024;
+
+// Calls |object|.|name|(...argv), returns false when there is no such method
+// or it threw.
+bool CallMethod(v8::Local<v8::Object> object,
+                const char* name,
+                int argc,
+                v8::Local<v8::Value> argv[]) {
+  v8::Isolate* isolate = object->GetIsolate();
+  v8::Local<v8::Context> context = object->CreationContext();
+  v8::Local<v8::Value> method;
+  if (!object->Get(context, mate::StringToV8(isolate, name))
+          .ToLocal(&method) ||
+      !method->IsFunction())
+    return false;
+  return !method.As<v8::Function>()->Call(context, object, argc, argv)
+      .IsEmpty();
+}
+
+}  // namespace
+
+// Reads the stream on the UI thread and posts its chunks to the job.
+class URLRequestStreamJob::StreamReader
+    : public base::RefCountedThreadSafe<StreamReader,
+                                        BrowserThread::DeleteOnUIThread> {
+ public:
+  StreamReader(v8::Isolate* isolate,
+               v8::Local<v8::Object> stream,
+               base::WeakPtr<URLRequestStreamJob> job)
+      : isolate_(isolate),
+        stream_(isolate, stream),
+        job_(job),
+        in_flight_bytes_(0),
+        paused_(false) {}
+
+  // Subscribes to the events of the stream, which starts it flowing. Returns
+  // false when it is not a stream.
+  bool Start() {
+    v8::Local<v8::Object> stream = v8::Local<v8::Object>::New(isolate_,
+                                                               stream_);
+    base::Callback<void(v8::Local<v8::Value>)> on_data =
+        base::Bind(&StreamReader::OnData, this);
+    base::Closure on_end = base::Bind(&StreamReader::OnEnd, this);
+    base::Closure on_error = base::Bind(&StreamReader::OnError, this);
+    v8::Local<v8::Value> error_args[] = {
+        mate::StringToV8(isolate_, "error"),
+        mate::ConvertToV8(isolate_, on_error) };
+    v8::Local<v8::Value> end_args[] = {
+        mate::StringToV8(isolate_, "end"),
+        mate::ConvertToV8(isolate_, on_end) };
+    v8::Local<v8::Value> data_args[] = {
+        mate::StringToV8(isolate_, "data"),
+        mate::ConvertToV8(isolate_, on_data) };
+    if (!CallMethod(stream, "on", arraysize(error_args), error_args) ||
+        !CallMethod(stream, "on", arraysize(end_args), end_args) ||
+        !CallMethod(stream, "on", arraysize(data_args), data_args)) {
+      stream_.Reset();
+      return false;
+    }
+    return true;
+  }
+
+  // The job has served |bytes| of the data.
+  void OnConsumed(size_t bytes) {
+    in_flight_bytes_ -= std::min(bytes, in_flight_bytes_);
+    if (paused_ && in_flight_bytes_ <= kLowWaterMark) {
+      paused_ = false;
+      Invoke("resume");
+    }
+  }
+
+  // The job is gone, nobody reads the rest of the stream.
+  void Abort() {
+    Invoke("destroy");
+    stream_.Reset();
+  }
+
+ private:
+  friend struct BrowserThread::DeleteOnThread<BrowserThread::UI>;
+  friend class base::DeleteHelper<StreamReader>;
+
+  ~StreamReader() {}
+
+  void OnData(v8::Local<v8::Value> chunk) {
+    if (stream_.IsEmpty())
+      return;
+
+    std::unique_ptr<std::string> data(new std::string);
+    if (node::Buffer::HasInstance(chunk))
+      data->assign(node::Buffer::Data(chunk), node::Buffer::Length(chunk));
+    else if (!mate::ConvertFromV8(isolate_, chunk, data.get()))
+      return;
+
+    in_flight_bytes_ += data->size();
+    BrowserThread::PostTask(
+        BrowserThread::IO, FROM_HERE,
+        base::Bind(&URLRequestStreamJob::OnData, job_, base::Passed(&data)));
+
+    if (!paused_ && in_flight_bytes_ > kHighWaterMark) {
+      paused_ = true;
+      Invoke("pause");
+    }
+  }
+
+  void OnEnd() {
+    stream_.Reset();
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+                            base::Bind(&URLRequestStreamJob::OnEnd, job_));
+  }
+
+  void OnError() {
+    stream_.Reset();
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+                            base::Bind(&URLRequestStreamJob::OnError, job_));
+  }
+
+  // Calls a method of the stream without arguments, also from tasks posted
+  // by the IO thread.
+  void Invoke(const char* name) {
+    if (stream_.IsEmpty())
+      return;
+
+    v8::Locker locker(isolate_);
+    v8::HandleScope handle_scope(isolate_);
+    v8::Local<v8::Object> stream = v8::Local<v8::Object>::New(isolate_,
+                                                               stream_);
+    v8::Context::Scope context_scope(stream->CreationContext());
+    CallMethod(stream, name, 0, nullptr);
+  }
+
+  v8::Isolate* isolate_;
+  // Reset once the stream is done, which also breaks the reference cycle
+  // between the stream and its listeners.
+  v8::Global<v8::Object> stream_;
+  base::WeakPtr<URLRequestStreamJob> job_;
+  // Bytes posted to the job and not served yet.
+  size_t in_flight_bytes_;
+  bool paused_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamReader);
+};
+
+URLRequestStreamJob::URLRequestStreamJob(
+    net::URLRequest* request, net::NetworkDelegate* network_delegate)
+    : JsAsker<net::URLRequestJob>(request, network_delegate),
+      status_code_(200),
+      length_(-1),
+      has_range_(false),
+      skip_bytes_(0),
+      remaining_bytes_(-1),
+      chunk_offset_(0),
+      ended_(false),
+      errored_(false),
+      pending_buffer_size_(0),
+      weak_factory_(this) {
+}
+
+URLRequestStreamJob::~URLRequestStreamJob() {
+  if (reader_)
+    BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+                            base::Bind(&StreamReader::Abort, reader_));
+}
+
+void URLRequestStreamJob::OnData(std::unique_ptr<std::string> chunk) {
+  chunks_.push_back(std::move(*chunk));
+  CompletePendingRead();
+}
+
+void URLRequestStreamJob::OnEnd() {
+  ended_ = true;
+  CompletePendingRead();
+}
+
+void URLRequestStreamJob::OnError() {
+  errored_ = true;
+  CompletePendingRead();
+}
+
+void URLRequestStreamJob::BeforeStartInUI(
+    v8::Isolate* isolate, v8::Local<v8::Value> value) {
+  mate::Dictionary options;
+  v8::Local<v8::Object> data;
+  if (!mate::ConvertFromV8(isolate, value, &options) ||
+      !options.Get("data", &data))
+    return;
+
+  scoped_refptr<StreamReader> reader(
+      new StreamReader(isolate, data, weak_factory_.GetWeakPtr()));
+  if (reader->Start())
+    reader_ = reader;
+}
+
+bool URLRequestStreamJob::CanCacheResponse() const {
+  // The stream can only be read once.
+  return false;
+}
+
+void URLRequestStreamJob::StartAsync(std::unique_ptr<base::Value> options) {
+  if (!reader_ || !options->IsType(base::Value::Type::DICTIONARY)) {
+    NotifyStartError(net::URLRequestStatus(
+          net::URLRequestStatus::FAILED, net::ERR_NOT_IMPLEMENTED));
+    return;
+  }
+
+  base::DictionaryValue* dict =
+      static_cast<base::DictionaryValue*>(options.get());
+  dict->GetInteger("statusCode", &status_code_);
+  dict->GetString("mimeType", &mime_type_);
+  dict->GetString("charset", &charset_);
+
+  const base::DictionaryValue* headers = nullptr;
+  if (dict->GetDictionary("headers", &headers)) {
+    for (base::DictionaryValue::Iterator it(*headers);
+         !it.IsAtEnd();
+         it.Advance()) {
+      std::string value;
+      if (it.value().GetAsString(&value) &&
+          net::HttpUtil::IsValidHeaderName(it.key()) &&
+          net::HttpUtil::IsValidHeaderValue(value))
+        headers_.push_back(std::make_pair(it.key(), value));
+    }
+  }
+
+  double length = -1;
+  if (dict->GetDouble("length", &length) && length >= 0)
+    length_ = static_cast<int64_t>(length);
+
+  // Ranges can only be served when the length of the body is known.
+  has_range_ = has_range_ && status_code_ == 200 && length_ >= 0;
+  if (has_range_) {
+    if (!byte_range_.ComputeBounds(length_)) {
+      NotifyStartError(net::URLRequestStatus(
+          net::URLRequestStatus::FAILED,
+          net::ERR_REQUEST_RANGE_NOT_SATISFIABLE));
+      return;
+    }
+    status_code_ = 206;
+    skip_bytes_ = byte_range_.first_byte_position();
+    remaining_bytes_ = byte_range_.last_byte_position() -
+                       byte_range_.first_byte_position() + 1;
+  } else {
+    remaining_bytes_ = length_;
+  }
+
+  NotifyHeadersComplete();
+}
+
+void URLRequestStreamJob::SetExtraRequestHeaders(
+    const net::HttpRequestHeaders& headers) {
+  std::string range_header;
+  std::vector<net::HttpByteRange> ranges;
+  if (headers.GetHeader(net::HttpRequestHeaders::kRange, &range_header) &&
+      net::HttpUtil::ParseRangeHeader(range_header, &ranges) &&
+      ranges.size() == 1) {
+    has_range_ = true;
+    byte_range_ = ranges[0];
+  }
+}
+
+void URLRequestStreamJob::Kill() {
+  weak_factory_.InvalidateWeakPtrs();
+  if (reader_) {
+    BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+                            base::Bind(&StreamReader::Abort, reader_));
+    reader_ = nullptr;
+  }
+  JsAsker<URLRequestJob>::Kill();
+}
+
+int URLRequestStreamJob::ReadRawData(net::IOBuffer* buf, int buf_size) {
+  if (errored_)
+    return net::ERR_FAILED;
+
+  int bytes_read = CopyChunks(buf, buf_size);
+  if (bytes_read == 0 && IsTruncated())
+    return net::ERR_CONTENT_LENGTH_MISMATCH;
+  if (bytes_read > 0 || IsDone())
+    return bytes_read;
+
+  pending_buffer_ = buf;
+  pending_buffer_size_ = buf_size;
+  return net::ERR_IO_PENDING;
+}
+
+bool URLRequestStreamJob::GetMimeType(std::string* mime_type) const {
+  *mime_type = mime_type_;
+  return !mime_type_.empty();
+}
+
+void URLRequestStreamJob::GetResponseInfo(net::HttpResponseInfo* info) {
+  std::string status("HTTP/1.1 ");
+  status.append(base::IntToString(status_code_));
+  status.append("\0\0", 2);
+  auto* headers = new net::HttpResponseHeaders(status);
+
+  headers->AddHeader(kCORSHeader);
+
+  if (!mime_type_.empty()) {
+    std::string content_type_header(net::HttpRequestHeaders::kContentType);
+    content_type_header.append(": ");
+    content_type_header.append(mime_type_);
+    if (!charset_.empty())
+      content_type_header.append("; charset=" + charset_);
+    headers->AddHeader(content_type_header);
+  }
+
+  if (length_ >= 0) {
+    int64_t content_length = length_;
+    if (has_range_) {
+      content_length = byte_range_.last_byte_position() -
+                       byte_range_.first_byte_position() + 1;
+      headers->AddHeader(
+          "Content-Range: bytes " +
+          base::Int64ToString(byte_range_.first_byte_position()) + "-" +
+          base::Int64ToString(byte_range_.last_byte_position()) + "/" +
+          base::Int64ToString(length_));
+    }
+    headers->AddHeader("Accept-Ranges: bytes");
+    headers->AddHeader(std::string(net::HttpRequestHeaders::kContentLength) +
+                       ": " + base::Int64ToString(content_length));
+  }
+
+  for (const auto& header : headers_) {
+    headers->RemoveHeader(header.first);
+    headers->AddHeader(header.first + ": " + header.second);
+  }
+
+  info->headers = headers;
+}
+
+int URLRequestStreamJob::GetResponseCode() const {
+  return status_code_;
+}
+
+int URLRequestStreamJob::CopyChunks(net::IOBuffer* buf, int buf_size) {
+  size_t buffer_size = static_cast<size_t>(buf_size);
+  size_t copied = 0;
+  size_t consumed = 0;
+  while (!chunks_.empty() && copied < buffer_size && remaining_bytes_ != 0) {
+    const std::string& chunk = chunks_.front();
+    size_t size = chunk.size() - chunk_offset_;
+    if (skip_bytes_ > 0) {
+      size = std::min(size, static_cast<size_t>(skip_bytes_));
+      skip_bytes_ -= size;
+    } else {
+      size = std::min(size, buffer_size - copied);
+      if (remaining_bytes_ > 0) {
+        size = std::min(size, static_cast<size_t>(remaining_bytes_));
+        remaining_bytes_ -= size;
+      }
+      memcpy(buf->data() + copied, chunk.data() + chunk_offset_, size);
+      copied += size;
+    }
+
+    consumed += size;
+    chunk_offset_ += size;
+    if (chunk_offset_ == chunk.size()) {
+      chunks_.pop_front();
+      chunk_offset_ = 0;
+    }
+  }
+
+  if (consumed > 0 && reader_) {
+    BrowserThread::PostTask(
+        BrowserThread::UI, FROM_HERE,
+        base::Bind(&StreamReader::OnConsumed, reader_, consumed));
+  }
+  return static_cast<int>(copied);
+}
+
+bool URLRequestStreamJob::IsDone() const {
+  return remaining_bytes_ == 0 || (ended_ && chunks_.empty());
+}
+
+bool URLRequestStreamJob::IsTruncated() const {
+  return ended_ && chunks_.empty() && remaining_bytes_ > 0;
+}
+
+void URLRequestStreamJob::CompletePendingRead() {
+  if (!pending_buffer_)
+    return;
+
+  int result = net::ERR_FAILED;
+  if (!errored_) {
+    result = CopyChunks(pending_buffer_.get(), pending_buffer_size_);
+    if (result == 0 && IsTruncated())
+      result = net::ERR_CONTENT_LENGTH_MISMATCH;
+    else if (result == 0 && !IsDone())
+      return;
+  }
+
+  pending_buffer_ = nullptr;
+  pending_buffer_size_ = 0;
+  ReadRawDataComplete(result);
+}
+
+}  // namespace atom
@@ -0,0 +1,98 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_URL_REQUEST_STREAM_JOB_H_
+#define ATOM_BROWSER_NET_URL_REQUEST_STREAM_JOB_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atom/browser/net/js_asker.h"
+#include "base/memory/weak_ptr.h"
+#include "net/http/http_byte_range.h"
+
+namespace atom {
+
+// Serves a response whose body is a Node.js Readable stream. The stream is
+// read on the UI thread and its chunks are handed to the IO thread as they
+// come, so a body is never buffered as a whole.
+class URLRequestStreamJob : public JsAsker<net::URLRequestJob> {
+ public:
+  URLRequestStreamJob(net::URLRequest*, net::NetworkDelegate*);
+  ~URLRequestStreamJob() override;
+
+  // Called by the reader of the stream.
+  void OnData(std::unique_ptr<std::string> chunk);
+  void OnEnd();
+  void OnError();
+
+ protected:
+  // JsAsker:
+  void BeforeStartInUI(v8::Isolate*, v8::Local<v8::Value>) override;
+  void StartAsync(std::unique_ptr<base::Value> options) override;
+  bool CanCacheResponse() const override;
+
+  // net::URLRequestJob:
+  void SetExtraRequestHeaders(const net::HttpRequestHeaders& headers) override;
+  void Kill() override;
+  int ReadRawData(net::IOBuffer* buf, int buf_size) override;
+  bool GetMimeType(std::string* mime_type) const override;
+  void GetResponseInfo(net::HttpResponseInfo* info) override;
+  int GetResponseCode() const override;
+
+ private:
+  class StreamReader;
+
+  // Moves buffered data into |buf|, skipping the bytes before the requested
+  // range. Returns the number of bytes copied.
+  int CopyChunks(net::IOBuffer* buf, int buf_size);
+  // Whether no more data will be read, either because the stream ended or
+  // the requested range is complete.
+  bool IsDone() const;
+  // Whether the stream ended before the length given by the handler.
+  bool IsTruncated() const;
+  // Completes a ReadRawData call that waited for data.
+  void CompletePendingRead();
+
+  scoped_refptr<StreamReader> reader_;
+
+  // The response given by the handler.
+  int status_code_;
+  std::string mime_type_;
+  std::string charset_;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  // The length of the whole body, or -1 when unknown.
+  int64_t length_;
+
+  // The Range header of the request, only served when the length is known.
+  bool has_range_;
+  net::HttpByteRange byte_range_;
+  // Bytes of the stream before the range, and bytes left to serve, or -1.
+  int64_t skip_bytes_;
+  int64_t remaining_bytes_;
+
+  // Chunks read from the stream and not yet served, |chunk_offset_| bytes of
+  // the first one have been served already.
+  std::deque<std::string> chunks_;
+  size_t chunk_offset_;
+  bool ended_;
+  bool errored_;
+
+  // Saved arguments of a ReadRawData call waiting for data.
+  scoped_refptr<net::IOBuffer> pending_buffer_;
+  int pending_buffer_size_;
+
+  base::WeakPtrFactory<URLRequestStreamJob> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLRequestStreamJob);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_URL_REQUEST_STREAM_JOB_H_
@@ -0,0 +1,57 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/web_request_details.h"
+
+#include "base/macros.h"
+
+namespace atom {
+
+namespace {
+
+const struct {
+  const char* name;
+  WebRequestDetails::Field field;
+} kFieldNames[] = {
+  { "id", WebRequestDetails::kId },
+  { "url", WebRequestDetails::kUrl },
+  { "method", WebRequestDetails::kMethod },
+  { "referrer", WebRequestDetails::kReferrer },
+  { "uploadData", WebRequestDetails::kUploadData },
+  { "timestamp", WebRequestDetails::kTimestamp },
+  { "firstPartyUrl", WebRequestDetails::kFirstPartyUrl },
+  { "resourceType", WebRequestDetails::kResourceType },
+  { "ip", WebRequestDetails::kIp },
+  { "port", WebRequestDetails::kPort },
+  { "tabId", WebRequestDetails::kTabId },
+  { "requestHeaders", WebRequestDetails::kRequestHeaders },
+  { "responseHeaders", WebRequestDetails::kResponseHeaders },
+  { "statusLine", WebRequestDetails::kStatusLine },
+  { "statusCode", WebRequestDetails::kStatusCode },
+  { "redirectURL", WebRequestDetails::kRedirectURL },
+  { "fromCache", WebRequestDetails::kFromCache },
+  { "error", WebRequestDetails::kError },
+};
+
+}  // namespace
+
+WebRequestDetails::WebRequestDetails(uint32_t fields)
+    : fields(fields), has_request_headers(false), has_response_headers(false) {
+}
+
+WebRequestDetails::~WebRequestDetails() {
+}
+
+// static
+bool WebRequestDetails::GetField(const std::string& name, Field* field) {
+  for (size_t i = 0; i < arraysize(kFieldNames); ++i) {
+    if (name == kFieldNames[i].name) {
+      *field = kFieldNames[i].field;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace atom
@@ -0,0 +1,75 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_WEB_REQUEST_DETAILS_H_
+#define ATOM_BROWSER_NET_WEB_REQUEST_DETAILS_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/values.h"
+
+namespace atom {
+
+// The details object passed to webRequest listeners.
+//
+// Listeners can ask for a subset of the fields, and only those are filled.
+// Headers are kept in their wire format and only converted to objects when a
+// listener reads them, which most listeners never do.
+struct WebRequestDetails {
+  enum Field : uint32_t {
+    kId = 1 << 0,
+    kUrl = 1 << 1,
+    kMethod = 1 << 2,
+    kReferrer = 1 << 3,
+    kUploadData = 1 << 4,
+    kTimestamp = 1 << 5,
+    kFirstPartyUrl = 1 << 6,
+    kResourceType = 1 << 7,
+    kIp = 1 << 8,
+    kPort = 1 << 9,
+    kTabId = 1 << 10,
+    kRequestHeaders = 1 << 11,
+    kResponseHeaders = 1 << 12,
+    kStatusLine = 1 << 13,
+    kStatusCode = 1 << 14,
+    kRedirectURL = 1 << 15,
+    kFromCache = 1 << 16,
+    kError = 1 << 17,
+    kAllFields = 0xFFFFFFFF,
+  };
+
+  explicit WebRequestDetails(uint32_t fields);
+  ~WebRequestDetails();
+
+  // Parses the name of a field as used in JavaScript, e.g. "resourceType".
+  static bool GetField(const std::string& name, Field* field);
+
+  bool Wants(Field field) const { return (fields & field) != 0; }
+
+  uint32_t fields;
+  // All fields but the headers.
+  base::DictionaryValue values;
+  // The request headers as serialized by HttpRequestHeaders::ToString, set
+  // when |has_request_headers|.
+  bool has_request_headers;
+  std::string request_headers;
+  // The raw response headers as in HttpResponseHeaders::raw_headers, set
+  // when |has_response_headers|.
+  bool has_response_headers;
+  std::string response_headers;
+
+  DISALLOW_COPY_AND_ASSIGN(WebRequestDetails);
+};
+
+// The details of the events passed to a batched listener at once.
+using WebRequestDetailsList = std::vector<std::unique_ptr<WebRequestDetails>>;
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_WEB_REQUEST_DETAILS_H_
@@ -0,0 +1,266 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/web_request_rules.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "atom/browser/net/atom_network_delegate.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/values.h"
+#include "content/public/browser/resource_request_info.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+#include "net/url_request/url_request.h"
+
+namespace atom {
+
+namespace {
+
+bool ReadStringList(const base::DictionaryValue& value,
+                    const char* key,
+                    std::vector<std::string>* out) {
+  const base::ListValue* list = nullptr;
+  if (!value.GetList(key, &list))
+    return !value.HasKey(key);
+
+  for (size_t i = 0; i < list->GetSize(); ++i) {
+    std::string item;
+    if (!list->GetString(i, &item))
+      return false;
+    out->push_back(item);
+  }
+  return true;
+}
+
+// Reads a {name: value} object of headers, rejecting names and values that
+// are not valid in HTTP.
+bool ReadHeaders(const base::DictionaryValue& value,
+                 const char* key,
+                 std::vector<std::pair<std::string, std::string>>* out) {
+  const base::DictionaryValue* dict = nullptr;
+  if (!value.GetDictionary(key, &dict))
+    return !value.HasKey(key);
+
+  for (base::DictionaryValue::Iterator it(*dict);
+       !it.IsAtEnd();
+       it.Advance()) {
+    std::string header;
+    if (!it.value().GetAsString(&header) ||
+        !net::HttpUtil::IsValidHeaderName(it.key()) ||
+        !net::HttpUtil::IsValidHeaderValue(header))
+      return false;
+    out->push_back(std::make_pair(it.key(), header));
+  }
+  return true;
+}
+
+}  // namespace
+
+WebRequestRules::Rule::Rule() : cancel(false) {
+}
+
+WebRequestRules::Rule::Rule(const Rule& other) = default;
+
+WebRequestRules::Rule::~Rule() {
+}
+
+WebRequestRules::WebRequestRules()
+    : has_blocking_rules_(false),
+      has_request_header_rules_(false),
+      has_response_header_rules_(false) {
+}
+
+WebRequestRules::~WebRequestRules() {
+}
+
+// static
+std::unique_ptr<WebRequestRules> WebRequestRules::Create(
+    const base::ListValue& rules, std::string* error) {
+  std::unique_ptr<WebRequestRules> result(new WebRequestRules);
+  for (size_t i = 0; i < rules.GetSize(); ++i) {
+    const base::DictionaryValue* value = nullptr;
+    Rule rule;
+    std::string rule_error;
+    if (!rules.GetDictionary(i, &value)) {
+      rule_error = "must be an object";
+    } else if (ParseRule(*value, &rule, &rule_error)) {
+      result->has_blocking_rules_ |=
+          rule.cancel || rule.redirect_url.is_valid();
+      result->has_request_header_rules_ |=
+          !rule.set_request_headers.empty() ||
+          !rule.remove_request_headers.empty();
+      result->has_response_header_rules_ |=
+          !rule.set_response_headers.empty() ||
+          !rule.remove_response_headers.empty();
+      uint32_t index = static_cast<uint32_t>(result->rules_.size());
+      if (rule.url_patterns.empty())
+        result->all_urls_rules_.push_back(index);
+      for (const URLPattern& pattern : rule.url_patterns)
+        result->url_patterns_.AddPattern(pattern, index);
+      result->rules_.push_back(rule);
+      continue;
+    }
+
+    *error = "Invalid rule " + base::SizeTToString(i) + ": " + rule_error;
+    return nullptr;
+  }
+  return result;
+}
+
+bool WebRequestRules::GetBlockingAction(const net::URLRequest* request,
+                                        bool* cancel,
+                                        GURL* redirect_url) const {
+  if (!has_blocking_rules_)
+    return false;
+
+  std::vector<uint32_t> matching_rules;
+  GetMatchingRules(request, &matching_rules);
+  for (uint32_t index : matching_rules) {
+    const Rule& rule = rules_[index];
+    if ((!rule.cancel && !rule.redirect_url.is_valid()) ||
+        !MatchesResourceType(rule, request))
+      continue;
+
+    // Never redirect a request to itself, which would loop forever.
+    if (!rule.cancel && rule.redirect_url == request->url())
+      continue;
+
+    *cancel = rule.cancel;
+    *redirect_url = rule.redirect_url;
+    return true;
+  }
+  return false;
+}
+
+void WebRequestRules::ModifyRequestHeaders(
+    const net::URLRequest* request,
+    net::HttpRequestHeaders* headers) const {
+  if (!has_request_header_rules_)
+    return;
+
+  std::vector<uint32_t> matching_rules;
+  GetMatchingRules(request, &matching_rules);
+  for (uint32_t index : matching_rules) {
+    const Rule& rule = rules_[index];
+    if ((rule.set_request_headers.empty() &&
+         rule.remove_request_headers.empty()) ||
+        !MatchesResourceType(rule, request))
+      continue;
+
+    for (const auto& name : rule.remove_request_headers)
+      headers->RemoveHeader(name);
+    for (const auto& header : rule.set_request_headers)
+      headers->SetHeader(header.first, header.second);
+  }
+}
+
+void WebRequestRules::ModifyResponseHeaders(
+    const net::URLRequest* request,
+    const net::HttpResponseHeaders* original,
+    scoped_refptr<net::HttpResponseHeaders>* override) const {
+  if (!has_response_header_rules_ || !original)
+    return;
+
+  std::vector<uint32_t> matching_rules;
+  GetMatchingRules(request, &matching_rules);
+  for (uint32_t index : matching_rules) {
+    const Rule& rule = rules_[index];
+    if ((rule.set_response_headers.empty() &&
+         rule.remove_response_headers.empty()) ||
+        !MatchesResourceType(rule, request))
+      continue;
+
+    if (!*override)
+      *override = new net::HttpResponseHeaders(original->raw_headers());
+    for (const auto& name : rule.remove_response_headers)
+      (*override)->RemoveHeader(name);
+    for (const auto& header : rule.set_response_headers) {
+      (*override)->RemoveHeader(header.first);
+      (*override)->AddHeader(header.first + ": " + header.second);
+    }
+  }
+}
+
+// static
+bool WebRequestRules::ParseRule(const base::DictionaryValue& value,
+                                Rule* rule,
+                                std::string* error) {
+  std::vector<std::string> urls;
+  if (!ReadStringList(value, "urls", &urls)) {
+    *error = "urls must be an array of strings";
+    return false;
+  }
+  for (const auto& url : urls) {
+    URLPattern pattern(URLPattern::SCHEME_ALL);
+    if (pattern.Parse(url) != URLPattern::PARSE_SUCCESS) {
+      *error = "invalid URL pattern " + url;
+      return false;
+    }
+    rule->url_patterns.insert(pattern);
+  }
+
+  std::vector<std::string> resource_types;
+  if (!ReadStringList(value, "resourceTypes", &resource_types)) {
+    *error = "resourceTypes must be an array of strings";
+    return false;
+  }
+  rule->resource_types.insert(resource_types.begin(), resource_types.end());
+
+  value.GetBoolean("cancel", &rule->cancel);
+
+  std::string redirect_url;
+  if (value.GetString("redirectURL", &redirect_url)) {
+    rule->redirect_url = GURL(redirect_url);
+    if (!rule->redirect_url.is_valid()) {
+      *error = "invalid redirectURL " + redirect_url;
+      return false;
+    }
+  }
+
+  if (!ReadHeaders(value, "requestHeaders", &rule->set_request_headers) ||
+      !ReadHeaders(value, "responseHeaders", &rule->set_response_headers) ||
+      !ReadStringList(value, "removeRequestHeaders",
+                      &rule->remove_request_headers) ||
+      !ReadStringList(value, "removeResponseHeaders",
+                      &rule->remove_response_headers)) {
+    *error = "invalid headers";
+    return false;
+  }
+
+  if (!rule->cancel &&
+      !rule->redirect_url.is_valid() &&
+      rule->set_request_headers.empty() &&
+      rule->remove_request_headers.empty() &&
+      rule->set_response_headers.empty() &&
+      rule->remove_response_headers.empty()) {
+    *error = "rule has no action";
+    return false;
+  }
+  return true;
+}
+
+void WebRequestRules::GetMatchingRules(const net::URLRequest* request,
+                                       std::vector<uint32_t>* rules) const {
+  *rules = all_urls_rules_;
+  url_patterns_.GetMatchingIds(request->url(), rules);
+  // A rule shows up once per matching pattern, and rules must apply in
+  // their order.
+  std::sort(rules->begin(), rules->end());
+  rules->erase(std::unique(rules->begin(), rules->end()), rules->end());
+}
+
+bool WebRequestRules::MatchesResourceType(
+    const Rule& rule, const net::URLRequest* request) const {
+  if (rule.resource_types.empty())
+    return true;
+  auto info = content::ResourceRequestInfo::ForRequest(request);
+  const char* type =
+      info ? ResourceTypeToString(info->GetResourceType()) : "other";
+  return rule.resource_types.find(type) != rule.resource_types.end();
+}
+
+}  // namespace atom
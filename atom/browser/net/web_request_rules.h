@@ -0,0 +1,113 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_WEB_REQUEST_RULES_H_
+#define ATOM_BROWSER_NET_WEB_REQUEST_RULES_H_
+
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "atom/browser/net/url_pattern_matcher.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "url/gurl.h"
+
+namespace base {
+class DictionaryValue;
+class ListValue;
+}
+
+namespace net {
+class HttpRequestHeaders;
+class HttpResponseHeaders;
+class URLRequest;
+}
+
+namespace atom {
+
+// Declarative rules of webRequest, which block, redirect or rewrite the
+// headers of requests on the IO thread without asking JavaScript.
+class WebRequestRules {
+ public:
+  ~WebRequestRules();
+
+  // Parses the rules from JavaScript, returns nullptr and sets |error| when
+  // a rule is invalid.
+  static std::unique_ptr<WebRequestRules> Create(const base::ListValue& rules,
+                                                 std::string* error);
+
+  // Finds the first rule that cancels or redirects |request|. Returns false
+  // when no rule applies.
+  bool GetBlockingAction(const net::URLRequest* request,
+                         bool* cancel,
+                         GURL* redirect_url) const;
+
+  // Applies the request header changes of all rules matching |request| to
+  // |headers|.
+  void ModifyRequestHeaders(const net::URLRequest* request,
+                            net::HttpRequestHeaders* headers) const;
+
+  // Applies the response header changes of all rules matching |request| on
+  // top of |original|, setting |override| when any header changed.
+  void ModifyResponseHeaders(
+      const net::URLRequest* request,
+      const net::HttpResponseHeaders* original,
+      scoped_refptr<net::HttpResponseHeaders>* override) const;
+
+  bool empty() const { return rules_.empty(); }
+
+ private:
+  using Headers = std::vector<std::pair<std::string, std::string>>;
+
+  struct Rule {
+    Rule();
+    Rule(const Rule& other);
+    ~Rule();
+
+    URLPatterns url_patterns;
+    // Resource types like "script" the rule is limited to, or empty for all.
+    std::set<std::string> resource_types;
+
+    bool cancel;
+    GURL redirect_url;
+    Headers set_request_headers;
+    std::vector<std::string> remove_request_headers;
+    Headers set_response_headers;
+    std::vector<std::string> remove_response_headers;
+  };
+
+  WebRequestRules();
+
+  static bool ParseRule(const base::DictionaryValue& value,
+                        Rule* rule,
+                        std::string* error);
+
+  // Sets |rules| to the indices of the rules whose URL patterns match
+  // |request|, in the order of the rules.
+  void GetMatchingRules(const net::URLRequest* request,
+                        std::vector<uint32_t>* rules) const;
+  bool MatchesResourceType(const Rule& rule,
+                           const net::URLRequest* request) const;
+
+  std::vector<Rule> rules_;
+  // The URL patterns of all rules tagged with the index of their rule, so a
+  // request is only tested against the rules that can apply to its host.
+  URLPatternMatcher url_patterns_;
+  // Rules without URL patterns, which apply to all URLs.
+  std::vector<uint32_t> all_urls_rules_;
+  // Whether any rule blocks requests or changes their headers, so requests
+  // skip matching for the stages no rule cares about.
+  bool has_blocking_rules_;
+  bool has_request_header_rules_;
+  bool has_response_header_rules_;
+
+  DISALLOW_COPY_AND_ASSIGN(WebRequestRules);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_WEB_REQUEST_RULES_H_
@@ -0,0 +1,90 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/web_request_stats.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/values.h"
+
+namespace atom {
+
+namespace {
+
+const char* const kPhaseNames[] = {
+  "queueTime",
+  "listenerTime",
+  "returnTime",
+};
+
+}  // namespace
+
+WebRequestStats::Histogram::Histogram() : count(0) {
+  buckets.fill(0);
+}
+
+WebRequestStats::EventStats::EventStats() : timeouts(0), late_answers(0) {
+}
+
+WebRequestStats::WebRequestStats() {
+}
+
+WebRequestStats::~WebRequestStats() {
+}
+
+void WebRequestStats::AddSample(const std::string& event,
+                                Phase phase,
+                                base::TimeDelta time) {
+  size_t bucket = 0;
+  int64_t ms = time.InMilliseconds();
+  while (bucket < kBucketCount - 1 && ms >= (int64_t(1) << bucket))
+    ++bucket;
+
+  base::AutoLock auto_lock(lock_);
+  Histogram& histogram = events_[event].phases[phase];
+  ++histogram.count;
+  histogram.total += time;
+  histogram.max = std::max(histogram.max, time);
+  ++histogram.buckets[bucket];
+}
+
+void WebRequestStats::AddTimeout(const std::string& event) {
+  base::AutoLock auto_lock(lock_);
+  ++events_[event].timeouts;
+}
+
+void WebRequestStats::AddLateAnswer(const std::string& event) {
+  base::AutoLock auto_lock(lock_);
+  ++events_[event].late_answers;
+}
+
+std::unique_ptr<base::DictionaryValue> WebRequestStats::ToValue() const {
+  std::unique_ptr<base::DictionaryValue> result(new base::DictionaryValue);
+  base::AutoLock auto_lock(lock_);
+  for (const auto& event : events_) {
+    std::unique_ptr<base::DictionaryValue> stats(new base::DictionaryValue);
+    stats->SetDouble("timeouts", event.second.timeouts);
+    stats->SetDouble("lateAnswers", event.second.late_answers);
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+      const Histogram& histogram = event.second.phases[i];
+      if (!histogram.count)
+        continue;
+
+      std::unique_ptr<base::DictionaryValue> value(new base::DictionaryValue);
+      value->SetDouble("count", histogram.count);
+      value->SetDouble("totalMs", histogram.total.InMillisecondsF());
+      value->SetDouble("maxMs", histogram.max.InMillisecondsF());
+      std::unique_ptr<base::ListValue> buckets(new base::ListValue);
+      for (uint64_t bucket : histogram.buckets)
+        buckets->AppendDouble(bucket);
+      value->Set("buckets", std::move(buckets));
+      stats->Set(kPhaseNames[i], std::move(value));
+    }
+    result->Set(event.first, std::move(stats));
+  }
+  return result;
+}
+
+}  // namespace atom
@@ -0,0 +1,85 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
+#define ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+namespace base {
+class DictionaryValue;
+}
+
+namespace atom {
+
+// Histograms of how long the events of webRequest take in each hop between
+// the IO thread and the listener. Samples are added on both the IO and the
+// UI thread.
+class WebRequestStats : public base::RefCountedThreadSafe<WebRequestStats> {
+ public:
+  enum Phase {
+    // From posting the event on the IO thread until the listener runs.
+    kQueueTime,
+    // Running the listener, for blocking events until it calls back.
+    kListenerTime,
+    // From the answer of a blocking listener until the IO thread gets it.
+    kReturnTime,
+    kPhaseCount,
+  };
+
+  WebRequestStats();
+
+  void AddSample(const std::string& event, Phase phase, base::TimeDelta time);
+  // Counts a blocking listener that did not answer in time, and its answer
+  // when it comes after all.
+  void AddTimeout(const std::string& event);
+  void AddLateAnswer(const std::string& event);
+
+  // { eventName: { queueTime, listenerTime, returnTime, timeouts,
+  // lateAnswers } }, each histogram being { count, totalMs, maxMs, buckets }.
+  std::unique_ptr<base::DictionaryValue> ToValue() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<WebRequestStats>;
+
+  // Bucket i counts the samples below 2^i ms, the last one the rest.
+  static const size_t kBucketCount = 12;
+
+  struct Histogram {
+    Histogram();
+
+    uint64_t count;
+    base::TimeDelta total;
+    base::TimeDelta max;
+    std::array<uint64_t, kBucketCount> buckets;
+  };
+  struct EventStats {
+    EventStats();
+
+    std::array<Histogram, kPhaseCount> phases;
+    uint64_t timeouts;
+    uint64_t late_answers;
+  };
+
+  ~WebRequestStats();
+
+  mutable base::Lock lock_;
+  std::map<std::string, EventStats> events_;
+
+  DISALLOW_COPY_AND_ASSIGN(WebRequestStats);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 
+#include <string>
 #include <vector>
 
 #include "atom_natives.h"  // NOLINT: This file is generated with coffee2c.
@@ -38,7 +39,10 @@ class Archive : public mate::Wrappable<Archive> {
         .SetMethod("stat", &Archive::Stat)
         .SetMethod("readdir", &Archive::Readdir)
         .SetMethod("realpath", &Archive::Realpath)
+        .SetMethod("readFile", &Archive::ReadFile)
+        .SetMethod("readFileUtf8", &Archive::ReadFileUtf8)
         .SetMethod("copyFileOut", &Archive::CopyFileOut)
+        .SetMethod("copyFileOutForReading", &Archive::CopyFileOutForReading)
         .SetMethod("getFd", &Archive::GetFD)
         .SetMethod("destroy", &Archive::Destroy);
   }
@@ -63,6 +67,7 @@ class Archive : public mate::Wrappable<Archive> {
     mate::Dictionary dict(isolate, v8::Object::New(isolate));
     dict.Set("size", info.size);
     dict.Set("unpacked", info.unpacked);
+    dict.Set("compressed", info.compressed);
     dict.Set("offset", info.offset);
     return dict.GetHandle();
   }
@@ -100,6 +105,33 @@ class Archive : public mate::Wrappable<Archive> {
     return mate::ConvertToV8(isolate, realpath);
   }
 
+  // Returns the content of a packed file as a Buffer copied out of the mapped
+  // archive or decompressed, or false when the file can not be read.
+  v8::Local<v8::Value> ReadFile(v8::Isolate* isolate,
+                                 const base::FilePath& path) {
+    std::string buffer;
+    base::StringPiece contents;
+    if (!GetFileContents(path, &buffer, &contents))
+      return v8::False(isolate);
+    return node::Buffer::Copy(isolate,
+                              contents.data(),
+                              contents.size()).ToLocalChecked();
+  }
+
+  // Same with ReadFile but decodes the content as an UTF-8 string directly,
+  // without going through an intermediate Buffer.
+  v8::Local<v8::Value> ReadFileUtf8(v8::Isolate* isolate,
+                                     const base::FilePath& path) {
+    std::string buffer;
+    base::StringPiece contents;
+    if (!GetFileContents(path, &buffer, &contents))
+      return v8::False(isolate);
+    return v8::String::NewFromUtf8(isolate,
+                                   contents.data(),
+                                   v8::String::kNormalString,
+                                   static_cast<int>(contents.size()));
+  }
+
   // Copy the file out into a temporary file and returns the new path.
   v8::Local<v8::Value> CopyFileOut(v8::Isolate* isolate,
                                     const base::FilePath& path) {
@@ -109,6 +141,16 @@ class Archive : public mate::Wrappable<Archive> {
     return mate::ConvertToV8(isolate, new_path);
   }
 
+  // Same with CopyFileOut but the returned path may only be opened by the
+  // current process.
+  v8::Local<v8::Value> CopyFileOutForReading(v8::Isolate* isolate,
+                                              const base::FilePath& path) {
+    base::FilePath new_path;
+    if (!archive_ || !archive_->CopyFileOutForReading(path, &new_path))
+      return v8::False(isolate);
+    return mate::ConvertToV8(isolate, new_path);
+  }
+
   // Return the file descriptor.
   int GetFD() const {
     if (!archive_)
@@ -122,6 +164,16 @@ class Archive : public mate::Wrappable<Archive> {
   }
 
  private:
+  bool GetFileContents(const base::FilePath& path,
+                       std::string* buffer,
+                       base::StringPiece* contents) {
+    asar::Archive::FileInfo info;
+    return archive_ &&
+           archive_->GetFileInfo(path, &info) &&
+           !info.unpacked &&
+           archive_->ReadFileContents(info, buffer, contents);
+  }
+
   std::unique_ptr<asar::Archive> archive_;
 
   DISALLOW_COPY_AND_ASSIGN(Archive);
@@ -4,114 +4,252 @@
 
 #include "atom/common/asar/archive.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "atom/common/asar/archive_index.h"
 #include "atom/common/asar/scoped_temporary_file.h"
+#include "base/atomicops.h"
+#include "base/base_paths.h"
+#include "base/bind.h"
 #include "base/files/file.h"
+#include "base/files/file_enumerator.h"
 #include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/files/memory_mapped_file.h"
 #include "base/json/json_reader.h"
 #include "base/logging.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/path_service.h"
 #include "base/pickle.h"
+#include "base/sha1.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/task_scheduler/post_task.h"
+#include "base/task_scheduler/task_scheduler.h"
+#include "base/time/time.h"
 #include "base/values.h"
+#include "net/base/mime_util.h"
+#include "third_party/zlib/zlib.h"
 
 #if defined(OS_WIN)
 #include "atom/node/osfhandle.h"
 #endif
 
+#if defined(OS_POSIX)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(OS_LINUX)
+#include <sys/syscall.h>
+#endif
+
 #include "base/threading/thread_restrictions.h"
 
 namespace asar {
 
 namespace {
 
+// The most bytes of decompressed blocks kept around per archive.
+const size_t kMaxBlockCacheBytes = 8 * 1024 * 1024;
+
+// The most packed files whose metadata is memoized per archive.
+const size_t kMaxEntryMetadataCount = 1024;
+
+// Extracted files unused for longer are deleted, and the least recently used
+// ones are deleted while the cache is larger than the limit.
+const base::TimeDelta kMaxExtractedFileAge = base::TimeDelta::FromDays(30);
+const int64_t kMaxExtractionCacheBytes = 512 * 1024 * 1024;
+
+// Only files up to this size are copied to memory, and only up to the total
+// per archive, larger ones go to the extraction cache on disk.
+const uint32_t kMaxMemoryFileSize = 1024 * 1024;
+const size_t kMaxMemoryFileBytes = 32 * 1024 * 1024;
+
+// How often the last use of an extracted file is recorded in its mtime.
+const base::TimeDelta kExtractedFileTouchInterval =
+    base::TimeDelta::FromDays(1);
+
+// Gets the node of "path" from "index".
+uint32_t GetNodeFromPath(const base::FilePath& path,
+                         const ArchiveIndex& index) {
 #if defined(OS_WIN)
-const char kSeparators[] = "\\/";
+  return index.Lookup(path.AsUTF8Unsafe());
 #else
-const char kSeparators[] = "/";
+  return index.Lookup(path.value());
 #endif
+}
 
-bool GetNodeFromPath(std::string path,
-                     const base::DictionaryValue* root,
-                     const base::DictionaryValue** out);
-
-// Gets the "files" from "dir".
-bool GetFilesNode(const base::DictionaryValue* root,
-                  const base::DictionaryValue* dir,
-                  const base::DictionaryValue** out) {
-  // Test for symbol linked directory.
-  std::string link;
-  if (dir->GetStringWithoutPathExpansion("link", &link)) {
-    const base::DictionaryValue* linked_node = nullptr;
-    if (!GetNodeFromPath(link, root, &linked_node))
-      return false;
-    dir = linked_node;
-  }
+// Gets the folder |name| of the current user's cache directory, shared by
+// the user's processes.
+base::FilePath GetCacheDirectory(const base::FilePath::CharType* name) {
+  base::FilePath dir;
+#if defined(OS_WIN)
+  if (!PathService::Get(base::DIR_LOCAL_APP_DATA, &dir))
+    return base::FilePath();
+#else
+  if (!PathService::Get(base::DIR_CACHE, &dir))
+    return base::FilePath();
+#endif
+  return dir.Append(name);
+}
+
+// Returns whether only the current user can write to |dir|, which is trusted
+// since the files found in it are used without checking their content.
+bool IsPrivateDirectory(const base::FilePath& dir) {
+#if defined(OS_POSIX)
+  struct stat st;
+  if (lstat(dir.value().c_str(), &st) != 0 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != geteuid())
+    return false;
+  if ((st.st_mode & 0077) != 0 && chmod(dir.value().c_str(), 0700) != 0)
+    return false;
+#endif
+  return true;
+}
 
-  return dir->GetDictionaryWithoutPathExpansion("files", out);
+// Creates |dir| when missing, directories are created with 0700.
+bool PreparePrivateDirectory(const base::FilePath& dir) {
+  return base::CreateDirectory(dir) && IsPrivateDirectory(dir);
 }
 
-// Gets sub-file "name" from "dir".
-bool GetChildNode(const base::DictionaryValue* root,
-                  const std::string& name,
-                  const base::DictionaryValue* dir,
-                  const base::DictionaryValue** out) {
-  if (name == "") {
-    *out = root;
-    return true;
-  }
+// Gets where the index of the archive at |archive_path| is cached.
+base::FilePath GetIndexCachePath(const base::FilePath& archive_path) {
+  base::FilePath dir = GetCacheDirectory(FILE_PATH_LITERAL("asar-index"));
+  if (dir.empty())
+    return base::FilePath();
+  std::string hash = base::SHA1HashString(std::string(
+      reinterpret_cast<const char*>(archive_path.value().data()),
+      archive_path.value().size() * sizeof(base::FilePath::CharType)));
+  return dir.AppendASCII(
+      base::ToLowerASCII(base::HexEncode(hash.data(), hash.size())) + ".idx");
+}
 
-  const base::DictionaryValue* files = nullptr;
-  return GetFilesNode(root, dir, &files) &&
-         files->GetDictionaryWithoutPathExpansion(name, out);
+void WriteIndexCache(const base::FilePath& path, const std::string& data) {
+  if (!PreparePrivateDirectory(path.DirName()) ||
+      !base::ImportantFileWriter::WriteFileAtomically(path, data))
+    LOG(WARNING) << "Failed to write " << path.value();
 }
 
-// Gets the node of "path" from "root".
-bool GetNodeFromPath(std::string path,
-                     const base::DictionaryValue* root,
-                     const base::DictionaryValue** out) {
-  if (path == "") {
-    *out = root;
-    return true;
-  }
+// Returns whether background tasks can be posted, processes running without
+// a task scheduler, like node, leave the caches to the others.
+bool CanPostBackgroundTasks() {
+  return !!base::TaskScheduler::GetInstance();
+}
 
-  const base::DictionaryValue* dir = root;
-  for (size_t delimiter_position = path.find_first_of(kSeparators);
-       delimiter_position != std::string::npos;
-       delimiter_position = path.find_first_of(kSeparators)) {
-    const base::DictionaryValue* child = nullptr;
-    if (!GetChildNode(root, path.substr(0, delimiter_position), dir, &child))
-      return false;
+void PostBackgroundTask(base::OnceClosure task) {
+  base::PostTaskWithTraits(
+      FROM_HERE,
+      {base::MayBlock(), base::TaskPriority::BACKGROUND,
+       base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+      std::move(task));
+}
 
-    dir = child;
-    path.erase(0, delimiter_position + 1);
+// Deletes the extracted files that were not used for a while, then the
+// least recently used ones until the cache fits its size limit.
+void CleanUpExtractionCache(const base::FilePath& dir) {
+  struct CachedFile {
+    base::FilePath path;
+    base::Time last_used;
+    int64_t size;
+  };
+  std::vector<CachedFile> files;
+  int64_t total_size = 0;
+  base::Time expired = base::Time::Now() - kMaxExtractedFileAge;
+  base::FileEnumerator enumerator(dir, false, base::FileEnumerator::FILES);
+  for (base::FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next()) {
+    base::FileEnumerator::FileInfo info = enumerator.GetInfo();
+    if (info.GetLastModifiedTime() < expired) {
+      base::DeleteFile(path, false);
+      continue;
+    }
+    files.push_back({path, info.GetLastModifiedTime(), info.GetSize()});
+    total_size += info.GetSize();
   }
 
-  return GetChildNode(root, path, dir, out);
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile& a, const CachedFile& b) {
+              return a.last_used < b.last_used;
+            });
+  for (const CachedFile& file : files) {
+    if (total_size <= kMaxExtractionCacheBytes)
+      break;
+    // Files that are loaded can not be deleted on Windows.
+    if (base::DeleteFile(file.path, false))
+      total_size -= file.size;
+  }
 }
 
-bool FillFileInfoWithNode(Archive::FileInfo* info,
-                          uint32_t header_size,
-                          const base::DictionaryValue* node) {
-  int size;
-  if (!node->GetInteger("size", &size))
-    return false;
-  info->size = static_cast<uint32_t>(size);
+// Cleans up the extraction cache once per process, off the calling thread.
+void ScheduleExtractionCacheCleanUp(const base::FilePath& dir) {
+  static base::subtle::Atomic32 scheduled = 0;
+  if (!CanPostBackgroundTasks() ||
+      base::subtle::NoBarrier_CompareAndSwap(&scheduled, 0, 1) != 0)
+    return;
+  PostBackgroundTask(base::BindOnce(&CleanUpExtractionCache, dir));
+}
 
-  if (node->GetBoolean("unpacked", &info->unpacked) && info->unpacked)
-    return true;
+#if defined(OS_LINUX)
+// MFD_CLOEXEC from linux/memfd.h, which is missing in older sysroots.
+const unsigned int kMemfdCloexec = 0x0001U;
+
+// Copies |contents| into an anonymous file that only lives in memory.
+base::ScopedFD CreateMemoryFile(base::StringPiece contents) {
+#if defined(__NR_memfd_create)
+  base::ScopedFD fd(syscall(__NR_memfd_create, "asar", kMemfdCloexec));
+  if (!fd.is_valid() ||
+      !base::WriteFileDescriptor(fd.get(), contents.data(), contents.size()))
+    return base::ScopedFD();
+  return fd;
+#else
+  return base::ScopedFD();
+#endif
+}
+#endif
 
-  std::string offset;
-  if (!node->GetString("offset", &offset))
+// Inflates the raw deflate stream |input| into |output|, which must already
+// have the size of the uncompressed data.
+bool InflateBlock(base::StringPiece input, std::string* output) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
     return false;
-  if (!base::StringToUint64(offset, &info->offset))
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream.avail_out = static_cast<uInt>(output->size());
+  int result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && stream.avail_out == 0;
+}
+
+bool FillFileInfoWithNode(Archive::FileInfo* info,
+                          const ArchiveIndex::Node& node) {
+  if (node.flags & (ArchiveIndex::kDirectory |
+                    ArchiveIndex::kLink |
+                    ArchiveIndex::kMalformed))
     return false;
-  info->offset += header_size;
 
-  node->GetBoolean("executable", &info->executable);
+  info->size = node.size;
+  info->unpacked = (node.flags & ArchiveIndex::kUnpacked) != 0;
+  if (info->unpacked)
+    return true;
 
+  info->offset = node.offset;
+  info->executable = (node.flags & ArchiveIndex::kExecutable) != 0;
+  info->compressed = (node.flags & ArchiveIndex::kCompressed) != 0;
+  if (info->compressed) {
+    info->block_size = node.block_size;
+    info->first_block = node.first_block;
+    info->block_count = node.block_count;
+  }
   return true;
 }
 
@@ -128,7 +266,13 @@ Archive::Archive(const base::FilePath& path)
 #else
       fd_(-1),
 #endif
-      header_size_(0) {
+      header_size_(0),
+      archive_size_(0),
+      block_cache_(BlockCache::NO_AUTO_EVICT),
+      block_cache_bytes_(0),
+      entry_metadata_(kMaxEntryMetadataCount),
+      memory_file_bytes_(0) {
+  memset(header_hash_, 0, sizeof(header_hash_));
 }
 
 Archive::~Archive() {
@@ -175,6 +319,49 @@ bool Archive::Init() {
     return false;
   }
 
+  header_size_ = 8 + size;
+
+  // Prefer the index cached for this archive, and only parse the header when
+  // it is missing or was built from a different archive.
+  ArchiveIndex::Source source;
+  base::File::Info file_info;
+  if (file_.GetInfo(&file_info)) {
+    source.archive_size = file_info.size;
+    archive_size_ = file_info.size;
+    last_modified_ = file_info.last_modified;
+  }
+  source.header_size = header_size_;
+  base::SHA1HashBytes(reinterpret_cast<const unsigned char*>(buf.data()),
+                      buf.size(), header_hash_);
+  memcpy(source.header_hash, header_hash_, sizeof(header_hash_));
+
+  base::FilePath index_path = GetIndexCachePath(path_);
+  if (!index_path.empty() && IsPrivateDirectory(index_path.DirName()))
+    index_ = ArchiveIndex::CreateFromFile(index_path, source);
+  UMA_HISTOGRAM_BOOLEAN("Asar.HeaderCacheHit", !!index_);
+  if (!index_) {
+    if (!ParseHeader(buf))
+      return false;
+
+    // Archives are opened on the UI thread and in renderers, so the index is
+    // written in the background.
+    if (!index_path.empty() && CanPostBackgroundTasks()) {
+      PostBackgroundTask(base::BindOnce(&WriteIndexCache, index_path,
+                                        index_->Serialize(source)));
+    }
+  }
+
+  // Map the archive once so file contents can be handed out without a read
+  // per file, failing to map is not fatal since readers can still use fd_.
+  mapped_file_.reset(new base::MemoryMappedFile);
+  if (!mapped_file_->Initialize(file_.Duplicate())) {
+    LOG(WARNING) << "Failed to map " << path_.value();
+    mapped_file_.reset();
+  }
+  return true;
+}
+
+bool Archive::ParseHeader(const std::vector<char>& buf) {
   std::string header;
   if (!base::PickleIterator(base::Pickle(buf.data(), buf.size())).ReadString(
         &header)) {
@@ -182,6 +369,7 @@ bool Archive::Init() {
     return false;
   }
 
+  base::TimeTicks start = base::TimeTicks::Now();
   std::string error;
   base::JSONReader reader;
   std::unique_ptr<base::Value> value(reader.ReadToValue(header));
@@ -190,81 +378,98 @@ bool Archive::Init() {
     return false;
   }
 
-  header_size_ = 8 + size;
-  header_.reset(static_cast<base::DictionaryValue*>(value.release()));
+  // Only keep the flattened index around, the parsed tree is much larger and
+  // slower to walk.
+  index_ = ArchiveIndex::Create(
+      *static_cast<base::DictionaryValue*>(value.get()), header_size_);
+  value.reset();
+
+  UMA_HISTOGRAM_TIMES("Asar.HeaderParseTime",
+                      base::TimeTicks::Now() - start);
+  UMA_HISTOGRAM_MEMORY_KB("Asar.HeaderIndexSize",
+                          index_->GetMemoryUsage() / 1024);
+  VLOG(1) << "Indexed " << index_->node_count() << " entries of "
+          << path_.value() << " in "
+          << (base::TimeTicks::Now() - start).InMilliseconds() << "ms, "
+          << index_->GetMemoryUsage() << " bytes";
   return true;
 }
 
 bool Archive::GetFileInfo(const base::FilePath& path, FileInfo* info) {
-  if (!header_)
+  if (!index_)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  uint32_t node = GetNodeFromPath(path, *index_);
+  if (node == ArchiveIndex::kInvalidNode)
     return false;
 
-  std::string link;
-  if (node->GetString("link", &link))
-    return GetFileInfo(base::FilePath::FromUTF8Unsafe(link), info);
+  if (index_->node(node).flags & ArchiveIndex::kLink) {
+    node = index_->node(node).target;
+    if (node == ArchiveIndex::kInvalidNode)
+      return false;
+  }
 
-  return FillFileInfoWithNode(info, header_size_, node);
+  return FillFileInfoWithNode(info, index_->node(node));
 }
 
 bool Archive::Stat(const base::FilePath& path, Stats* stats) {
-  if (!header_)
+  if (!index_)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  uint32_t node = GetNodeFromPath(path, *index_);
+  if (node == ArchiveIndex::kInvalidNode)
     return false;
 
-  if (node->HasKey("link")) {
+  const ArchiveIndex::Node& entry = index_->node(node);
+  if (entry.flags & ArchiveIndex::kLink) {
     stats->is_file = false;
     stats->is_link = true;
     return true;
   }
 
-  if (node->HasKey("files")) {
+  if (entry.flags & ArchiveIndex::kDirectory) {
     stats->is_file = false;
     stats->is_directory = true;
     return true;
   }
 
-  return FillFileInfoWithNode(stats, header_size_, node);
+  return FillFileInfoWithNode(stats, entry);
 }
 
 bool Archive::Readdir(const base::FilePath& path,
                       std::vector<base::FilePath>* list) {
-  if (!header_)
+  if (!index_)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  uint32_t node = GetNodeFromPath(path, *index_);
+  if (node == ArchiveIndex::kInvalidNode)
     return false;
 
-  const base::DictionaryValue* files;
-  if (!GetFilesNode(header_.get(), node, &files))
+  uint32_t files = index_->GetFilesNode(node);
+  if (files == ArchiveIndex::kInvalidNode)
     return false;
 
-  base::DictionaryValue::Iterator iter(*files);
-  while (!iter.IsAtEnd()) {
-    list->push_back(base::FilePath::FromUTF8Unsafe(iter.key()));
-    iter.Advance();
+  const ArchiveIndex::Node& dir = index_->node(files);
+  list->reserve(list->size() + dir.child_count);
+  for (uint32_t i = 0; i < dir.child_count; ++i) {
+    base::StringPiece name =
+        index_->GetName(index_->node(dir.first_child + i));
+    list->push_back(base::FilePath::FromUTF8Unsafe(name));
   }
   return true;
 }
 
 bool Archive::Realpath(const base::FilePath& path, base::FilePath* realpath) {
-  if (!header_)
+  if (!index_)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  uint32_t node = GetNodeFromPath(path, *index_);
+  if (node == ArchiveIndex::kInvalidNode)
     return false;
 
-  std::string link;
-  if (node->GetString("link", &link)) {
-    *realpath = base::FilePath::FromUTF8Unsafe(link);
+  const ArchiveIndex::Node& entry = index_->node(node);
+  if (entry.flags & ArchiveIndex::kLink) {
+    *realpath = base::FilePath::FromUTF8Unsafe(index_->GetLinkPath(entry));
     return true;
   }
 
@@ -272,11 +477,168 @@ bool Archive::Realpath(const base::FilePath& path, base::FilePath* realpath) {
   return true;
 }
 
-bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
-  auto it = external_files_.find(path.value());
-  if (it != external_files_.end()) {
-    *out = it->second->path();
+bool Archive::GetFileContents(const FileInfo& info,
+                              base::StringPiece* contents) const {
+  if (!mapped_file_ || info.unpacked || info.compressed)
+    return false;
+
+  if (info.offset > mapped_file_->length() ||
+      info.size > mapped_file_->length() - info.offset)
+    return false;
+
+  *contents = base::StringPiece(
+      reinterpret_cast<const char*>(mapped_file_->data()) + info.offset,
+      info.size);
+  return true;
+}
+
+bool Archive::GetEntryMetadata(const base::FilePath& path,
+                               const FileInfo& info,
+                               EntryMetadata* metadata) {
+  if (info.unpacked)
+    return false;
+
+  if (GetCachedEntryMetadata(path, metadata))
     return true;
+
+  EntryMetadata result;
+  net::GetMimeTypeFromFile(path, &result.mime_type);
+  result.etag = "\"" + GetEntryHash(info) + "\"";
+
+  base::AutoLock auto_lock(entry_metadata_lock_);
+  entry_metadata_.Put(path.value(), result);
+  *metadata = result;
+  return true;
+}
+
+bool Archive::GetCachedEntryMetadata(const base::FilePath& path,
+                                     EntryMetadata* metadata) {
+  base::AutoLock auto_lock(entry_metadata_lock_);
+  auto it = entry_metadata_.Get(path.value());
+  if (it == entry_metadata_.end())
+    return false;
+  *metadata = it->second;
+  return true;
+}
+
+int Archive::ReadFile(const FileInfo& info,
+                      uint64_t position,
+                      char* data,
+                      int size) {
+  if (info.unpacked || size < 0)
+    return -1;
+  if (position >= info.size)
+    return 0;
+
+  size = static_cast<int>(
+      std::min<uint64_t>(size, info.size - position));
+  if (!info.compressed)
+    return Read(info.offset + position, data, size);
+
+  int copied = 0;
+  while (copied < size) {
+    uint64_t current = position + copied;
+    std::shared_ptr<const std::string> block = GetDecompressedBlock(
+        info, static_cast<uint32_t>(current / info.block_size));
+    size_t block_offset = static_cast<size_t>(current % info.block_size);
+    if (!block || block_offset >= block->size())
+      return -1;
+
+    size_t length = std::min(static_cast<size_t>(size - copied),
+                             block->size() - block_offset);
+    memcpy(data + copied, block->data() + block_offset, length);
+    copied += static_cast<int>(length);
+  }
+  return copied;
+}
+
+std::shared_ptr<const std::string> Archive::GetDecompressedBlock(
+    const FileInfo& info, uint32_t block) {
+  if (block >= info.block_count)
+    return nullptr;
+
+  uint32_t begin =
+      block == 0 ? 0 : index_->block_end(info.first_block + block - 1);
+  uint32_t end = index_->block_end(info.first_block + block);
+  uint64_t offset = info.offset + begin;
+  {
+    base::AutoLock auto_lock(block_cache_lock_);
+    auto it = block_cache_.Get(offset);
+    if (it != block_cache_.end())
+      return it->second;
+  }
+
+  // Decompress outside the lock so readers of other blocks are not held up,
+  // two threads racing for the same block just both decompress it.
+  std::string buffer;
+  base::StringPiece input;
+  if (end <= begin || !ReadRange(offset, end - begin, &buffer, &input))
+    return nullptr;
+
+  uint64_t block_start = static_cast<uint64_t>(block) * info.block_size;
+  std::shared_ptr<std::string> output(new std::string);
+  output->resize(static_cast<size_t>(
+      std::min<uint64_t>(info.block_size, info.size - block_start)));
+  if (!InflateBlock(input, output.get())) {
+    LOG(ERROR) << "Failed to decompress block at " << offset << " of "
+               << path_.value();
+    return nullptr;
+  }
+
+  base::AutoLock auto_lock(block_cache_lock_);
+  if (block_cache_.Peek(offset) == block_cache_.end()) {
+    block_cache_.Put(offset, output);
+    block_cache_bytes_ += output->size();
+    while (block_cache_bytes_ > kMaxBlockCacheBytes &&
+           block_cache_.size() > 1) {
+      auto oldest = block_cache_.rbegin();
+      block_cache_bytes_ -= oldest->second->size();
+      block_cache_.Erase(oldest);
+    }
+  }
+  return output;
+}
+
+int Archive::Read(uint64_t offset, char* data, int size) {
+  if (!mapped_file_)
+    return file_.Read(offset, data, size);
+
+  if (size < 0 || offset > mapped_file_->length())
+    return -1;
+
+  size_t length = std::min(static_cast<size_t>(size),
+                           mapped_file_->length() - offset);
+  memcpy(data, mapped_file_->data() + offset, length);
+  return static_cast<int>(length);
+}
+
+bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
+  return CopyFileOutImpl(path, false, out);
+}
+
+bool Archive::CopyFileOutForReading(const base::FilePath& path,
+                                    base::FilePath* out) {
+  return CopyFileOutImpl(path, true, out);
+}
+
+bool Archive::CopyFileOutImpl(const base::FilePath& path,
+                              bool allow_memory_file,
+                              base::FilePath* out) {
+  {
+    base::AutoLock auto_lock(external_files_lock_);
+    auto it = external_files_.find(path.value());
+    if (it != external_files_.end()) {
+      *out = it->second;
+      return true;
+    }
+
+    if (allow_memory_file) {
+      it = memory_file_paths_.find(path.value());
+      if (it != memory_file_paths_.end()) {
+        *out = it->second;
+        return true;
+      }
+    }
   }
 
   FileInfo info;
@@ -288,10 +650,63 @@ bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
     return true;
   }
 
+  // The copy is made without holding the lock so that other files can be
+  // looked up meanwhile, when two threads race for the same file the first
+  // copy wins and the other one is dropped.
+#if defined(OS_LINUX)
+  // Callers that only need the file in this process get small files from
+  // memory without touching the disk. The memory is held until the archive
+  // is closed, so it is reserved up front within a bound.
+  bool use_memory_file = false;
+  if (allow_memory_file && info.size <= kMaxMemoryFileSize) {
+    base::AutoLock auto_lock(external_files_lock_);
+    if (memory_file_bytes_ + info.size <= kMaxMemoryFileBytes) {
+      memory_file_bytes_ += info.size;
+      use_memory_file = true;
+    }
+  }
+  if (use_memory_file) {
+    std::string buffer;
+    base::StringPiece contents;
+    base::ScopedFD fd;
+    if (ReadFileContents(info, &buffer, &contents))
+      fd = CreateMemoryFile(contents);
+    base::AutoLock auto_lock(external_files_lock_);
+    if (fd.is_valid()) {
+      base::FilePath fd_path = base::FilePath("/proc/self/fd").Append(
+          base::IntToString(fd.get()));
+      auto result = memory_file_paths_.emplace(path.value(), fd_path);
+      if (result.second)
+        memory_files_.push_back(std::move(fd));
+      else
+        memory_file_bytes_ -= info.size;
+      *out = result.first->second;
+      return true;
+    }
+    memory_file_bytes_ -= info.size;
+  }
+#endif
+
+  base::FilePath cached_path;
+  if (CopyFileOutToCache(path, info, &cached_path)) {
+    base::AutoLock auto_lock(external_files_lock_);
+    *out = external_files_.emplace(path.value(), cached_path).first->second;
+    return true;
+  }
+
   std::unique_ptr<ScopedTemporaryFile> temp_file(new ScopedTemporaryFile);
   base::FilePath::StringType ext = path.Extension();
-  if (!temp_file->InitFromFile(&file_, ext, info.offset, info.size))
+  if (info.compressed) {
+    std::string buffer;
+    base::StringPiece contents;
+    if (!ReadFileContents(info, &buffer, &contents) ||
+        !temp_file->Init(ext) ||
+        base::WriteFile(temp_file->path(), contents.data(), contents.size()) !=
+            static_cast<int>(contents.size()))
+      return false;
+  } else if (!temp_file->InitFromFile(&file_, ext, info.offset, info.size)) {
     return false;
+  }
 
 #if defined(OS_POSIX)
   if (info.executable) {
@@ -300,8 +715,120 @@ bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
   }
 #endif
 
-  *out = temp_file->path();
-  external_files_[path.value()] = std::move(temp_file);
+  base::AutoLock auto_lock(external_files_lock_);
+  auto result = external_files_.emplace(path.value(), temp_file->path());
+  if (result.second)
+    temporary_files_.push_back(std::move(temp_file));
+  *out = result.first->second;
+  return true;
+}
+
+std::string Archive::GetEntryHash(const FileInfo& info) const {
+  // Made of the archive and the entry's place in it, which is cheap to
+  // compute on every launch, so that a rebuilt archive never matches.
+  base::Pickle key;
+  key.WriteBytes(header_hash_, sizeof(header_hash_));
+  key.WriteInt64(archive_size_);
+  key.WriteInt64(last_modified_.ToInternalValue());
+  key.WriteUInt64(info.offset);
+  key.WriteUInt32(info.size);
+  key.WriteBool(info.compressed);
+  unsigned char hash[base::kSHA1Length];
+  base::SHA1HashBytes(static_cast<const unsigned char*>(key.data()),
+                      key.size(), hash);
+  return base::ToLowerASCII(base::HexEncode(hash, sizeof(hash)));
+}
+
+bool Archive::CopyFileOutToCache(const base::FilePath& path,
+                                 const FileInfo& info,
+                                 base::FilePath* out) {
+  base::FilePath dir = GetCacheDirectory(FILE_PATH_LITERAL("asar-cache"));
+  if (dir.empty() || !PreparePrivateDirectory(dir))
+    return false;
+  ScheduleExtractionCacheCleanUp(dir);
+
+  // Only the current user can write to the directory, so the files found
+  // there are trusted.
+  std::string name = GetEntryHash(info);
+  if (info.executable)
+    name += "-x";
+  base::FilePath cached_path =
+      dir.AppendASCII(name).AddExtension(path.Extension());
+
+  base::File::Info file_info;
+  if (base::GetFileInfo(cached_path, &file_info) &&
+      !file_info.is_directory && !file_info.is_symbolic_link &&
+      file_info.size == static_cast<int64_t>(info.size)) {
+    // Record the use so that the clean up keeps the file.
+    base::Time now = base::Time::Now();
+    if (now - file_info.last_modified > kExtractedFileTouchInterval)
+      base::TouchFile(cached_path, now, now);
+    *out = cached_path;
+    return true;
+  }
+
+  std::string buffer;
+  base::StringPiece contents;
+  if (!ReadFileContents(info, &buffer, &contents))
+    return false;
+
+  // The temporary file is created exclusively, and only renamed into place
+  // once it is complete.
+  base::FilePath temp_path;
+  if (!base::CreateTemporaryFileInDir(dir, &temp_path))
+    return false;
+
+  bool success = base::WriteFile(temp_path, contents.data(), contents.size()) ==
+                 static_cast<int>(contents.size());
+#if defined(OS_POSIX)
+  success = success &&
+      base::SetPosixFilePermissions(temp_path, info.executable ? 0700 : 0600);
+#endif
+  if (!success || !base::ReplaceFile(temp_path, cached_path, nullptr)) {
+    base::DeleteFile(temp_path, false);
+    // Another process might have extracted the same file meanwhile, e.g. on
+    // Windows the file can not be replaced while it is loaded.
+    int64_t size;
+    if (!base::GetFileSize(cached_path, &size) ||
+        size != static_cast<int64_t>(info.size))
+      return false;
+  }
+
+  *out = cached_path;
+  return true;
+}
+
+bool Archive::ReadFileContents(const FileInfo& info,
+                               std::string* buffer,
+                               base::StringPiece* contents) {
+  if (GetFileContents(info, contents))
+    return true;
+
+  buffer->resize(info.size);
+  if (ReadFile(info, 0, &(*buffer)[0], info.size) !=
+      static_cast<int>(info.size))
+    return false;
+  *contents = *buffer;
+  return true;
+}
+
+bool Archive::ReadRange(uint64_t offset,
+                        uint32_t size,
+                        std::string* buffer,
+                        base::StringPiece* contents) {
+  if (mapped_file_) {
+    if (offset > mapped_file_->length() ||
+        size > mapped_file_->length() - offset)
+      return false;
+    *contents = base::StringPiece(
+        reinterpret_cast<const char*>(mapped_file_->data()) + offset, size);
+    return true;
+  }
+
+  buffer->resize(size);
+  if (file_.Read(offset, &(*buffer)[0], size) != static_cast<int>(size))
+    return false;
+  *contents = *buffer;
   return true;
 }
 
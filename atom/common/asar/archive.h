@@ -6,18 +6,26 @@
 #define ATOM_COMMON_ASAR_ARCHIVE_H_
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "base/containers/mru_cache.h"
 #include "base/files/file.h"
 #include "base/files/file_path.h"
+#include "base/files/scoped_file.h"
+#include "base/sha1.h"
+#include "base/synchronization/lock.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
 
 namespace base {
-class DictionaryValue;
+class MemoryMappedFile;
 }
 
 namespace asar {
 
+class ArchiveIndex;
 class ScopedTemporaryFile;
 
 // This class represents an asar package, and provides methods to read
@@ -25,11 +33,19 @@ class ScopedTemporaryFile;
 class Archive {
  public:
   struct FileInfo {
-    FileInfo() : unpacked(false), executable(false), size(0), offset(0) {}
+    FileInfo()
+        : unpacked(false), executable(false), compressed(false), size(0),
+          offset(0), block_size(0), first_block(0), block_count(0) {}
     bool unpacked;
     bool executable;
+    bool compressed;
+    // The uncompressed size of the file.
     uint32_t size;
     uint64_t offset;
+    // The blocks of a compressed file, see ArchiveIndex::Node.
+    uint32_t block_size;
+    uint32_t first_block;
+    uint32_t block_count;
   };
 
   struct Stats : public FileInfo {
@@ -39,6 +55,13 @@ class Archive {
     bool is_link;
   };
 
+  // Response metadata of a packed file.
+  struct EntryMetadata {
+    std::string mime_type;
+    // A strong ETag derived from the archive and the place of the file in it.
+    std::string etag;
+  };
+
   explicit Archive(const base::FilePath& path);
   virtual ~Archive();
 
@@ -57,27 +80,129 @@ class Archive {
   // Fs.realpath(path).
   bool Realpath(const base::FilePath& path, base::FilePath* realpath);
 
-  // Copy the file into a temporary file, and return the new path.
-  // For unpacked file, this method will return its real path.
+  // Get a read-only view of the content of a packed file inside the mapped
+  // archive. The view stays valid for the lifetime of the archive. Returns
+  // false for unpacked and compressed files or when the archive could not be
+  // mapped.
+  bool GetFileContents(const FileInfo& info, base::StringPiece* contents) const;
+
+  // Get the content of a packed file, from the mapping when possible and
+  // otherwise decompressed or read into |buffer|.
+  bool ReadFileContents(const FileInfo& info,
+                        std::string* buffer,
+                        base::StringPiece* contents);
+
+  // Read up to |size| bytes at |position| of the packed file described by
+  // |info| into |data|, decompressing compressed files on the fly. Safe to
+  // call from any thread. Returns the number of bytes read, or -1 on error.
+  int ReadFile(const FileInfo& info, uint64_t position, char* data, int size);
+
+  // Get the metadata of the packed file |path| described by |info|. It is
+  // computed on first use, which may look up the MIME type on disk and should
+  // happen off the IO thread, and memoized for the most recently used files
+  // afterwards.
+  bool GetEntryMetadata(const base::FilePath& path,
+                        const FileInfo& info,
+                        EntryMetadata* metadata);
+
+  // Same with GetEntryMetadata but only returns memoized metadata, so it is
+  // safe to call on any thread.
+  bool GetCachedEntryMetadata(const base::FilePath& path,
+                              EntryMetadata* metadata);
+
+  // Copy the file out of the archive, and return the new path.
+  // Files are extracted once into a cache directory of the current user
+  // shared by its processes, falling back to a temporary file when the cache
+  // is not usable. For unpacked file, this method will return its real path.
   bool CopyFileOut(const base::FilePath& path, base::FilePath* out);
 
+  // Same with CopyFileOut, but for callers that only open the returned path
+  // in the current process, like fs.open. On Linux small files are copied
+  // into an anonymous memory file instead of the disk.
+  bool CopyFileOutForReading(const base::FilePath& path, base::FilePath* out);
+
   // Returns the file's fd.
   int GetFD() const;
 
   base::FilePath path() const { return path_; }
-  base::DictionaryValue* header() const { return header_.get(); }
+  base::Time last_modified() const { return last_modified_; }
+  const ArchiveIndex* index() const { return index_.get(); }
 
  private:
+  // Parse the JSON header read from the archive and build index_ from it.
+  bool ParseHeader(const std::vector<char>& buf);
+
+  // Read up to |size| bytes at |offset| of the archive into |data|, copying
+  // from the mapping when the archive is mapped.
+  int Read(uint64_t offset, char* data, int size);
+
+  // Get |size| bytes at |offset| of the archive, from the mapping when
+  // possible and otherwise read into |buffer|.
+  bool ReadRange(uint64_t offset,
+                 uint32_t size,
+                 std::string* buffer,
+                 base::StringPiece* contents);
+
+  // Get the decompressed content of |block| of a compressed file, from the
+  // block cache when possible.
+  std::shared_ptr<const std::string> GetDecompressedBlock(const FileInfo& info,
+                                                          uint32_t block);
+
+  bool CopyFileOutImpl(const base::FilePath& path,
+                       bool allow_memory_file,
+                       base::FilePath* out);
+
+  // Identify the entry described by |info| across launches, changing
+  // whenever the archive is rebuilt. Returns a lower case hex SHA1.
+  std::string GetEntryHash(const FileInfo& info) const;
+
+  // Copy the file into the extraction cache directory.
+  bool CopyFileOutToCache(const base::FilePath& path,
+                          const FileInfo& info,
+                          base::FilePath* out);
+
   base::FilePath path_;
   base::File file_;
   int fd_;
   uint32_t header_size_;
-  std::unique_ptr<base::DictionaryValue> header_;
-
-  // Cached external temporary files.
-  std::unordered_map
-    <base::FilePath::StringType, std::unique_ptr<ScopedTemporaryFile>>
+  // Identify the archive in the names of extracted files.
+  unsigned char header_hash_[base::kSHA1Length];
+  int64_t archive_size_;
+  base::Time last_modified_;
+  std::unique_ptr<ArchiveIndex> index_;
+
+  // The whole archive mapped read-only, shared by all readers.
+  std::unique_ptr<base::MemoryMappedFile> mapped_file_;
+
+  // Recently decompressed blocks keyed by their offset in the archive, bounded
+  // by |block_cache_bytes_| and guarded by |block_cache_lock_|.
+  typedef base::MRUCache<uint64_t, std::shared_ptr<const std::string>>
+      BlockCache;
+  base::Lock block_cache_lock_;
+  BlockCache block_cache_;
+  size_t block_cache_bytes_;
+
+  // Memoized metadata of recently used packed files, guarded by
+  // |entry_metadata_lock_|.
+  typedef base::HashingMRUCache<base::FilePath::StringType, EntryMetadata>
+      EntryMetadataCache;
+  base::Lock entry_metadata_lock_;
+  EntryMetadataCache entry_metadata_;
+
+  // Paths of files copied out of the archive, and the temporary files and
+  // memory files backing some of them, guarded by |external_files_lock_|
+  // since archives are shared between threads.
+  base::Lock external_files_lock_;
+  std::unordered_map<base::FilePath::StringType, base::FilePath>
       external_files_;
+  std::unordered_map<base::FilePath::StringType, base::FilePath>
+      memory_file_paths_;
+  std::vector<std::unique_ptr<ScopedTemporaryFile>> temporary_files_;
+#if defined(OS_LINUX)
+  std::vector<base::ScopedFD> memory_files_;
+#endif
+  // Bytes held by |memory_files_|, which stay until the archive is closed.
+  size_t memory_file_bytes_;
 
   DISALLOW_COPY_AND_ASSIGN(Archive);
 };
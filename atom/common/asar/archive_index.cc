@@ -0,0 +1,454 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/common/asar/archive_index.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/values.h"
+
+namespace asar {
+
+namespace {
+
+#if defined(OS_WIN)
+const char kSeparators[] = "\\/";
+#else
+const char kSeparators[] = "/";
+#endif
+
+// "ASRI" in little endian.
+const uint32_t kCacheMagic = 0x49525341;
+// Bump whenever the layout of the cache file or of ArchiveIndex::Node
+// changes.
+const uint32_t kCacheVersion = 3;
+
+// The only compression supported for packed files, raw deflate streams.
+const char kDeflate[] = "deflate";
+
+// The header of a cached index file, followed by the node array, the block
+// table and the string pool.
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t archive_size;
+  uint32_t header_size;
+  uint32_t node_size;
+  uint64_t node_count;
+  uint64_t block_count;
+  uint64_t names_size;
+  unsigned char header_hash[base::kSHA1Length];
+  uint32_t padding;
+};
+
+static_assert(sizeof(CacheHeader) % sizeof(uint64_t) == 0,
+              "nodes following the cache header must stay aligned");
+
+typedef std::pair<base::StringPiece, const base::DictionaryValue*> Child;
+
+bool CompareChildren(const Child& a, const Child& b) {
+  return a.first < b.first;
+}
+
+// Appends strings to a pool, storing every distinct string only once.
+class StringPoolBuilder {
+ public:
+  explicit StringPoolBuilder(std::string* pool) : pool_(pool) {}
+
+  // Returns the offset of |str| in the pool.
+  uint32_t Intern(base::StringPiece str) {
+    std::string key = str.as_string();
+    auto it = offsets_.find(key);
+    if (it != offsets_.end())
+      return it->second;
+
+    uint32_t offset = static_cast<uint32_t>(pool_->size());
+    str.AppendToString(pool_);
+    offsets_[key] = offset;
+    return offset;
+  }
+
+ private:
+  std::string* pool_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringPoolBuilder);
+};
+
+ArchiveIndex::Node CreateNode() {
+  // Nodes are written to the index file as they are, so zero their padding
+  // too.
+  ArchiveIndex::Node node;
+  memset(&node, 0, sizeof(node));
+  node.target = ArchiveIndex::kInvalidNode;
+  return node;
+}
+
+// Reads the "compression" entry of a packed file, which stores the file as
+// blocks of "blockSize" bytes that are deflated separately, and lists the
+// compressed size of every block in "blocks":
+//   {"algorithm": "deflate", "blockSize": 65536, "blocks": [1234, 987]}
+bool ReadCompression(const base::DictionaryValue& compression,
+                     ArchiveIndex::Node* node,
+                     std::vector<uint32_t>* blocks) {
+  std::string algorithm;
+  int block_size;
+  const base::ListValue* sizes = nullptr;
+  if (!compression.GetString("algorithm", &algorithm) ||
+      algorithm != kDeflate ||
+      !compression.GetInteger("blockSize", &block_size) ||
+      block_size <= 0 ||
+      !compression.GetList("blocks", &sizes))
+    return false;
+
+  uint64_t expected_count =
+      (static_cast<uint64_t>(node->size) + block_size - 1) / block_size;
+  if (sizes->GetSize() != expected_count)
+    return false;
+
+  node->block_size = static_cast<uint32_t>(block_size);
+  node->first_block = static_cast<uint32_t>(blocks->size());
+  node->block_count = static_cast<uint32_t>(expected_count);
+
+  uint64_t end = 0;
+  for (size_t i = 0; i < sizes->GetSize(); ++i) {
+    int size;
+    if (!sizes->GetInteger(i, &size) || size <= 0)
+      return false;
+    end += size;
+    if (end > std::numeric_limits<uint32_t>::max())
+      return false;
+    blocks->push_back(static_cast<uint32_t>(end));
+  }
+  return true;
+}
+
+void FillFileNode(const base::DictionaryValue& value,
+                  uint32_t header_size,
+                  ArchiveIndex::Node* node,
+                  std::vector<uint32_t>* blocks) {
+  int size;
+  if (!value.GetInteger("size", &size)) {
+    node->flags |= ArchiveIndex::kMalformed;
+    return;
+  }
+  node->size = static_cast<uint32_t>(size);
+
+  bool unpacked = false;
+  if (value.GetBoolean("unpacked", &unpacked) && unpacked) {
+    node->flags |= ArchiveIndex::kUnpacked;
+    return;
+  }
+
+  std::string offset;
+  if (!value.GetString("offset", &offset) ||
+      !base::StringToUint64(offset, &node->offset)) {
+    node->flags |= ArchiveIndex::kMalformed;
+    return;
+  }
+  node->offset += header_size;
+
+  bool executable = false;
+  if (value.GetBoolean("executable", &executable) && executable)
+    node->flags |= ArchiveIndex::kExecutable;
+
+  // Files of an unknown compression can not be read, so treat them as
+  // malformed rather than handing out their compressed bytes.
+  const base::DictionaryValue* compression = nullptr;
+  if (value.GetDictionary("compression", &compression)) {
+    size_t block_table_size = blocks->size();
+    if (ReadCompression(*compression, node, blocks)) {
+      node->flags |= ArchiveIndex::kCompressed;
+    } else {
+      blocks->resize(block_table_size);
+      node->flags |= ArchiveIndex::kMalformed;
+    }
+  }
+}
+
+}  // namespace
+
+ArchiveIndex::Source::Source()
+    : archive_size(0), header_size(0) {
+  memset(header_hash, 0, sizeof(header_hash));
+}
+
+ArchiveIndex::ArchiveIndex()
+    : nodes_(nullptr), node_count_(0), blocks_(nullptr), block_count_(0) {
+}
+
+ArchiveIndex::~ArchiveIndex() {
+}
+
+// static
+std::unique_ptr<ArchiveIndex> ArchiveIndex::Create(
+    const base::DictionaryValue& header, uint32_t header_size) {
+  std::unique_ptr<ArchiveIndex> index(new ArchiveIndex);
+  StringPoolBuilder names(&index->owned_names_);
+  std::vector<uint32_t> links;
+
+  // Walk the header breadth first, so the children of every directory are
+  // appended to the node array next to each other.
+  std::deque<std::pair<uint32_t, const base::DictionaryValue*>> pending;
+  index->owned_nodes_.push_back(CreateNode());
+  pending.push_back(std::make_pair(kRootNode, &header));
+
+  while (!pending.empty()) {
+    uint32_t current = pending.front().first;
+    const base::DictionaryValue* value = pending.front().second;
+    pending.pop_front();
+
+    std::string link;
+    const base::DictionaryValue* files = nullptr;
+    if (value->GetStringWithoutPathExpansion("link", &link)) {
+      Node* node = &index->owned_nodes_[current];
+      node->flags |= kLink;
+      node->link_offset = names.Intern(link);
+      node->link_size = static_cast<uint32_t>(link.size());
+      links.push_back(current);
+    } else if (value->GetDictionaryWithoutPathExpansion("files", &files)) {
+      std::vector<Child> children;
+      for (base::DictionaryValue::Iterator it(*files);
+           !it.IsAtEnd(); it.Advance()) {
+        const base::DictionaryValue* child = nullptr;
+        if (it.value().GetAsDictionary(&child))
+          children.push_back(Child(it.key(), child));
+      }
+      std::sort(children.begin(), children.end(), CompareChildren);
+
+      Node* node = &index->owned_nodes_[current];
+      node->flags |= kDirectory;
+      node->first_child = static_cast<uint32_t>(index->owned_nodes_.size());
+      node->child_count = static_cast<uint32_t>(children.size());
+
+      for (const Child& child : children) {
+        Node child_node = CreateNode();
+        child_node.name_offset = names.Intern(child.first);
+        child_node.name_size = static_cast<uint32_t>(child.first.size());
+        pending.push_back(std::make_pair(
+            static_cast<uint32_t>(index->owned_nodes_.size()), child.second));
+        index->owned_nodes_.push_back(child_node);
+      }
+    } else {
+      FillFileNode(*value, header_size, &index->owned_nodes_[current],
+                   &index->owned_blocks_);
+    }
+  }
+
+  index->owned_nodes_.shrink_to_fit();
+  index->owned_blocks_.shrink_to_fit();
+  index->owned_names_.shrink_to_fit();
+  index->nodes_ = index->owned_nodes_.data();
+  index->node_count_ = index->owned_nodes_.size();
+  index->blocks_ = index->owned_blocks_.data();
+  index->block_count_ = index->owned_blocks_.size();
+  index->names_ = index->owned_names_;
+
+  index->ResolveLinks(links);
+  return index;
+}
+
+// static
+std::unique_ptr<ArchiveIndex> ArchiveIndex::CreateFromFile(
+    const base::FilePath& path, const Source& source) {
+  if (!base::PathExists(path))
+    return nullptr;
+
+  std::unique_ptr<base::MemoryMappedFile> mapped_file(
+      new base::MemoryMappedFile);
+  if (!mapped_file->Initialize(path))
+    return nullptr;
+
+  if (mapped_file->length() < sizeof(CacheHeader))
+    return nullptr;
+
+  const CacheHeader* header =
+      reinterpret_cast<const CacheHeader*>(mapped_file->data());
+  if (header->magic != kCacheMagic ||
+      header->version != kCacheVersion ||
+      header->node_size != sizeof(Node) ||
+      header->archive_size != source.archive_size ||
+      header->header_size != source.header_size ||
+      memcmp(header->header_hash, source.header_hash,
+             sizeof(source.header_hash)) != 0)
+    return nullptr;
+
+  size_t length = mapped_file->length() - sizeof(CacheHeader);
+  if (header->node_count == 0 ||
+      header->node_count > length / sizeof(Node))
+    return nullptr;
+  length -= header->node_count * sizeof(Node);
+  if (header->block_count > length / sizeof(uint32_t))
+    return nullptr;
+  length -= header->block_count * sizeof(uint32_t);
+  if (header->names_size != length)
+    return nullptr;
+
+  const uint8_t* data = mapped_file->data() + sizeof(CacheHeader);
+  const uint8_t* blocks = data + header->node_count * sizeof(Node);
+  std::unique_ptr<ArchiveIndex> index(new ArchiveIndex);
+  index->nodes_ = reinterpret_cast<const Node*>(data);
+  index->node_count_ = static_cast<size_t>(header->node_count);
+  index->blocks_ = reinterpret_cast<const uint32_t*>(blocks);
+  index->block_count_ = static_cast<size_t>(header->block_count);
+  index->names_ = base::StringPiece(
+      reinterpret_cast<const char*>(
+          blocks + header->block_count * sizeof(uint32_t)),
+      static_cast<size_t>(header->names_size));
+  index->mapped_file_ = std::move(mapped_file);
+
+  if (!index->IsValid()) {
+    LOG(WARNING) << "Ignoring corrupted asar index " << path.value();
+    return nullptr;
+  }
+  return index;
+}
+
+std::string ArchiveIndex::Serialize(const Source& source) const {
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kCacheMagic;
+  header.version = kCacheVersion;
+  header.archive_size = source.archive_size;
+  header.header_size = source.header_size;
+  header.node_size = sizeof(Node);
+  header.node_count = node_count_;
+  header.block_count = block_count_;
+  header.names_size = names_.size();
+  memcpy(header.header_hash, source.header_hash, sizeof(header.header_hash));
+
+  std::string data;
+  data.reserve(sizeof(header) + node_count_ * sizeof(Node) +
+               block_count_ * sizeof(uint32_t) + names_.size());
+  data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  data.append(reinterpret_cast<const char*>(nodes_),
+              node_count_ * sizeof(Node));
+  data.append(reinterpret_cast<const char*>(blocks_),
+              block_count_ * sizeof(uint32_t));
+  names_.AppendToString(&data);
+  return data;
+}
+
+uint32_t ArchiveIndex::Lookup(base::StringPiece path) const {
+  if (path.empty())
+    return kRootNode;
+
+  uint32_t dir = kRootNode;
+  for (size_t delimiter_position = path.find_first_of(kSeparators);
+       delimiter_position != base::StringPiece::npos;
+       delimiter_position = path.find_first_of(kSeparators)) {
+    dir = GetChild(dir, path.substr(0, delimiter_position));
+    if (dir == kInvalidNode)
+      return kInvalidNode;
+
+    path.remove_prefix(delimiter_position + 1);
+  }
+
+  return GetChild(dir, path);
+}
+
+uint32_t ArchiveIndex::GetFilesNode(uint32_t index) const {
+  if (nodes_[index].flags & kLink)
+    index = nodes_[index].target;
+  if (index == kInvalidNode || !(nodes_[index].flags & kDirectory))
+    return kInvalidNode;
+  return index;
+}
+
+size_t ArchiveIndex::GetMemoryUsage() const {
+  return sizeof(*this) + node_count_ * sizeof(Node) +
+         block_count_ * sizeof(uint32_t) + names_.size();
+}
+
+uint32_t ArchiveIndex::GetChild(uint32_t dir, base::StringPiece name) const {
+  // An empty component refers to the root, e.g. "a//b" and "a/".
+  if (name.empty())
+    return kRootNode;
+
+  uint32_t files = GetFilesNode(dir);
+  if (files == kInvalidNode)
+    return kInvalidNode;
+
+  const Node& parent = nodes_[files];
+  const Node* begin = nodes_ + parent.first_child;
+  const Node* end = begin + parent.child_count;
+  const Node* it = std::lower_bound(begin, end, name,
+      [this](const Node& node, const base::StringPiece& value) {
+        return GetName(node) < value;
+      });
+  if (it == end || GetName(*it) != name)
+    return kInvalidNode;
+  return static_cast<uint32_t>(it - nodes_);
+}
+
+void ArchiveIndex::ResolveLinks(const std::vector<uint32_t>& links) {
+  // Links can point into linked directories or to other links, so keep
+  // resolving until a pass makes no progress. Links left unresolved are
+  // dangling or part of a cycle.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint32_t link : links) {
+      if (nodes_[link].target != kInvalidNode)
+        continue;
+
+      uint32_t target = Lookup(GetLinkPath(nodes_[link]));
+      if (target != kInvalidNode && (nodes_[target].flags & kLink))
+        target = nodes_[target].target;
+      if (target == kInvalidNode)
+        continue;
+
+      owned_nodes_[link].target = target;
+      changed = true;
+    }
+  }
+}
+
+bool ArchiveIndex::IsValid() const {
+  if (node_count_ == 0 || !(nodes_[kRootNode].flags & kDirectory))
+    return false;
+
+  for (size_t i = 0; i < node_count_; ++i) {
+    const Node& node = nodes_[i];
+    if (node.name_offset > names_.size() ||
+        node.name_size > names_.size() - node.name_offset ||
+        node.link_offset > names_.size() ||
+        node.link_size > names_.size() - node.link_offset)
+      return false;
+
+    if ((node.flags & kDirectory) &&
+        (node.first_child <= i ||
+         node.first_child > node_count_ ||
+         node.child_count > node_count_ - node.first_child))
+      return false;
+
+    if ((node.flags & kCompressed) &&
+        (node.block_size == 0 ||
+         node.first_block > block_count_ ||
+         node.block_count > block_count_ - node.first_block ||
+         node.block_count !=
+             (static_cast<uint64_t>(node.size) + node.block_size - 1) /
+                 node.block_size))
+      return false;
+
+    // Links always point to their final node.
+    if (node.target != kInvalidNode &&
+        (node.target >= node_count_ || (nodes_[node.target].flags & kLink)))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace asar
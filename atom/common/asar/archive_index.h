@@ -0,0 +1,153 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_COMMON_ASAR_ARCHIVE_INDEX_H_
+#define ATOM_COMMON_ASAR_ARCHIVE_INDEX_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/sha1.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+class DictionaryValue;
+class FilePath;
+class MemoryMappedFile;
+}
+
+namespace asar {
+
+// A flattened, read-only index of an asar header.
+//
+// All nodes live in one array in which the children of every directory are
+// stored contiguously and sorted by name, and all names share one interned
+// string pool. Looking up a path is a binary search per path component and
+// does not allocate. Links are resolved to their final node when the index is
+// built.
+//
+// The index can be written to disk and mapped back in place by later
+// processes, which saves them from parsing the JSON header again.
+class ArchiveIndex {
+ public:
+  static const uint32_t kInvalidNode = 0xFFFFFFFF;
+  static const uint32_t kRootNode = 0;
+
+  enum NodeFlags : uint32_t {
+    kDirectory = 1 << 0,
+    kLink = 1 << 1,
+    kUnpacked = 1 << 2,
+    kExecutable = 1 << 3,
+    // A file entry with a missing or invalid size or offset.
+    kMalformed = 1 << 4,
+    // A packed file stored as independently deflated blocks.
+    kCompressed = 1 << 5,
+  };
+
+  struct Node {
+    // Absolute offset of a packed file in the archive.
+    uint64_t offset;
+    uint32_t flags;
+    uint32_t size;
+    // The name of the node in the string pool.
+    uint32_t name_offset;
+    uint32_t name_size;
+    // The range of children of a directory in the node array.
+    uint32_t first_child;
+    uint32_t child_count;
+    // The link path of a link in the string pool, and the node it finally
+    // points to, which is kInvalidNode for dangling links.
+    uint32_t link_offset;
+    uint32_t link_size;
+    uint32_t target;
+    // The uncompressed size of the blocks of a compressed file, and the range
+    // of its blocks in the block table.
+    uint32_t block_size;
+    uint32_t first_block;
+    uint32_t block_count;
+  };
+
+  // Identifies the archive header an index was built from, a cached index is
+  // only used when all of these match.
+  struct Source {
+    Source();
+    uint64_t archive_size;
+    uint32_t header_size;
+    unsigned char header_hash[base::kSHA1Length];
+  };
+
+  ~ArchiveIndex();
+
+  // Builds the index from the parsed JSON |header|, |header_size| is added to
+  // the offset of every packed file.
+  static std::unique_ptr<ArchiveIndex> Create(
+      const base::DictionaryValue& header, uint32_t header_size);
+
+  // Maps an index written from Serialize, returns nullptr when the file does
+  // not exist, is malformed or was built from a different |source|.
+  static std::unique_ptr<ArchiveIndex> CreateFromFile(
+      const base::FilePath& path, const Source& source);
+
+  // Returns the content of a file that can be loaded by CreateFromFile.
+  std::string Serialize(const Source& source) const;
+
+  // Returns the node at |path|, or kInvalidNode.
+  uint32_t Lookup(base::StringPiece path) const;
+
+  // Returns the directory whose children are listed for |index|, which is
+  // the node itself for directories and the link target for linked
+  // directories, or kInvalidNode.
+  uint32_t GetFilesNode(uint32_t index) const;
+
+  const Node& node(uint32_t index) const { return nodes_[index]; }
+  size_t node_count() const { return node_count_; }
+
+  base::StringPiece GetName(const Node& node) const {
+    return names_.substr(node.name_offset, node.name_size);
+  }
+  base::StringPiece GetLinkPath(const Node& node) const {
+    return names_.substr(node.link_offset, node.link_size);
+  }
+
+  // Returns the end of the compressed block |index| of the block table,
+  // relative to the offset of its file. Every block starts where the
+  // previous block of the file ends.
+  uint32_t block_end(uint32_t index) const { return blocks_[index]; }
+
+  // Returns the number of bytes used by the index.
+  size_t GetMemoryUsage() const;
+
+ private:
+  ArchiveIndex();
+
+  uint32_t GetChild(uint32_t dir, base::StringPiece name) const;
+  void ResolveLinks(const std::vector<uint32_t>& links);
+
+  // Checks that all ranges and node references stay inside the index.
+  bool IsValid() const;
+
+  // The node array, the block table and the string pool, which either point
+  // into |owned_nodes_|, |owned_blocks_| and |owned_names_| or into
+  // |mapped_file_|.
+  const Node* nodes_;
+  size_t node_count_;
+  const uint32_t* blocks_;
+  size_t block_count_;
+  base::StringPiece names_;
+
+  std::vector<Node> owned_nodes_;
+  std::vector<uint32_t> owned_blocks_;
+  std::string owned_names_;
+  std::unique_ptr<base::MemoryMappedFile> mapped_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveIndex);
+};
+
+}  // namespace asar
+
+#endif  // ATOM_COMMON_ASAR_ARCHIVE_INDEX_H_
@@ -4,37 +4,140 @@
 
 #include "atom/common/asar/asar_util.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "atom/common/asar/archive.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/lazy_instance.h"
-#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
 
 namespace asar {
 
 namespace {
 
-// The global instance of ArchiveMap, will be destroyed on exit.
-typedef std::map<base::FilePath, std::shared_ptr<Archive>> ArchiveMap;
-static base::LazyInstance<ArchiveMap>::DestructorAtExit g_archive_map =
-    LAZY_INSTANCE_INITIALIZER;
+// The number of opened archives that are only referenced by the registry and
+// are kept around for future lookups.
+const size_t kMaxIdleArchives = 8;
+
+// Keeps the opened archives shared by all threads.
+//
+// |lock_| is only held to look up or update the map, never while an archive
+// is being opened or closed. Opening happens under the lock of the archive's
+// slot, so concurrent callers for the same path wait for a single open while
+// lookups of other archives go on.
+class ArchiveRegistry {
+ public:
+  ArchiveRegistry() : clock_(0) {}
+
+  std::shared_ptr<Archive> GetOrCreate(const base::FilePath& path) {
+    std::shared_ptr<Slot> slot;
+    {
+      base::AutoLock auto_lock(lock_);
+      std::shared_ptr<Slot>& entry = slots_[path];
+      if (!entry)
+        entry.reset(new Slot);
+      entry->last_used = ++clock_;
+      if (entry->archive)
+        return entry->archive;
+      slot = entry;
+    }
+
+    base::AutoLock open_lock(slot->open_lock);
+    {
+      base::AutoLock auto_lock(lock_);
+      if (slot->archive)
+        return slot->archive;
+    }
+
+    std::shared_ptr<Archive> archive(new Archive(path));
+    bool success = archive->Init();
+
+    std::vector<std::shared_ptr<Archive>> evicted;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (!success) {
+        // Failures are not cached, the archive might appear later.
+        auto it = slots_.find(path);
+        if (it != slots_.end() && it->second == slot)
+          slots_.erase(it);
+        return nullptr;
+      }
+
+      slot->archive = archive;
+      EvictIdleArchives(&evicted);
+    }
+    // |evicted| is released here, outside of |lock_|.
+    return archive;
+  }
+
+  std::shared_ptr<Archive> Get(const base::FilePath& path) {
+    base::AutoLock auto_lock(lock_);
+    auto it = slots_.find(path);
+    if (it == slots_.end() || !it->second->archive)
+      return nullptr;
+    it->second->last_used = ++clock_;
+    return it->second->archive;
+  }
+
+ private:
+  struct Slot {
+    Slot() : last_used(0) {}
+
+    // Held while the archive is being opened.
+    base::Lock open_lock;
+    // Guarded by ArchiveRegistry::lock_.
+    std::shared_ptr<Archive> archive;
+    uint64_t last_used;
+  };
+
+  // Moves the least recently used archives that nobody else references out
+  // of the map until at most kMaxIdleArchives are left.
+  void EvictIdleArchives(std::vector<std::shared_ptr<Archive>>* evicted) {
+    lock_.AssertAcquired();
+
+    std::vector<std::pair<uint64_t, base::FilePath>> idle;
+    for (const auto& it : slots_) {
+      const std::shared_ptr<Archive>& archive = it.second->archive;
+      if (archive && archive.use_count() == 1)
+        idle.push_back(std::make_pair(it.second->last_used, it.first));
+    }
+    if (idle.size() <= kMaxIdleArchives)
+      return;
+
+    std::sort(idle.begin(), idle.end());
+    for (size_t i = 0; i < idle.size() - kMaxIdleArchives; ++i) {
+      auto it = slots_.find(idle[i].second);
+      evicted->push_back(it->second->archive);
+      slots_.erase(it);
+    }
+  }
+
+  base::Lock lock_;
+  std::map<base::FilePath, std::shared_ptr<Slot>> slots_;
+  uint64_t clock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveRegistry);
+};
+
+// The global instance of ArchiveRegistry, will be destroyed on exit.
+static base::LazyInstance<ArchiveRegistry>::DestructorAtExit
+    g_archive_registry = LAZY_INSTANCE_INITIALIZER;
 
 const base::FilePath::CharType kAsarExtension[] = FILE_PATH_LITERAL(".asar");
 
 }  // namespace
 
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const base::FilePath& path) {
-  ArchiveMap& archive_map = *g_archive_map.Pointer();
-  if (!ContainsKey(archive_map, path)) {
-    std::shared_ptr<Archive> archive(new Archive(path));
-    if (!archive->Init())
-      return nullptr;
-    archive_map[path] = archive;
-  }
-  return archive_map[path];
+  return g_archive_registry.Get().GetOrCreate(path);
+}
+
+std::shared_ptr<Archive> GetOpenedAsarArchive(const base::FilePath& path) {
+  return g_archive_registry.Get().Get(path);
 }
 
 bool GetAsarArchivePath(const base::FilePath& full_path,
@@ -59,6 +162,26 @@ bool GetAsarArchivePath(const base::FilePath& full_path,
   return true;
 }
 
+bool GetFileContents(const base::FilePath& path,
+                     std::shared_ptr<Archive>* archive,
+                     base::StringPiece* contents) {
+  base::FilePath asar_path, relative_path;
+  if (!GetAsarArchivePath(path, &asar_path, &relative_path))
+    return false;
+
+  std::shared_ptr<Archive> result = GetOrCreateAsarArchive(asar_path);
+  if (!result)
+    return false;
+
+  Archive::FileInfo info;
+  if (!result->GetFileInfo(relative_path, &info) ||
+      !result->GetFileContents(info, contents))
+    return false;
+
+  *archive = result;
+  return true;
+}
+
 bool ReadFileToString(const base::FilePath& path, std::string* contents) {
   base::FilePath asar_path, relative_path;
   if (!GetAsarArchivePath(path, &asar_path, &relative_path))
@@ -79,13 +202,10 @@ bool ReadFileToString(const base::FilePath& path, std::string* contents) {
     return base::ReadFileToString(real_path, contents);
   }
 
-  base::File src(asar_path, base::File::FLAG_OPEN | base::File::FLAG_READ);
-  if (!src.IsValid())
-    return false;
-
+  // Copies from the mapped archive, decompressing compressed files.
   contents->resize(info.size);
-  return static_cast<int>(info.size) == src.Read(
-      info.offset, const_cast<char*>(contents->data()), contents->size());
+  return static_cast<int>(info.size) ==
+         archive->ReadFile(info, 0, &(*contents)[0], info.size);
 }
 
 }  // namespace asar
@@ -8,6 +8,8 @@
 #include <memory>
 #include <string>
 
+#include "base/strings/string_piece.h"
+
 namespace base {
 class FilePath;
 }
@@ -16,14 +18,27 @@ namespace asar {
 
 class Archive;
 
-// Gets or creates a new Archive from the path.
+// Gets or creates a new Archive from the path, safe to call from any thread.
+// Archives nobody holds on to anymore may be closed, keep the returned
+// pointer for as long as data from the archive is used.
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const base::FilePath& path);
 
+// Gets an Archive that is already open, never opens or reads anything so it
+// can be used on threads that disallow IO. Returns nullptr otherwise.
+std::shared_ptr<Archive> GetOpenedAsarArchive(const base::FilePath& path);
+
 // Separates the path to Archive out.
 bool GetAsarArchivePath(const base::FilePath& full_path,
                         base::FilePath* asar_path,
                         base::FilePath* relative_path);
 
+// Gets a read-only view of a packed file inside an asar Archive, the view is
+// valid for as long as |archive| is alive. Returns false when |path| is not
+// in an archive, the file is unpacked or the archive could not be mapped.
+bool GetFileContents(const base::FilePath& path,
+                     std::shared_ptr<Archive>* archive,
+                     base::StringPiece* contents);
+
 // Same with base::ReadFileToString but supports asar Archive.
 bool ReadFileToString(const base::FilePath& path, std::string* contents);
 
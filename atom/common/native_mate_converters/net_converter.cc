@@ -128,11 +128,19 @@ namespace atom {
 
 void FillRequestDetails(base::DictionaryValue* details,
                         const net::URLRequest* request) {
+  FillRequestDetails(details, request, true);
+}
+
+void FillRequestDetails(base::DictionaryValue* details,
+                        const net::URLRequest* request,
+                        bool with_upload_data) {
   details->SetString("method", request->method());
   std::string url;
   if (!request->url_chain().empty()) url = request->url().spec();
   details->SetKey("url", base::Value(url));
   details->SetString("referrer", request->referrer());
+  if (!with_upload_data)
+    return;
   std::unique_ptr<base::ListValue> list(new base::ListValue);
   GetUploadData(list.get(), request);
   if (!list->empty())
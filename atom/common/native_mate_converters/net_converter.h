@@ -69,6 +69,12 @@ namespace atom {
 void FillRequestDetails(base::DictionaryValue* details,
                         const net::URLRequest* request);
 
+// Same as above, but leaves out the upload data, which is copied, unless
+// |with_upload_data| is true.
+void FillRequestDetails(base::DictionaryValue* details,
+                        const net::URLRequest* request,
+                        bool with_upload_data);
+
 void GetUploadData(base::ListValue* upload_data_list,
                    const net::URLRequest* request);
 
@@ -128,6 +128,9 @@ const char kCipherSuiteBlacklist[] = "cipher-suite-blacklist";
 // The browser process app model ID
 const char kAppUserModelId[] = "app-user-model-id";
 
+// Number of bytes read at once when serving files from asar archives.
+const char kAsarReadAheadSize[] = "asar-read-ahead-size";
+
 // The command line switch versions of the options.
 const char kBackgroundColor[] = "background-color";
 const char kZoomFactor[]      = "zoom-factor";
@@ -73,6 +73,7 @@ extern const char kRegisterServiceWorkerSchemes[];
 extern const char kSSLVersionFallbackMin[];
 extern const char kCipherSuiteBlacklist[];
 extern const char kAppUserModelId[];
+extern const char kAsarReadAheadSize[];
 
 extern const char kBackgroundColor[];
 extern const char kZoomFactor[];
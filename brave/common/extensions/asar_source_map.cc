@@ -4,10 +4,13 @@
 
 #include "brave/common/extensions/asar_source_map.h"
 
+#include <memory>
+
+#include "atom/common/asar/archive.h"
 #include "atom/common/asar/asar_util.h"
-#include "base/callback.h"
-#include "base/bind.h"
-#include "base/files/file_util.h"
+#include "base/sha1.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_split.h"
 #include "gin/converter.h"
 
@@ -17,17 +20,29 @@ namespace {
 
 static const char commonjs[] = "muon/module_system/commonjs";
 
-bool IsAsarPath(const base::FilePath& path) {
-  base::FilePath archive;
-  base::FilePath relative;
-  return asar::GetAsarArchivePath(path, &archive, &relative);
+// The source of a module, either a view into a mapped asar archive or a copy
+// read from disk when the module is not packed.
+struct ModuleSource {
+  base::StringPiece data() const {
+    return archive ? view : base::StringPiece(contents);
+  }
+
+  std::shared_ptr<asar::Archive> archive;
+  base::StringPiece view;
+  std::string contents;
+};
+
+bool ReadModuleSource(const base::FilePath& path, ModuleSource* source) {
+  if (asar::GetFileContents(path, &source->archive, &source->view))
+    return true;
+
+  source->archive.reset();
+  return asar::ReadFileToString(path, &source->contents);
 }
 
-bool ReadFromPath(
-    base::Callback<bool(const base::FilePath& path, std::string* contents)>,
-    const base::FilePath& file,
-    const base::FilePath& path,
-    std::string* source) {
+bool ReadFromPath(const base::FilePath& file,
+                  const base::FilePath& path,
+                  ModuleSource* source) {
   base::FilePath file_path = path.Append(file);
   if (!file_path.MatchesExtension(FILE_PATH_LITERAL(".js")))
     file_path = file_path.AddExtension(FILE_PATH_LITERAL("js"));
@@ -42,25 +57,17 @@ bool ReadFromPath(
       .Append(file)
       .AddExtension(FILE_PATH_LITERAL("js"));
 
-  return asar::ReadFileToString(file_path, source) ||
-      asar::ReadFileToString(module_path1, source) ||
-      asar::ReadFileToString(module_path2, source);
+  return ReadModuleSource(file_path, source) ||
+      ReadModuleSource(module_path1, source) ||
+      ReadModuleSource(module_path2, source);
 }
 
 bool ReadFromSearchPaths(const std::vector<base::FilePath>& search_paths,
                         const base::FilePath& file_path,
-                        std::string* source) {
+                        ModuleSource* source) {
   for (size_t i = 0; i < search_paths.size(); ++i) {
-    if (IsAsarPath(search_paths[i])) {
-      if (!ReadFromPath(base::Bind(&asar::ReadFileToString),
-          file_path, search_paths[i], source))
-        continue;
-    } else {
-      if (!ReadFromPath(base::Bind(&base::ReadFileToString),
-          file_path, search_paths[i], source))
-        continue;
-    }
-    return true;
+    if (ReadFromPath(file_path, search_paths[i], source))
+      return true;
   }
   return false;
 }
@@ -112,28 +119,57 @@ AsarSourceMap::~AsarSourceMap() {
 v8::Local<v8::String> AsarSourceMap::GetSource(
     v8::Isolate* isolate,
     const std::string& name) const {
-  std::string source;
-  if (ReadFromSearchPaths(search_paths_, GetFilePath(name), &source)) {
-    if (name != commonjs) {
-      source =
-          "const fn = function (require, module, console) { " + source + " };"
-          "require('" +
-            commonjs +
-          "').require(fn, exports, '" +
-          GetFilePath(name).AsUTF8Unsafe() +
-          "', this);";
-    }
+  if (name == commonjs) {
+    ModuleSource module;
+    if (ReadFromSearchPaths(search_paths_, GetFilePath(name), &module))
+      return gin::StringToV8(isolate, module.data());
 
-    return gin::StringToV8(isolate, source);
+    NOTREACHED() << "No module is registered with name \"" << name << "\"";
+    return v8::Local<v8::String>();
   }
 
-  NOTREACHED() << "No module is registered with name \"" << name << "\"";
-  return v8::Local<v8::String>();
+  // The module itself is compiled by commonjs through the code cache, the
+  // module system only compiles this stub.
+  std::string module_path = GetFilePath(name).AsUTF8Unsafe();
+  std::string source;
+  source.append("require('");
+  source.append(commonjs);
+  source.append("').load(exports, '");
+  source.append(module_path);
+  source.append("', this);");
+  return gin::StringToV8(isolate, source);
 }
 
-bool AsarSourceMap::Contains(const std::string& name) const {
+v8::Local<v8::String> AsarSourceMap::GetFunctionSource(
+    v8::Isolate* isolate,
+    const std::string& name,
+    std::string* cache_key) const {
+  ModuleSource module;
+  if (!ReadFromSearchPaths(search_paths_, GetFilePath(name), &module))
+    return v8::Local<v8::String>();
+
+  // Wrap the module straight from the mapped archive, so the source is only
+  // copied once before it is handed to V8.
   std::string source;
-  return ReadFromSearchPaths(search_paths_, GetFilePath(name), &source);
+  source.reserve(module.data().size() + 64);
+  source.append("(function (exports, require, module, console) { ");
+  module.data().AppendToString(&source);
+  source.append("\n})");
+
+  // Key the code cache on the wrapped source, so a cache made for another
+  // wrapper is never used.
+  unsigned char hash[base::kSHA1Length];
+  base::SHA1HashBytes(reinterpret_cast<const unsigned char*>(source.data()),
+                      source.size(), hash);
+  *cache_key = GetFilePath(name).AsUTF8Unsafe() + "@" +
+      base::HexEncode(hash, sizeof(hash));
+
+  return gin::StringToV8(isolate, source);
+}
+
+bool AsarSourceMap::Contains(const std::string& name) const {
+  ModuleSource module;
+  return ReadFromSearchPaths(search_paths_, GetFilePath(name), &module);
 }
 
 }  // namespace brave
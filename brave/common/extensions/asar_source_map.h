@@ -24,6 +24,14 @@ class AsarSourceMap : public extensions::SourceMap {
                                  const std::string& name) const override;
   bool Contains(const std::string& name) const override;
 
+  // Returns the source of the module |name| as a function expression taking
+  // its require, module and console, or an empty handle when there is no
+  // such module. |cache_key| is set to the module path and a hash of its
+  // source, for the ModuleCodeCache.
+  v8::Local<v8::String> GetFunctionSource(v8::Isolate* isolate,
+                                          const std::string& name,
+                                          std::string* cache_key) const;
+
  private:
   std::vector<base::FilePath> search_paths_;
 
@@ -0,0 +1,87 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/extensions/code_cache_bindings.h"
+
+#include <memory>
+#include <string>
+
+#include "brave/common/extensions/asar_source_map.h"
+#include "brave/common/extensions/module_code_cache.h"
+#include "extensions/renderer/script_context.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+CodeCacheBindings::CodeCacheBindings(
+        extensions::ScriptContext* context,
+        const AsarSourceMap* source_map)
+    : extensions::ObjectBackedNativeHandler(context),
+      source_map_(source_map),
+      hits_(0),
+      misses_(0) {
+  RouteFunction("compile",
+      base::Bind(&CodeCacheBindings::Compile, base::Unretained(this)));
+}
+
+CodeCacheBindings::~CodeCacheBindings() {
+}
+
+void CodeCacheBindings::Compile(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  if (args.Length() != 1 || !args[0]->IsString()) {
+    GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        GetIsolate(), "Invalid arguments to 'compile'"));
+    return;
+  }
+
+  std::string name(*v8::String::Utf8Value(args[0]));
+  std::string cache_key;
+  v8::Local<v8::String> source =
+      source_map_->GetFunctionSource(GetIsolate(), name, &cache_key);
+  if (source.IsEmpty()) {
+    GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        GetIsolate(), ("No source for require(" + name + ")").c_str()));
+    return;
+  }
+
+  ModuleCodeCache* code_cache = ModuleCodeCache::GetInstance();
+  std::unique_ptr<v8::ScriptCompiler::CachedData> cached_data =
+      code_cache->Get(cache_key);
+  v8::ScriptCompiler::CompileOptions options =
+      cached_data ? v8::ScriptCompiler::kConsumeCodeCache
+                  : v8::ScriptCompiler::kNoCompileOptions;
+  v8::ScriptOrigin origin(args[0]);
+  // |script_source| owns the cached data.
+  v8::ScriptCompiler::Source script_source(source, origin,
+                                           cached_data.release());
+
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  v8::Local<v8::Script> script;
+  v8::Local<v8::Value> fn;
+  if (!v8::ScriptCompiler::Compile(v8_context, &script_source, options)
+           .ToLocal(&script) ||
+      !script->Run(v8_context).ToLocal(&fn))
+    return;
+
+  if (options == v8::ScriptCompiler::kConsumeCodeCache &&
+      !script_source.GetCachedData()->rejected) {
+    ++hits_;
+  } else {
+    ++misses_;
+    // The function is compiled eagerly because it is wrapped in parentheses,
+    // so the code cache covers it.
+    std::unique_ptr<v8::ScriptCompiler::CachedData> new_data(
+        v8::ScriptCompiler::CreateCodeCache(script->GetUnboundScript(),
+                                            source));
+    if (new_data && new_data->length > 0)
+      code_cache->Put(cache_key, new_data->data, new_data->length);
+    else
+      code_cache->Remove(cache_key);
+  }
+
+  args.GetReturnValue().Set(fn);
+}
+
+}  // namespace brave
@@ -0,0 +1,41 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_EXTENSIONS_CODE_CACHE_BINDINGS_H_
+#define BRAVE_COMMON_EXTENSIONS_CODE_CACHE_BINDINGS_H_
+
+#include "base/compiler_specific.h"
+#include "base/macros.h"
+#include "extensions/renderer/object_backed_native_handler.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+class AsarSourceMap;
+
+// Compiles the modules of the AsarSourceMap for commonjs, through the
+// ModuleCodeCache.
+class CodeCacheBindings : public extensions::ObjectBackedNativeHandler {
+ public:
+  CodeCacheBindings(extensions::ScriptContext* context,
+                    const AsarSourceMap* source_map);
+  ~CodeCacheBindings() override;
+
+  // The number of modules compiled with and without a code cache.
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  void Compile(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  const AsarSourceMap* source_map_;
+  int hits_;
+  int misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodeCacheBindings);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_EXTENSIONS_CODE_CACHE_BINDINGS_H_
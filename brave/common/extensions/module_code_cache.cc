@@ -0,0 +1,154 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/extensions/module_code_cache.h"
+
+#include <string.h>
+
+#include "base/bind.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/pickle.h"
+#include "base/sha1.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task_scheduler/post_task.h"
+
+namespace brave {
+
+namespace {
+
+base::LazyInstance<ModuleCodeCache>::Leaky g_module_code_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Keys are "<module path>@<source hash>".
+std::string GetModulePath(const std::string& key) {
+  return key.substr(0, key.rfind('@'));
+}
+
+void WriteEntry(const base::FilePath& path,
+                const std::string& key,
+                const std::string& data) {
+  base::Pickle pickle;
+  pickle.WriteString(key);
+  pickle.WriteString(data);
+  if (!base::CreateDirectory(path.DirName()))
+    return;
+  base::ImportantFileWriter::WriteFileAtomically(
+      path,
+      base::StringPiece(static_cast<const char*>(pickle.data()),
+                        pickle.size()));
+}
+
+void DeleteEntry(const base::FilePath& path) {
+  base::DeleteFile(path, false);
+}
+
+}  // namespace
+
+// static
+ModuleCodeCache* ModuleCodeCache::GetInstance() {
+  return g_module_code_cache.Pointer();
+}
+
+ModuleCodeCache::ModuleCodeCache() {
+}
+
+ModuleCodeCache::~ModuleCodeCache() {
+}
+
+void ModuleCodeCache::Init(const base::FilePath& directory) {
+  base::AutoLock lock(lock_);
+  DCHECK(!task_runner_);
+  directory_ = directory;
+  task_runner_ = base::CreateSequencedTaskRunnerWithTraits(
+      {base::MayBlock(), base::TaskPriority::BACKGROUND,
+       base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN});
+  // The instance is leaked.
+  task_runner_->PostTask(FROM_HERE,
+      base::Bind(&ModuleCodeCache::LoadFromDisk, base::Unretained(this),
+                 directory));
+}
+
+std::unique_ptr<v8::ScriptCompiler::CachedData> ModuleCodeCache::Get(
+    const std::string& key) {
+  base::AutoLock lock(lock_);
+  auto it = entries_.find(GetModulePath(key));
+  if (it == entries_.end() || it->second.key != key)
+    return nullptr;
+
+  // V8 may hold on to the data longer than the lock, so it gets a copy.
+  const std::string& cached = it->second.data;
+  uint8_t* data = new uint8_t[cached.size()];
+  memcpy(data, cached.data(), cached.size());
+  return std::make_unique<v8::ScriptCompiler::CachedData>(
+      data, static_cast<int>(cached.size()),
+      v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+void ModuleCodeCache::Put(const std::string& key,
+                          const uint8_t* data,
+                          int length) {
+  base::AutoLock lock(lock_);
+  // Replaces the code cache of an older source of the module.
+  Entry& entry = entries_[GetModulePath(key)];
+  entry.key = key;
+  entry.data.assign(reinterpret_cast<const char*>(data), length);
+
+  base::FilePath path = GetFilePath(key);
+  if (!path.empty()) {
+    task_runner_->PostTask(FROM_HERE,
+        base::Bind(&WriteEntry, path, key, entry.data));
+  }
+}
+
+void ModuleCodeCache::Remove(const std::string& key) {
+  base::AutoLock lock(lock_);
+  auto it = entries_.find(GetModulePath(key));
+  if (it == entries_.end() || it->second.key != key)
+    return;
+  entries_.erase(it);
+
+  base::FilePath path = GetFilePath(key);
+  if (!path.empty())
+    task_runner_->PostTask(FROM_HERE, base::Bind(&DeleteEntry, path));
+}
+
+void ModuleCodeCache::LoadFromDisk(const base::FilePath& directory) {
+  base::FileEnumerator files(directory, false, base::FileEnumerator::FILES);
+  for (base::FilePath path = files.Next(); !path.empty();
+       path = files.Next()) {
+    std::string contents;
+    std::string key;
+    std::string data;
+    if (base::ReadFileToString(path, &contents)) {
+      base::Pickle pickle(contents.data(), static_cast<int>(contents.size()));
+      base::PickleIterator iter(pickle);
+      if (!iter.ReadString(&key) || !iter.ReadString(&data))
+        key.clear();
+    }
+    if (key.empty()) {
+      DeleteEntry(path);
+      continue;
+    }
+
+    base::AutoLock lock(lock_);
+    // What was compiled since startup is more recent.
+    Entry& entry = entries_[GetModulePath(key)];
+    if (entry.key.empty()) {
+      entry.key = key;
+      entry.data.swap(data);
+    }
+  }
+}
+
+base::FilePath ModuleCodeCache::GetFilePath(const std::string& key) const {
+  lock_.AssertAcquired();
+  if (directory_.empty())
+    return base::FilePath();
+  std::string hash = base::SHA1HashString(GetModulePath(key));
+  return directory_.AppendASCII(base::HexEncode(hash.data(), hash.size()));
+}
+
+}  // namespace brave
@@ -0,0 +1,72 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
+#define BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/sequenced_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+// The V8 code caches of the modules loaded from the AsarSourceMap, shared by
+// every isolate of the process so that a module is only compiled from
+// scratch once. Keys are made of the module path and a hash of its source,
+// and a module only has the code cache of its latest source.
+//
+// Once Init is called the code caches are also kept in a directory, one file
+// per module, so that they outlive the process.
+class ModuleCodeCache {
+ public:
+  static ModuleCodeCache* GetInstance();
+
+  // Loads the code caches kept in |directory| in the background, and writes
+  // the new ones there.
+  void Init(const base::FilePath& directory);
+
+  // Returns a copy of the code cache stored for |key|, or nullptr.
+  std::unique_ptr<v8::ScriptCompiler::CachedData> Get(const std::string& key);
+  void Put(const std::string& key, const uint8_t* data, int length);
+  // Drops the code cache of |key| after V8 rejected it.
+  void Remove(const std::string& key);
+
+ private:
+  friend struct base::LazyInstanceTraitsBase<ModuleCodeCache>;
+
+  struct Entry {
+    std::string key;
+    std::string data;
+  };
+
+  ModuleCodeCache();
+  ~ModuleCodeCache();
+
+  // Runs on |task_runner_|.
+  void LoadFromDisk(const base::FilePath& directory);
+
+  // Returns the file of the module of |key|, or an empty path before Init.
+  // Must be called with |lock_| held.
+  base::FilePath GetFilePath(const std::string& key) const;
+
+  base::Lock lock_;
+  // Keyed by module path.
+  std::map<std::string, Entry> entries_;
+  base::FilePath directory_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModuleCodeCache);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
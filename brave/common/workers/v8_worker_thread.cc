@@ -6,10 +6,18 @@
 
 #include "atom/browser/api/atom_api_app.h"
 #include "atom/browser/javascript_environment.h"
+#include "atom/common/native_mate_converters/value_converter.h"
 #include "base/lazy_instance.h"
 #include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/threading/thread_local.h"
+#include "base/values.h"
+#include "brave/common/extensions/code_cache_bindings.h"
 #include "brave/common/workers/worker_bindings.h"
+#include "brave/common/workers/worker_channel.h"
+#include "brave/common/workers/worker_message.h"
+#include "brave/common/workers/worker_pool.h"
+#include "brave/common/workers/worker_stats.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/renderer/worker_thread_registry.h"
 
@@ -23,30 +31,81 @@ namespace {
 base::LazyInstance<base::ThreadLocalPointer<V8WorkerThread>>::Leaky worker =
       LAZY_INSTANCE_INITIALIZER;
 
-void NotifyStart(atom::api::App* app, int worker_id) {
-  app->Emit("worker-start", worker_id);
+// Gives the other tasks of the worker a turn when a channel is busy.
+const int kMaxChannelMessagesPerTask = 1024;
+
+bool GetFunction(v8::Local<v8::Context> context,
+                 v8::Local<v8::Object> object,
+                 const char* name,
+                 v8::Local<v8::Function>* function) {
+  v8::Local<v8::Value> value;
+  if (!object->Get(context, v8::String::NewFromUtf8(context->GetIsolate(),
+                       name, v8::NewStringType::kNormal).ToLocalChecked())
+           .ToLocal(&value) || !value->IsFunction())
+    return false;
+  *function = value.As<v8::Function>();
+  return true;
+}
+
+void NotifyStart(atom::api::App* app,
+                 int worker_id,
+                 std::unique_ptr<base::DictionaryValue> metrics) {
+  app->Emit("worker-start", worker_id, *metrics);
 }
 
 void NotifyStop(atom::api::App* app, int worker_id) {
-  app->Emit("worker-stop", worker_id);
+  app->OnWorkerStop(worker_id);
+}
+
+void NotifyDrain(atom::api::App* app, int worker_id) {
+  app->Emit("worker-drain", worker_id);
 }
 
 void NotifyError(atom::api::App* app, int worker_id, std::string error) {
   app->Emit("worker-onerror", worker_id, error);
 }
 
+void NotifyTaskDone(atom::api::App* app,
+                    int pool_id,
+                    int task_id,
+                    const std::string& error,
+                    std::unique_ptr<WorkerMessage> result) {
+  v8::Isolate* isolate = app->isolate();
+  v8::Local<v8::Value> value = v8::Undefined(isolate);
+  std::string task_error = error;
+  if (result &&
+      !result->Deserialize(isolate, isolate->GetCurrentContext())
+          .ToLocal(&value))
+    task_error = "The result of the task could not be deserialized";
+
+  if (task_error.empty())
+    app->Emit("worker-task-done", pool_id, task_id, v8::Null(isolate), value);
+  else
+    app->Emit("worker-task-done", pool_id, task_id, task_error);
+}
+
 void Kill(V8WorkerThread* worker) {
   delete worker;
 }
 
 }  // namespace
 
+struct V8WorkerThread::Channel {
+  scoped_refptr<WorkerChannel> channel;
+  v8::Global<v8::Object> object;
+};
+
 V8WorkerThread::V8WorkerThread(const std::string& name,
                               const std::string& module_name,
-                              atom::api::App* app) :
+                              atom::api::App* app,
+                              scoped_refptr<WorkerStats> stats) :
     base::Thread(name),
     module_name_(module_name),
-    app_(app) {
+    app_(app),
+    stats_(stats),
+    terminating_(false),
+    pool_index_(0),
+    created_time_(base::TimeTicks::Now()) {
 }
 
 V8WorkerThread::~V8WorkerThread() {
@@ -66,6 +125,9 @@ void V8WorkerThread::Shutdown() {
 
   worker.Get().Set(nullptr);
 
+  if (instance->pool_)
+    instance->pool_->RemoveWorker(instance->pool_index_);
+
   BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
       base::Bind(&NotifyStop,
                   base::Unretained(instance->app()),
@@ -76,9 +138,11 @@ void V8WorkerThread::Shutdown() {
 }
 
 void V8WorkerThread::Init() {
+  base::TimeTicks init_start = base::TimeTicks::Now();
   worker.Get().Set(this);
 
   js_env_.reset(new atom::JavascriptEnvironment());
+  env()->isolate()->AddGCEpilogueCallback(&V8WorkerThread::OnGCEpilogue);
 
   env()->module_system()->RegisterNativeHandler(
       "worker", std::unique_ptr<extensions::NativeHandler>(
@@ -87,35 +151,296 @@ void V8WorkerThread::Init() {
   memory_pressure_listener_.reset(new base::MemoryPressureListener(
       base::Bind(&V8WorkerThread::OnMemoryPressure,
         base::Unretained(this))));
+  init_time_ = base::TimeTicks::Now() - init_start;
 }
 
 void V8WorkerThread::Run(base::RunLoop* run_loop) {
   base::ThreadRestrictions::SetIOAllowed(true);
   content::WorkerThreadRegistry::Instance()->DidStartCurrentWorkerThread();
+  base::MessageLoop::current()->AddTaskObserver(this);
   env()->OnMessageLoopCreated();
-  LoadModule();
+  base::TimeTicks load_start = base::TimeTicks::Now();
+  bool loaded = LoadModule();
+  base::TimeTicks ready = base::TimeTicks::Now();
+
+  // All times are in milliseconds, startTime runs from the creation of the
+  // worker until its module is loaded.
+  auto metrics = std::make_unique<base::DictionaryValue>();
+  metrics->SetDouble("startTime", (ready - created_time_).InMillisecondsF());
+  metrics->SetDouble("initTime", init_time_.InMillisecondsF());
+  metrics->SetDouble("loadTime", (ready - load_start).InMillisecondsF());
+  metrics->SetInteger("codeCacheHits", env()->code_cache_bindings()->hits());
+  metrics->SetInteger("codeCacheMisses",
+                      env()->code_cache_bindings()->misses());
   BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
       base::Bind(&NotifyStart,
                   base::Unretained(app()),
-                  GetThreadId()));
+                  GetThreadId(),
+                  base::Passed(&metrics)));
+
+  if (loaded && pool_ &&
+      !pool_->StartWorker(pool_index_, task_runner(),
+          base::Bind(&V8WorkerThread::RunPoolTasks, base::Unretained(this)))) {
+    // The pool was stopped while the module loaded.
+    task_runner()->PostTask(FROM_HERE,
+        base::Bind(&V8WorkerThread::Shutdown));
+  }
   Thread::Run(run_loop);
 }
 
 // Called just after the message loop ends
 void V8WorkerThread::CleanUp() {
   content::WorkerThreadRegistry::Instance()->WillStopCurrentWorkerThread();
+  base::MessageLoop::current()->RemoveTaskObserver(this);
+  for (const auto& it : channels_)
+    it.second->channel->Close();
+  channels_.clear();
   memory_pressure_listener_.reset();
   env()->OnMessageLoopDestroying();
   js_env_.reset();
   V8WorkerThread::Shutdown();
 }
 
+void V8WorkerThread::JoinPool(scoped_refptr<WorkerPool> pool,
+                              size_t index) {
+  pool_ = pool;
+  pool_index_ = index;
+}
+
+void V8WorkerThread::RunPoolTasks() {
+  // Stop taking tasks once close() has been called or the heap limit was
+  // exceeded, the pool hands the tasks left to the other workers.
+  while (current() == this && !terminating_) {
+    std::unique_ptr<WorkerPool::Task> task = pool_->TakeTask(pool_index_);
+    if (!task)
+      return;
+    RunPoolTask(task->id, std::move(task->message));
+    pool_->DidRunTask(pool_index_);
+  }
+}
+
+void V8WorkerThread::RunPoolTask(int task_id,
+                                 std::unique_ptr<WorkerMessage> message) {
+  v8::Isolate* isolate = env()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> context = env()->context();
+  v8::Context::Scope context_scope(context);
+
+  std::string error;
+  std::unique_ptr<WorkerMessage> result;
+  v8::Local<v8::Value> data;
+  v8::Local<v8::Value> ontask;
+  if (!message->Deserialize(isolate, context).ToLocal(&data)) {
+    error = "The task could not be deserialized";
+  } else if (!context->Global()->Get(context,
+                 v8::String::NewFromUtf8(isolate, "ontask",
+                     v8::NewStringType::kNormal).ToLocalChecked())
+                 .ToLocal(&ontask) || !ontask->IsFunction()) {
+    error = "The worker has no `ontask` function";
+  } else {
+    v8::TryCatch try_catch(isolate);
+    v8::Local<v8::Value> argv[] = {data};
+    v8::Local<v8::Value> value;
+    if (!ontask.As<v8::Function>()->Call(
+            context, context->Global(), 1, argv).ToLocal(&value)) {
+      error = "Error message not available";
+      if (try_catch.HasCaught() && !try_catch.Message().IsEmpty())
+        error = *v8::String::Utf8Value(try_catch.Message()->Get());
+    } else {
+      result = WorkerMessage::Serialize(isolate, context, value,
+                                        v8::Local<v8::Value>(), &error);
+    }
+  }
+
+  BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+      base::Bind(&NotifyTaskDone,
+                  base::Unretained(app()),
+                  pool_->id(),
+                  task_id,
+                  error,
+                  base::Passed(&result)));
+}
+
+// static
+void V8WorkerThread::ConnectChannel(scoped_refptr<WorkerChannel> channel) {
+  V8WorkerThread* instance = current();
+  if (!instance) {
+    channel->Close();
+    return;
+  }
+
+  v8::Isolate* isolate = instance->env()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> context = instance->env()->context();
+  v8::Context::Scope context_scope(context);
+
+  v8::Local<v8::Object> object =
+      WorkerBindings::CreateChannel(isolate, context, channel->id());
+  auto entry = std::make_unique<Channel>();
+  entry->channel = channel;
+  entry->object.Reset(isolate, object);
+  instance->channels_[channel->id()] = std::move(entry);
+
+  v8::Local<v8::Function> onchannel;
+  if (GetFunction(context, context->Global(), "onchannel", &onchannel)) {
+    v8::Local<v8::Value> argv[] = {object};
+    (void)onchannel->Call(context, context->Global(), 1, argv);
+  }
+
+  // Start delivering once the worker had a chance to set onmessage.
+  channel->Connect(WorkerChannel::WORKER_END, instance->task_runner(),
+      base::Bind(&V8WorkerThread::OnChannelReadable,
+                 base::Unretained(instance),
+                 channel->id()),
+      base::Bind(&V8WorkerThread::OnChannelWritable,
+                 base::Unretained(instance),
+                 channel->id()));
+}
+
+WorkerChannel* V8WorkerThread::GetChannel(int channel_id) const {
+  auto it = channels_.find(channel_id);
+  if (it == channels_.end())
+    return nullptr;
+  return it->second->channel.get();
+}
+
+void V8WorkerThread::CloseChannel(int channel_id) {
+  // The channel goes away when the wake up for the close arrives.
+  WorkerChannel* channel = GetChannel(channel_id);
+  if (channel)
+    channel->Close();
+}
+
+void V8WorkerThread::DidDrainChannel(int channel_id) {
+  task_runner()->PostTask(FROM_HERE,
+      base::Bind(&V8WorkerThread::OnChannelReadable,
+                 base::Unretained(this),
+                 channel_id));
+}
+
+void V8WorkerThread::OnChannelReadable(int channel_id) {
+  if (current() != this || terminating_)
+    return;
+  auto it = channels_.find(channel_id);
+  if (it == channels_.end())
+    return;
+
+  scoped_refptr<WorkerChannel> channel = it->second->channel;
+  v8::Isolate* isolate = env()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> context = env()->context();
+  v8::Context::Scope context_scope(context);
+  v8::Local<v8::Object> object =
+      v8::Local<v8::Object>::New(isolate, it->second->object);
+
+  // Without an onmessage the messages stay queued for receive().
+  v8::Local<v8::Function> onmessage;
+  v8::Local<v8::Value> message;
+  int delivered = 0;
+  while (GetFunction(context, object, "onmessage", &onmessage) &&
+         channel->Receive(WorkerChannel::WORKER_END, isolate)
+             .ToLocal(&message)) {
+    v8::TryCatch try_catch(isolate);
+    v8::Local<v8::Value> argv[] = {message};
+    (void)onmessage->Call(context, object, 1, argv);
+    if (++delivered == kMaxChannelMessagesPerTask) {
+      task_runner()->PostTask(FROM_HERE,
+          base::Bind(&V8WorkerThread::OnChannelReadable,
+                     base::Unretained(this),
+                     channel_id));
+      return;
+    }
+  }
+
+  // Messages left without an onmessage keep the channel open until they
+  // are received.
+  if (!channel->IsDrained(WorkerChannel::WORKER_END))
+    return;
+  channels_.erase(channel_id);
+  v8::Local<v8::Function> onclose;
+  if (GetFunction(context, object, "onclose", &onclose))
+    (void)onclose->Call(context, object, 0, nullptr);
+}
+
+void V8WorkerThread::OnChannelWritable(int channel_id) {
+  if (current() != this || terminating_)
+    return;
+  auto it = channels_.find(channel_id);
+  if (it == channels_.end())
+    return;
+
+  v8::Isolate* isolate = env()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> context = env()->context();
+  v8::Context::Scope context_scope(context);
+  v8::Local<v8::Object> object =
+      v8::Local<v8::Object>::New(isolate, it->second->object);
+
+  v8::Local<v8::Function> ondrain;
+  if (GetFunction(context, object, "ondrain", &ondrain)) {
+    v8::TryCatch try_catch(isolate);
+    (void)ondrain->Call(context, object, 0, nullptr);
+  }
+}
+
+void V8WorkerThread::DidTakeMessage() {
+  if (stats_->DidTakeMessage()) {
+    BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+        base::Bind(&NotifyDrain,
+                    base::Unretained(app()),
+                    GetThreadId()));
+  }
+}
+
+void V8WorkerThread::WillProcessTask(const base::PendingTask& pending_task) {
+}
+
+void V8WorkerThread::DidProcessTask(const base::PendingTask& pending_task) {
+  // The CPU time of the thread so far.
+  if (base::ThreadTicks::IsSupported())
+    stats_->SetCpuTime(base::ThreadTicks::Now() - base::ThreadTicks());
+}
+
+// static
+void V8WorkerThread::OnGCEpilogue(v8::Isolate* isolate,
+                                  v8::GCType type,
+                                  v8::GCCallbackFlags flags) {
+  V8WorkerThread* instance = current();
+  if (!instance)
+    return;
+
+  v8::HeapStatistics heap_statistics;
+  isolate->GetHeapStatistics(&heap_statistics);
+  instance->stats_->SetHeapSize(heap_statistics.used_heap_size(),
+                                heap_statistics.total_heap_size());
+
+  // Only a full GC tells how much of the heap is really in use.
+  size_t max_heap_size = instance->stats_->max_heap_size();
+  if (!max_heap_size || instance->terminating_ ||
+      !(type & v8::kGCTypeMarkSweepCompact) ||
+      heap_statistics.used_heap_size() <= max_heap_size)
+    return;
+
+  // Stop the script that keeps allocating, then the worker.
+  instance->terminating_ = true;
+  isolate->TerminateExecution();
+  BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
+      base::Bind(&NotifyError,
+                  base::Unretained(instance->app()),
+                  instance->GetThreadId(),
+                  "The worker exceeded its heap limit of " +
+                      base::SizeTToString(max_heap_size / (1024 * 1024)) +
+                      " MB"));
+  instance->task_runner()->PostTask(FROM_HERE,
+      base::Bind(&V8WorkerThread::Shutdown));
+}
+
 void V8WorkerThread::OnMemoryPressure(
     base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
   env()->isolate()->LowMemoryNotification();
 }
 
-void V8WorkerThread::LoadModule() {
+bool V8WorkerThread::LoadModule() {
   if (!env()->source_map().Contains(module_name_)) {
     BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
         base::Bind(&NotifyError,
@@ -123,11 +448,12 @@ void V8WorkerThread::LoadModule() {
                     GetThreadId(),
                     "No source for require(" + module_name_ + ")"));
     base::RunLoop::QuitCurrentDeprecated();
-    return;
+    return false;
   }
 
   ModuleSystem::NativesEnabledScope natives_enabled(env()->module_system());
   env()->module_system()->Require(module_name_);
+  return true;
 }
 
 }  // namespace brave
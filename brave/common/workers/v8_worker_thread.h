@@ -5,11 +5,16 @@
 #ifndef BRAVE_COMMON_WORKERS_V8_WORKER_THREAD_H_
 #define BRAVE_COMMON_WORKERS_V8_WORKER_THREAD_H_
 
+#include <map>
 #include <memory>
 #include <string>
 
 #include "base/memory/memory_pressure_listener.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop.h"
 #include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "v8/include/v8.h"
 
 namespace atom {
 class JavascriptEnvironment;
@@ -20,10 +25,17 @@ class App;
 
 namespace brave {
 
-class V8WorkerThread : public base::Thread {
+class WorkerChannel;
+class WorkerMessage;
+class WorkerPool;
+class WorkerStats;
+
+class V8WorkerThread : public base::Thread,
+                       public base::MessageLoop::TaskObserver {
  public:
-  explicit V8WorkerThread(const std::string& name,
-      const std::string& module_name, atom::api::App* app);
+  V8WorkerThread(const std::string& name,
+      const std::string& module_name, atom::api::App* app,
+      scoped_refptr<WorkerStats> stats);
   ~V8WorkerThread() override;
 
   static V8WorkerThread* current();
@@ -33,12 +45,51 @@ class V8WorkerThread : public base::Thread {
   void Run(base::RunLoop* run_loop) override;
   void CleanUp() override;
 
+  // Makes the worker run the tasks of |pool| as its worker |index| once its
+  // module is loaded, must be called before Start.
+  void JoinPool(scoped_refptr<WorkerPool> pool, size_t index);
+
+  // Connects the current worker to |channel| and hands its end to the
+  // global onchannel function.
+  static void ConnectChannel(scoped_refptr<WorkerChannel> channel);
+  // Returns nullptr once the channel |channel_id| is gone.
+  WorkerChannel* GetChannel(int channel_id) const;
+  void CloseChannel(int channel_id);
+  // Called when receive() finds no message left on the closed channel
+  // |channel_id|, which then goes away in a task of its own.
+  void DidDrainChannel(int channel_id);
+
+  // Called for each message posted by the browser once the worker takes it.
+  void DidTakeMessage();
+
+  // base::MessageLoop::TaskObserver:
+  void WillProcessTask(const base::PendingTask& pending_task) override;
+  void DidProcessTask(const base::PendingTask& pending_task) override;
+
   atom::api::App* app() const { return app_; }
   atom::JavascriptEnvironment* env() const { return js_env_.get(); }
   const std::string& module_name() const { return module_name_; }
+  WorkerStats* stats() const { return stats_.get(); }
+  // Whether the worker exceeded its heap limit and is stopping, it runs no
+  // more script then.
+  bool terminating() const { return terminating_; }
 
  private:
-  void LoadModule();
+  // Records the heap size after each GC, and terminates the worker once it
+  // outgrows its limit.
+  static void OnGCEpilogue(v8::Isolate* isolate,
+                           v8::GCType type,
+                           v8::GCCallbackFlags flags);
+
+  // Returns false when the module could not be found.
+  bool LoadModule();
+  // Runs the tasks of the pool until there are none left.
+  void RunPoolTasks();
+  void RunPoolTask(int task_id, std::unique_ptr<WorkerMessage> message);
+  // Hands the messages of the channel |channel_id| to its onmessage.
+  void OnChannelReadable(int channel_id);
+  // Tells the channel |channel_id| that a send may succeed again.
+  void OnChannelWritable(int channel_id);
   void OnMemoryPressure(
     base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
 
@@ -46,6 +97,18 @@ class V8WorkerThread : public base::Thread {
   atom::api::App* app_;
   std::unique_ptr<atom::JavascriptEnvironment> js_env_;
   std::unique_ptr<base::MemoryPressureListener> memory_pressure_listener_;
+  scoped_refptr<WorkerStats> stats_;
+  bool terminating_;
+
+  scoped_refptr<WorkerPool> pool_;
+  size_t pool_index_;
+
+  // Startup metrics, emitted with worker-start.
+  const base::TimeTicks created_time_;
+  base::TimeDelta init_time_;
+
+  struct Channel;
+  std::map<int, std::unique_ptr<Channel>> channels_;
 };
 
 }  // namespace brave
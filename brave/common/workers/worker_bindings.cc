@@ -9,6 +9,8 @@
 
 #include "atom/browser/api/atom_api_app.h"
 #include "brave/common/workers/v8_worker_thread.h"
+#include "brave/common/workers/worker_channel.h"
+#include "brave/common/workers/worker_message.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/renderer/worker_thread_registry.h"
 #include "extensions/renderer/script_context.h"
@@ -31,16 +33,20 @@ bool SetReadOnlyProperty(v8::Local<v8::Context> context,
       static_cast<v8::PropertyAttribute>(v8::ReadOnly)));
 }
 
-void OnMessageInternal(const std::pair<uint8_t*, size_t>& buf) {
+void OnMessageInternal(std::unique_ptr<WorkerMessage> buf) {
+  V8WorkerThread* worker = V8WorkerThread::current();
+  if (!worker)
+    return;
+  worker->DidTakeMessage();
+  // Drop the messages queued before the worker exceeded its heap limit.
+  if (worker->terminating())
+    return;
+
   v8::Isolate* isolate = v8::Isolate::GetCurrent();
   v8::Local<v8::Context> context = isolate->GetCurrentContext();
 
-  v8::ValueDeserializer deserializer(
-      isolate, buf.first, buf.second);
-  deserializer.SetSupportsLegacyWireFormat(true);
-  if (deserializer.ReadHeader(context).FromMaybe(false)) {
-    v8::Local<v8::Value> message =
-        deserializer.ReadValue(context).ToLocalChecked();
+  v8::Local<v8::Value> message;
+  if (buf->Deserialize(isolate, context).ToLocal(&message)) {
     v8::Local<v8::Object> global = context->Global();
     v8::Local<v8::Value> onmessage =
         global->Get(context, v8::String::NewFromUtf8(isolate, "onmessage",
@@ -54,7 +60,56 @@ void OnMessageInternal(const std::pair<uint8_t*, size_t>& buf) {
       (void)onmessage_fun->Call(context, global, 1, argv);
     }
   }
-  free(buf.first);
+}
+
+// Returns the channel that |args| was bound to, or throws when it is gone.
+WorkerChannel* GetChannel(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  V8WorkerThread* worker = V8WorkerThread::current();
+  WorkerChannel* channel = nullptr;
+  if (worker)
+    channel = worker->GetChannel(args.Data().As<v8::Integer>()->Value());
+  if (!channel) {
+    args.GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        args.GetIsolate(), "The channel is closed"));
+  }
+  return channel;
+}
+
+void ChannelSend(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  WorkerChannel* channel = GetChannel(args);
+  if (!channel)
+    return;
+
+  std::string error;
+  WorkerChannel::SendResult result = channel->Send(
+      WorkerChannel::WORKER_END, args.GetIsolate(), args[0], &error);
+  if (result == WorkerChannel::SEND_FAILED) {
+    args.GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        args.GetIsolate(), error.c_str()));
+    return;
+  }
+  args.GetReturnValue().Set(result == WorkerChannel::SENT);
+}
+
+void ChannelReceive(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  WorkerChannel* channel = GetChannel(args);
+  if (!channel)
+    return;
+
+  // Look at the close first, the messages sent before it are then visible.
+  bool closed = channel->IsClosed();
+  v8::Local<v8::Value> message;
+  if (channel->Receive(WorkerChannel::WORKER_END, args.GetIsolate())
+          .ToLocal(&message))
+    args.GetReturnValue().Set(message);
+  else if (closed)
+    V8WorkerThread::current()->DidDrainChannel(channel->id());
+}
+
+void ChannelClose(const v8::FunctionCallbackInfo<v8::Value>& args) {
+  V8WorkerThread* worker = V8WorkerThread::current();
+  if (worker)
+    worker->CloseChannel(args.Data().As<v8::Integer>()->Value());
 }
 
 }  // namespace
@@ -81,6 +136,12 @@ WorkerBindings::WorkerBindings(extensions::ScriptContext* context,
           v8::NewStringType::kNormal).ToLocalChecked(),
       v8::Null(isolate));
 
+  // onchannel handler
+  SetProperty(v8_context, v8_context->Global(),
+      v8::String::NewFromUtf8(isolate, "onchannel",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Null(isolate));
+
   // pathname
   v8::Local<v8::Object> location = v8::Object::New(isolate);
   SetReadOnlyProperty(v8_context, location,
@@ -180,20 +241,15 @@ void WorkerBindings::Close(
 }
 
 void WorkerBindings::PostMessageOnUIThread(
-    const std::pair<uint8_t*, size_t>& buf) {
-  v8::ValueDeserializer deserializer(
-      worker_->app()->isolate(), buf.first, buf.second);
-  deserializer.SetSupportsLegacyWireFormat(true);
-  if (deserializer.ReadHeader(
-      worker_->app()->isolate()->GetCurrentContext()).FromMaybe(false)) {
-    v8::Local<v8::Value> val = deserializer.ReadValue(
-        worker_->app()->isolate()->GetCurrentContext()).ToLocalChecked();
+    std::unique_ptr<WorkerMessage> buf) {
+  v8::Isolate* isolate = worker_->app()->isolate();
+  v8::Local<v8::Value> val;
+  if (buf->Deserialize(isolate, isolate->GetCurrentContext()).ToLocal(&val)) {
     worker_->app()->Emit("worker-post-message", worker_->GetThreadId(), val);
   } else {
     worker_->app()->Emit("worker-onerror", worker_->GetThreadId(),
         "`postMessage` could not deserialize message buffer");
   }
-  free(buf.first);
 }
 
 void WorkerBindings::PostMessage(
@@ -204,46 +260,76 @@ void WorkerBindings::PostMessage(
     return;
   }
 
-  if (args.Length() > 1) {
-    context()->isolate()->ThrowException(v8::String::NewFromUtf8(
-        context()->isolate(), "`transferList` is not supported yet"));
-    return;
-  }
-
-  v8::ValueSerializer serializer(context()->isolate());
-  serializer.WriteHeader();
-  if (serializer.WriteValue(
-      context()->v8_context(), args[0]).FromMaybe(false)) {
-    std::pair<uint8_t*, size_t> buffer = serializer.Release();
-
+  std::string error;
+  std::unique_ptr<WorkerMessage> buffer = WorkerMessage::Serialize(
+      context()->isolate(), context()->v8_context(), args[0], args[1],
+      &error);
+  if (buffer) {
     BrowserThread::PostTask(BrowserThread::UI, FROM_HERE,
         base::Bind(&WorkerBindings::PostMessageOnUIThread,
                     weak_ptr_factory_.GetWeakPtr(),
-                    std::move(buffer)));
+                    base::Passed(&buffer)));
   } else {
     context()->isolate()->ThrowException(v8::String::NewFromUtf8(
-        context()->isolate(), "`postMessage` could not serialize message"));
+        context()->isolate(), error.c_str()));
   }
 }
 
+// static
+v8::Local<v8::Object> WorkerBindings::CreateChannel(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> context,
+    int channel_id) {
+  v8::Local<v8::Integer> id = v8::Integer::New(isolate, channel_id);
+  v8::Local<v8::Object> channel = v8::Object::New(isolate);
+  SetReadOnlyProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "id",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      id);
+  SetReadOnlyProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "send",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Function::New(context, &ChannelSend, id).ToLocalChecked());
+  SetReadOnlyProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "receive",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Function::New(context, &ChannelReceive, id).ToLocalChecked());
+  SetReadOnlyProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "close",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Function::New(context, &ChannelClose, id).ToLocalChecked());
+  SetProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "onmessage",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Null(isolate));
+  SetProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "onclose",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Null(isolate));
+  SetProperty(context, channel,
+      v8::String::NewFromUtf8(isolate, "ondrain",
+          v8::NewStringType::kNormal).ToLocalChecked(),
+      v8::Null(isolate));
+  return channel;
+}
+
 // static
 bool WorkerBindings::OnMessage(v8::Isolate* isolate,
                                 base::PlatformThreadId thread_id,
-                                v8::Local<v8::Value> message) {
-  v8::ValueSerializer serializer(isolate);
-  serializer.WriteHeader();
-  if (serializer.WriteValue(
-      isolate->GetCurrentContext(), message).FromMaybe(false)) {
-    std::pair<uint8_t*, size_t> buffer = serializer.Release();
-
-    base::TaskRunner* task_runner =
-        content::WorkerThreadRegistry::Instance()->GetTaskRunnerFor(thread_id);
-    task_runner->PostTask(FROM_HERE,
-        base::Bind(&OnMessageInternal,
-        std::move(buffer)));
-    return true;
-  }
-  return false;
+                                v8::Local<v8::Value> message,
+                                v8::Local<v8::Value> transfer_list,
+                                std::string* error) {
+  std::unique_ptr<WorkerMessage> buffer = WorkerMessage::Serialize(
+      isolate, isolate->GetCurrentContext(), message, transfer_list, error);
+  if (!buffer)
+    return false;
+
+  base::TaskRunner* task_runner =
+      content::WorkerThreadRegistry::Instance()->GetTaskRunnerFor(thread_id);
+  task_runner->PostTask(FROM_HERE,
+      base::Bind(&OnMessageInternal,
+      base::Passed(&buffer)));
+  return true;
 }
 
 }  // namespace brave
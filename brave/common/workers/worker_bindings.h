@@ -5,6 +5,7 @@
 #ifndef BRAVE_COMMON_WORKERS_WORKER_BINDINGS_H_
 #define BRAVE_COMMON_WORKERS_WORKER_BINDINGS_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -17,18 +18,29 @@
 namespace brave {
 
 class V8WorkerThread;
+class WorkerMessage;
 
 class WorkerBindings : public extensions::ObjectBackedNativeHandler {
  public:
   WorkerBindings(extensions::ScriptContext* context, V8WorkerThread* worker);
   ~WorkerBindings() override;
+  // Posts |message| to the worker |thread_id|, transferring the ArrayBuffers
+  // of |transfer_list|. Returns false with the reason in |error| when the
+  // message can not be posted.
   static bool OnMessage(v8::Isolate* isolate,
                         base::PlatformThreadId thread_id,
-                        v8::Local<v8::Value> message);
+                        v8::Local<v8::Value> message,
+                        v8::Local<v8::Value> transfer_list,
+                        std::string* error);
+  // Returns the object the worker uses for its end of the channel
+  // |channel_id|.
+  static v8::Local<v8::Object> CreateChannel(v8::Isolate* isolate,
+                                             v8::Local<v8::Context> context,
+                                             int channel_id);
 
  private:
   void Close(const v8::FunctionCallbackInfo<v8::Value>& args);
-  void PostMessageOnUIThread(const std::pair<uint8_t*, size_t>& buffer);
+  void PostMessageOnUIThread(std::unique_ptr<WorkerMessage> message);
   void PostMessage(const v8::FunctionCallbackInfo<v8::Value>& args);
   void OnErrorOnUIThread(const std::string& message, const std::string& stack);
   void OnError(const v8::FunctionCallbackInfo<v8::Value>& args);
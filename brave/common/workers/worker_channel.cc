@@ -0,0 +1,322 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/workers/worker_channel.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/location.h"
+
+namespace brave {
+
+namespace {
+
+const size_t kMinCapacity = 4 * 1024;
+const size_t kMaxCapacity = 256 * 1024 * 1024;
+
+size_t RoundUpToPowerOfTwo(size_t size) {
+  size_t result = kMinCapacity;
+  while (result < std::min(size, kMaxCapacity))
+    result <<= 1;
+  return result;
+}
+
+}  // namespace
+
+// static
+const size_t WorkerChannel::kDefaultCapacity = 1024 * 1024;
+
+WorkerChannel::Ring::Ring(size_t capacity)
+    : buffer(new char[capacity]),
+      write_position(0),
+      cached_read_position(0),
+      reserved_position(0),
+      waiting_for_space(0),
+      read_position(0),
+      cached_write_position(0),
+      waiting(0),
+      wake_producer_on_connect(false) {
+}
+
+WorkerChannel::Ring::~Ring() {
+}
+
+WorkerChannel::WorkerChannel(int id, size_t capacity)
+    : id_(id),
+      capacity_(RoundUpToPowerOfTwo(capacity)),
+      closed_(0),
+      to_browser_(capacity_),
+      to_worker_(capacity_) {
+}
+
+WorkerChannel::~WorkerChannel() {
+}
+
+size_t WorkerChannel::max_message_size() const {
+  return capacity_ / 2 - sizeof(MessageHeader);
+}
+
+void WorkerChannel::Connect(
+    End end,
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    const base::Closure& on_readable,
+    const base::Closure& on_writable) {
+  {
+    Ring* ring = outbound(end);
+    base::AutoLock lock(ring->lock);
+    ring->producer_task_runner = task_runner;
+    ring->on_writable = on_writable;
+    if (ring->wake_producer_on_connect) {
+      ring->wake_producer_on_connect = false;
+      ring->producer_task_runner->PostTask(FROM_HERE, ring->on_writable);
+    }
+  }
+  Ring* ring = inbound(end);
+  {
+    base::AutoLock lock(ring->lock);
+    ring->task_runner = std::move(task_runner);
+    ring->on_readable = on_readable;
+  }
+  // Deliver what was sent before the end connected.
+  WakeUp(ring, true);
+}
+
+WorkerChannel::SendResult WorkerChannel::Send(End from,
+                                              v8::Isolate* isolate,
+                                              v8::Local<v8::Value> value,
+                                              std::string* error) {
+  if (IsClosed()) {
+    *error = "The channel is closed";
+    return SEND_FAILED;
+  }
+
+  Ring* ring = outbound(from);
+  size_t size = 0;
+  char* data = nullptr;
+  if (value->IsString()) {
+    v8::Local<v8::String> string = value.As<v8::String>();
+    size = string->Utf8Length();
+    if (size <= max_message_size()) {
+      data = Reserve(ring, STRING_MESSAGE, size);
+      if (data)
+        string->WriteUtf8(data, size, nullptr,
+                          v8::String::NO_NULL_TERMINATION);
+    }
+  } else if (value->IsArrayBuffer()) {
+    v8::ArrayBuffer::Contents contents =
+        value.As<v8::ArrayBuffer>()->GetContents();
+    size = contents.ByteLength();
+    if (size <= max_message_size()) {
+      data = Reserve(ring, BINARY_MESSAGE, size);
+      if (data)
+        memcpy(data, contents.Data(), size);
+    }
+  } else if (value->IsArrayBufferView()) {
+    v8::Local<v8::ArrayBufferView> view = value.As<v8::ArrayBufferView>();
+    size = view->ByteLength();
+    if (size <= max_message_size()) {
+      data = Reserve(ring, BINARY_MESSAGE, size);
+      if (data)
+        view->CopyContents(data, size);
+    }
+  } else {
+    *error = "A channel message must be a string, an ArrayBuffer or a view";
+    return SEND_FAILED;
+  }
+
+  if (size > max_message_size()) {
+    *error = "The message is larger than half of the channel capacity";
+    return SEND_FAILED;
+  }
+  if (!data)
+    return CHANNEL_FULL;
+
+  Commit(ring);
+  return SENT;
+}
+
+v8::MaybeLocal<v8::Value> WorkerChannel::Receive(End to,
+                                                 v8::Isolate* isolate) {
+  Ring* ring = inbound(to);
+  const MessageHeader* header = nullptr;
+  if (!Peek(ring, &header))
+    return v8::MaybeLocal<v8::Value>();
+
+  const char* data = reinterpret_cast<const char*>(header + 1);
+  v8::Local<v8::Value> value;
+  if (header->type == STRING_MESSAGE) {
+    v8::Local<v8::String> string;
+    if (!v8::String::NewFromUtf8(isolate, data, v8::NewStringType::kNormal,
+                                 header->size).ToLocal(&string))
+      string = v8::String::Empty(isolate);
+    value = string;
+  } else {
+    v8::Local<v8::ArrayBuffer> buffer =
+        v8::ArrayBuffer::New(isolate, header->size);
+    memcpy(buffer->GetContents().Data(), data, header->size);
+    value = buffer;
+  }
+  Pop(ring);
+  return value;
+}
+
+void WorkerChannel::Close() {
+  base::subtle::Release_Store(&closed_, 1);
+  WakeUp(&to_browser_, true);
+  WakeUp(&to_worker_, true);
+}
+
+bool WorkerChannel::IsClosed() const {
+  return base::subtle::Acquire_Load(&closed_) != 0;
+}
+
+bool WorkerChannel::IsDrained(End end) {
+  // Every message sent before the close is visible once it is seen.
+  if (!IsClosed())
+    return false;
+  const MessageHeader* header = nullptr;
+  return !Peek(inbound(end), &header);
+}
+
+// static
+size_t WorkerChannel::RecordSize(size_t size) {
+  // Keep the headers aligned.
+  const size_t alignment = sizeof(MessageHeader);
+  return (sizeof(MessageHeader) + size + alignment - 1) & ~(alignment - 1);
+}
+
+char* WorkerChannel::Reserve(Ring* ring, MessageType type, size_t size) {
+  const size_t record_size = RecordSize(size);
+  size_t write_position =
+      static_cast<size_t>(base::subtle::NoBarrier_Load(&ring->write_position));
+  size_t offset = write_position & (capacity_ - 1);
+  size_t contiguous = capacity_ - offset;
+  // A message that does not fit before the end of the ring starts over at
+  // its beginning, so that it can always be read in place.
+  size_t needed =
+      record_size <= contiguous ? record_size : contiguous + record_size;
+  if (capacity_ - (write_position - ring->cached_read_position) < needed) {
+    ring->cached_read_position = static_cast<size_t>(
+        base::subtle::Acquire_Load(&ring->read_position));
+    if (capacity_ - (write_position - ring->cached_read_position) < needed) {
+      // Ask to be woken, then look again in case the consumer made space
+      // before it could see the request.
+      base::subtle::NoBarrier_Store(&ring->waiting_for_space, 1);
+      base::subtle::MemoryBarrier();
+      ring->cached_read_position = static_cast<size_t>(
+          base::subtle::Acquire_Load(&ring->read_position));
+      if (capacity_ - (write_position - ring->cached_read_position) < needed)
+        return nullptr;
+      base::subtle::NoBarrier_Store(&ring->waiting_for_space, 0);
+    }
+  }
+
+  if (record_size > contiguous) {
+    MessageHeader* padding =
+        reinterpret_cast<MessageHeader*>(&ring->buffer[offset]);
+    padding->size = 0;
+    padding->type = PADDING_MESSAGE;
+    write_position += contiguous;
+    offset = 0;
+  }
+
+  MessageHeader* header =
+      reinterpret_cast<MessageHeader*>(&ring->buffer[offset]);
+  header->size = static_cast<uint32_t>(size);
+  header->type = type;
+  ring->reserved_position = write_position + record_size;
+  return reinterpret_cast<char*>(header + 1);
+}
+
+void WorkerChannel::Commit(Ring* ring) {
+  base::subtle::Release_Store(
+      &ring->write_position,
+      static_cast<base::subtle::AtomicWord>(ring->reserved_position));
+  WakeUp(ring, false);
+}
+
+bool WorkerChannel::Peek(Ring* ring, const MessageHeader** header) {
+  size_t read_position =
+      static_cast<size_t>(base::subtle::NoBarrier_Load(&ring->read_position));
+  for (;;) {
+    if (read_position == ring->cached_write_position) {
+      ring->cached_write_position = static_cast<size_t>(
+          base::subtle::Acquire_Load(&ring->write_position));
+    }
+    if (read_position == ring->cached_write_position) {
+      // Ask to be woken, then look again in case the producer wrote before
+      // it could see the request.
+      base::subtle::NoBarrier_Store(&ring->waiting, 1);
+      base::subtle::MemoryBarrier();
+      ring->cached_write_position = static_cast<size_t>(
+          base::subtle::Acquire_Load(&ring->write_position));
+      if (read_position == ring->cached_write_position)
+        return false;
+      base::subtle::NoBarrier_Store(&ring->waiting, 0);
+    }
+
+    size_t offset = read_position & (capacity_ - 1);
+    const MessageHeader* next =
+        reinterpret_cast<const MessageHeader*>(&ring->buffer[offset]);
+    if (next->type != PADDING_MESSAGE) {
+      *header = next;
+      return true;
+    }
+    read_position += capacity_ - offset;
+    base::subtle::Release_Store(
+        &ring->read_position,
+        static_cast<base::subtle::AtomicWord>(read_position));
+    WakeUpProducer(ring);
+  }
+}
+
+void WorkerChannel::Pop(Ring* ring) {
+  size_t read_position =
+      static_cast<size_t>(base::subtle::NoBarrier_Load(&ring->read_position));
+  const MessageHeader* header = reinterpret_cast<const MessageHeader*>(
+      &ring->buffer[read_position & (capacity_ - 1)]);
+  const size_t record_size = RecordSize(header->size);
+  base::subtle::Release_Store(
+      &ring->read_position,
+      static_cast<base::subtle::AtomicWord>(read_position + record_size));
+  WakeUpProducer(ring);
+}
+
+void WorkerChannel::WakeUp(Ring* ring, bool force) {
+  if (force) {
+    base::subtle::NoBarrier_Store(&ring->waiting, 0);
+  } else {
+    // Pairs with the barrier in Peek, either the consumer sees the message
+    // or this sees it waiting.
+    base::subtle::MemoryBarrier();
+    if (!base::subtle::NoBarrier_Load(&ring->waiting) ||
+        base::subtle::NoBarrier_CompareAndSwap(&ring->waiting, 1, 0) != 1)
+      return;
+  }
+
+  base::AutoLock lock(ring->lock);
+  if (ring->task_runner)
+    ring->task_runner->PostTask(FROM_HERE, ring->on_readable);
+}
+
+void WorkerChannel::WakeUpProducer(Ring* ring) {
+  // Pairs with the barrier in Reserve, either the producer sees the space
+  // or this sees it waiting.
+  base::subtle::MemoryBarrier();
+  if (!base::subtle::NoBarrier_Load(&ring->waiting_for_space) ||
+      base::subtle::NoBarrier_CompareAndSwap(
+          &ring->waiting_for_space, 1, 0) != 1)
+    return;
+
+  base::AutoLock lock(ring->lock);
+  if (ring->producer_task_runner)
+    ring->producer_task_runner->PostTask(FROM_HERE, ring->on_writable);
+  else
+    ring->wake_producer_on_connect = true;
+}
+
+}  // namespace brave
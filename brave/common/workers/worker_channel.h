@@ -0,0 +1,173 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_WORKERS_WORKER_CHANNEL_H_
+#define BRAVE_COMMON_WORKERS_WORKER_CHANNEL_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/atomicops.h"
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/single_thread_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+// A two way channel between the browser and a worker. Each direction is a
+// ring of memory shared by the two threads with a single producer and a
+// single consumer, so sending and receiving a message takes no lock, no
+// allocation and no task. The consumer is only woken with a task when it
+// had run out of messages. Messages are strings or binary data.
+class WorkerChannel : public base::RefCountedThreadSafe<WorkerChannel> {
+ public:
+  enum End {
+    BROWSER_END,
+    WORKER_END,
+  };
+
+  enum SendResult {
+    SENT,
+    // The ring is full until the other end catches up, the sender is woken
+    // with its |on_writable| then.
+    CHANNEL_FULL,
+    SEND_FAILED,
+  };
+
+  static const size_t kDefaultCapacity;
+
+  // |capacity| is the size of the ring in each direction in bytes, it is
+  // rounded up to a power of two.
+  WorkerChannel(int id, size_t capacity);
+
+  int id() const { return id_; }
+  size_t capacity() const { return capacity_; }
+  // Messages are limited to half of the ring so that they always fit once
+  // the other end has caught up.
+  size_t max_message_size() const;
+
+  // Must be called once by each end with the thread it runs on.
+  // |on_readable| is posted to |task_runner| when a message arrives while
+  // the end waits for one, and when the channel is closed. |on_writable| is
+  // posted when the other end frees space after a Send found the ring full.
+  void Connect(End end,
+               scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+               const base::Closure& on_readable,
+               const base::Closure& on_writable);
+
+  // Copies |value|, a string, an ArrayBuffer or a view of one, to the ring
+  // read by the other end. Returns SEND_FAILED with the reason in |error|
+  // when the message can not be sent. Must only be called by |from|.
+  SendResult Send(End from,
+                  v8::Isolate* isolate,
+                  v8::Local<v8::Value> value,
+                  std::string* error);
+
+  // Returns the next message sent to |to|, or an empty handle when there is
+  // none, in which case |to| will be woken by the next one. Must only be
+  // called by |to|.
+  v8::MaybeLocal<v8::Value> Receive(End to, v8::Isolate* isolate);
+
+  // Wakes both ends, which find the channel closed once they have received
+  // the messages that are left.
+  void Close();
+  bool IsClosed() const;
+  // Whether the channel is closed and |end| has received all the messages
+  // that were left. Must only be called by |end|.
+  bool IsDrained(End end);
+
+ private:
+  friend class base::RefCountedThreadSafe<WorkerChannel>;
+  ~WorkerChannel();
+
+  enum MessageType : uint32_t {
+    // Marks the space left at the end of the ring when a message did not
+    // fit there.
+    PADDING_MESSAGE,
+    STRING_MESSAGE,
+    BINARY_MESSAGE,
+  };
+
+  struct MessageHeader {
+    uint32_t size;
+    uint32_t type;
+  };
+
+  struct Ring {
+    explicit Ring(size_t capacity);
+    ~Ring();
+
+    std::unique_ptr<char[]> buffer;
+
+    // The positions only ever grow, and are masked to index |buffer|. They
+    // are kept on separate cache lines together with the copy each side
+    // has of the other's position, so that the producer and the consumer
+    // only touch each other's line when the copy is out of date.
+    base::subtle::AtomicWord write_position;
+    size_t cached_read_position;
+    size_t reserved_position;
+    base::subtle::Atomic32 waiting_for_space;
+    char padding1[64];
+    base::subtle::AtomicWord read_position;
+    size_t cached_write_position;
+    base::subtle::Atomic32 waiting;
+    char padding2[64];
+
+    // The consumer's thread and wake up, and the producer's.
+    base::Lock lock;
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+    base::Closure on_readable;
+    scoped_refptr<base::SingleThreadTaskRunner> producer_task_runner;
+    base::Closure on_writable;
+    // Whether the producer was to be woken before it connected.
+    bool wake_producer_on_connect;
+  };
+
+  // The ring that |end| receives from, and the one it sends to.
+  Ring* inbound(End end) {
+    return end == BROWSER_END ? &to_browser_ : &to_worker_;
+  }
+  Ring* outbound(End end) {
+    return end == BROWSER_END ? &to_worker_ : &to_browser_;
+  }
+
+  // The space taken in the ring by a message of |size| bytes.
+  static size_t RecordSize(size_t size);
+
+  // Returns where |size| bytes of a message of |type| can be written to
+  // |ring|, or nullptr when the ring is full, in which case the producer
+  // will be woken once the consumer frees space. The message is not visible
+  // to the consumer until Commit.
+  char* Reserve(Ring* ring, MessageType type, size_t size);
+  void Commit(Ring* ring);
+
+  // Points |header| at the next message of |ring|, which stays in place
+  // until Pop. Returns false and waits for the producer when there is none.
+  bool Peek(Ring* ring, const MessageHeader** header);
+  void Pop(Ring* ring);
+
+  // Posts the consumer's |on_readable| if it waits for a message, or in any
+  // case when |force| is true.
+  void WakeUp(Ring* ring, bool force);
+  // Posts the producer's |on_writable| if it waits for space.
+  void WakeUpProducer(Ring* ring);
+
+  const int id_;
+  const size_t capacity_;
+  base::subtle::Atomic32 closed_;
+
+  Ring to_browser_;
+  Ring to_worker_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerChannel);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_WORKERS_WORKER_CHANNEL_H_
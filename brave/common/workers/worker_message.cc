@@ -0,0 +1,101 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/workers/worker_message.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "gin/array_buffer.h"
+
+namespace brave {
+
+WorkerMessage::WorkerMessage() : data_(nullptr, 0) {
+}
+
+WorkerMessage::~WorkerMessage() {
+  free(data_.first);
+  // Every isolate uses the allocator of gin, which owns the contents that
+  // were never adopted.
+  for (const auto& contents : array_buffers_) {
+    gin::ArrayBufferAllocator::SharedInstance()->Free(contents.Data(),
+                                                      contents.ByteLength());
+  }
+}
+
+// static
+std::unique_ptr<WorkerMessage> WorkerMessage::Serialize(
+    v8::Isolate* isolate,
+    v8::Local<v8::Context> context,
+    v8::Local<v8::Value> value,
+    v8::Local<v8::Value> transfer_list,
+    std::string* error) {
+  std::vector<v8::Local<v8::ArrayBuffer>> array_buffers;
+  if (!transfer_list.IsEmpty() && !transfer_list->IsUndefined()) {
+    if (!transfer_list->IsArray()) {
+      *error = "`transferList` must be an Array";
+      return nullptr;
+    }
+    v8::Local<v8::Array> list = transfer_list.As<v8::Array>();
+    for (uint32_t i = 0; i < list->Length(); ++i) {
+      v8::Local<v8::Value> item;
+      if (!list->Get(context, i).ToLocal(&item) || !item->IsArrayBuffer()) {
+        *error = "`transferList` may only contain ArrayBuffers";
+        return nullptr;
+      }
+      v8::Local<v8::ArrayBuffer> array_buffer = item.As<v8::ArrayBuffer>();
+      if (std::find(array_buffers.begin(), array_buffers.end(),
+                    array_buffer) != array_buffers.end()) {
+        *error = "An ArrayBuffer is listed more than once in `transferList`";
+        return nullptr;
+      }
+      if (array_buffer->IsExternal() || !array_buffer->IsNeuterable()) {
+        *error = "An ArrayBuffer in `transferList` can not be transferred";
+        return nullptr;
+      }
+      array_buffers.push_back(array_buffer);
+    }
+  }
+
+  v8::ValueSerializer serializer(isolate);
+  for (size_t i = 0; i < array_buffers.size(); ++i)
+    serializer.TransferArrayBuffer(static_cast<uint32_t>(i), array_buffers[i]);
+  serializer.WriteHeader();
+  v8::TryCatch try_catch(isolate);
+  if (!serializer.WriteValue(context, value).FromMaybe(false)) {
+    *error = "`postMessage` could not serialize message";
+    return nullptr;
+  }
+
+  std::unique_ptr<WorkerMessage> message(new WorkerMessage);
+  message->data_ = serializer.Release();
+  // Only detach the ArrayBuffers once nothing can fail anymore.
+  for (auto array_buffer : array_buffers) {
+    message->array_buffers_.push_back(array_buffer->Externalize());
+    array_buffer->Neuter();
+  }
+  return message;
+}
+
+v8::MaybeLocal<v8::Value> WorkerMessage::Deserialize(
+    v8::Isolate* isolate, v8::Local<v8::Context> context) {
+  v8::ValueDeserializer deserializer(isolate, data_.first, data_.second);
+  deserializer.SetSupportsLegacyWireFormat(true);
+  for (size_t i = 0; i < array_buffers_.size(); ++i) {
+    deserializer.TransferArrayBuffer(
+        static_cast<uint32_t>(i),
+        v8::ArrayBuffer::New(isolate, array_buffers_[i].Data(),
+                             array_buffers_[i].ByteLength(),
+                             v8::ArrayBufferCreationMode::kInternalized));
+  }
+  // The new ArrayBuffers own the contents now.
+  array_buffers_.clear();
+
+  if (!deserializer.ReadHeader(context).FromMaybe(false))
+    return v8::MaybeLocal<v8::Value>();
+  return deserializer.ReadValue(context);
+}
+
+}  // namespace brave
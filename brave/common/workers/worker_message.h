@@ -0,0 +1,51 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
+#define BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+// A message posted between the browser and a worker isolate. The contents of
+// the ArrayBuffers in its transfer list move along with it instead of being
+// copied, and are owned by the message until the other side adopts them.
+class WorkerMessage {
+ public:
+  ~WorkerMessage();
+
+  // Serializes |value| and detaches the ArrayBuffers of |transfer_list|,
+  // which can be undefined. Returns nullptr with the reason in |error| when
+  // the message can not be posted.
+  static std::unique_ptr<WorkerMessage> Serialize(
+      v8::Isolate* isolate,
+      v8::Local<v8::Context> context,
+      v8::Local<v8::Value> value,
+      v8::Local<v8::Value> transfer_list,
+      std::string* error);
+
+  // Deserializes the message in |context|, the transferred ArrayBuffers take
+  // over their contents. Can only be called once.
+  v8::MaybeLocal<v8::Value> Deserialize(v8::Isolate* isolate,
+                                        v8::Local<v8::Context> context);
+
+ private:
+  WorkerMessage();
+
+  std::pair<uint8_t*, size_t> data_;
+  std::vector<v8::ArrayBuffer::Contents> array_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerMessage);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
@@ -0,0 +1,180 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/workers/worker_pool.h"
+
+#include <utility>
+
+#include "brave/common/workers/worker_message.h"
+
+namespace brave {
+
+WorkerPool::Task::Task(int id, std::unique_ptr<WorkerMessage> message)
+    : id(id), message(std::move(message)) {
+}
+
+WorkerPool::Task::~Task() {
+}
+
+WorkerPool::Worker::Worker()
+    : running_task(0), started(false), idle(false), removed(false) {
+}
+
+WorkerPool::Worker::~Worker() {
+}
+
+WorkerPool::WorkerPool(int id, const TaskDroppedCallback& task_dropped)
+    : id_(id),
+      task_dropped_(task_dropped),
+      next_worker_(0),
+      next_task_id_(1),
+      closed_(false) {
+}
+
+WorkerPool::~WorkerPool() {
+}
+
+size_t WorkerPool::AddWorker() {
+  base::AutoLock lock(lock_);
+  workers_.push_back(std::make_unique<Worker>());
+  return workers_.size() - 1;
+}
+
+bool WorkerPool::StartWorker(
+    size_t index,
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    const base::Closure& run_tasks) {
+  base::AutoLock lock(lock_);
+  if (closed_)
+    return false;
+
+  Worker* worker = workers_[index].get();
+  worker->task_runner = std::move(task_runner);
+  worker->run_tasks = run_tasks;
+  worker->started = true;
+  worker->idle = true;
+  // Pick up the tasks queued before the worker started, its own or others'.
+  for (const auto& other : workers_) {
+    if (!other->tasks.empty()) {
+      WakeUpWorker(worker);
+      break;
+    }
+  }
+  return true;
+}
+
+void WorkerPool::RemoveWorker(size_t index) {
+  std::vector<int> dropped;
+  {
+    base::AutoLock lock(lock_);
+    Worker* removed = workers_[index].get();
+    removed->removed = true;
+    removed->idle = false;
+    if (removed->running_task)
+      dropped.push_back(removed->running_task);
+    removed->running_task = 0;
+    std::deque<std::unique_ptr<Task>> tasks;
+    tasks.swap(removed->tasks);
+
+    for (size_t i = 0; i < workers_.size() && !tasks.empty(); ++i) {
+      Worker* worker = workers_[i].get();
+      if (worker->removed)
+        continue;
+      while (!tasks.empty()) {
+        worker->tasks.push_back(std::move(tasks.front()));
+        tasks.pop_front();
+      }
+      WakeUp(i);
+    }
+    for (const auto& task : tasks)
+      dropped.push_back(task->id);
+  }
+
+  for (int task_id : dropped)
+    task_dropped_.Run(task_id, "The worker running the task has stopped");
+}
+
+int WorkerPool::PostTask(std::unique_ptr<WorkerMessage> message) {
+  base::AutoLock lock(lock_);
+  if (closed_)
+    return -1;
+
+  // Round robin over the workers that are still running.
+  for (size_t tries = 0; tries < workers_.size(); ++tries) {
+    size_t index = next_worker_++ % workers_.size();
+    if (workers_[index]->removed)
+      continue;
+    int id = next_task_id_++;
+    workers_[index]->tasks.push_back(
+        std::make_unique<Task>(id, std::move(message)));
+    WakeUp(index);
+    return id;
+  }
+  return -1;
+}
+
+std::unique_ptr<WorkerPool::Task> WorkerPool::TakeTask(size_t index) {
+  base::AutoLock lock(lock_);
+  Worker* worker = workers_[index].get();
+  if (!worker->tasks.empty()) {
+    std::unique_ptr<Task> task = std::move(worker->tasks.front());
+    worker->tasks.pop_front();
+    worker->running_task = task->id;
+    return task;
+  }
+
+  // Steal the task that its owner would get to last.
+  Worker* victim = nullptr;
+  for (const auto& other : workers_) {
+    if (!victim || other->tasks.size() > victim->tasks.size())
+      victim = other.get();
+  }
+  if (victim && !victim->tasks.empty()) {
+    std::unique_ptr<Task> task = std::move(victim->tasks.back());
+    victim->tasks.pop_back();
+    worker->running_task = task->id;
+    return task;
+  }
+
+  worker->idle = true;
+  return nullptr;
+}
+
+void WorkerPool::DidRunTask(size_t index) {
+  base::AutoLock lock(lock_);
+  workers_[index]->running_task = 0;
+}
+
+void WorkerPool::Close(const base::Closure& stop_worker) {
+  base::AutoLock lock(lock_);
+  closed_ = true;
+  for (const auto& worker : workers_) {
+    worker->tasks.clear();
+    // Workers that did not start yet stop in StartWorker.
+    if (worker->started && !worker->removed)
+      worker->task_runner->PostTask(FROM_HERE, stop_worker);
+  }
+}
+
+void WorkerPool::WakeUp(size_t index) {
+  lock_.AssertAcquired();
+  Worker* worker = workers_[index].get();
+  if (worker->idle) {
+    WakeUpWorker(worker);
+    return;
+  }
+  for (const auto& other : workers_) {
+    if (other->idle && !other->removed) {
+      WakeUpWorker(other.get());
+      return;
+    }
+  }
+}
+
+void WorkerPool::WakeUpWorker(Worker* worker) {
+  worker->idle = false;
+  worker->task_runner->PostTask(FROM_HERE, worker->run_tasks);
+}
+
+}  // namespace brave
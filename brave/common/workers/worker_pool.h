@@ -0,0 +1,108 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_WORKERS_WORKER_POOL_H_
+#define BRAVE_COMMON_WORKERS_WORKER_POOL_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/single_thread_task_runner.h"
+#include "base/synchronization/lock.h"
+
+namespace brave {
+
+class WorkerMessage;
+
+// Hands out the tasks posted to a pool of workers running the same module.
+// Each worker has a queue of its own that tasks are posted to in turn, and
+// a worker whose queue is empty steals from the back of the longest queue.
+// Used from the UI thread and from the workers.
+class WorkerPool : public base::RefCountedThreadSafe<WorkerPool> {
+ public:
+  struct Task {
+    Task(int id, std::unique_ptr<WorkerMessage> message);
+    ~Task();
+
+    int id;
+    std::unique_ptr<WorkerMessage> message;
+  };
+
+  // Run for every task that is dropped without a result, on the thread that
+  // drops it and without the lock held.
+  typedef base::Callback<void(int task_id, const std::string& error)>
+      TaskDroppedCallback;
+
+  WorkerPool(int id, const TaskDroppedCallback& task_dropped);
+
+  int id() const { return id_; }
+
+  // Adds a worker before its thread starts, tasks are queued for it but only
+  // stolen by the others until StartWorker. Returns the index of the worker.
+  size_t AddWorker();
+  // Called by the worker |index| once it can run tasks, |run_tasks| is
+  // posted to |task_runner| when the worker is idle and there is a task for
+  // it. Returns false when the pool has been closed meanwhile.
+  bool StartWorker(size_t index,
+                   scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+                   const base::Closure& run_tasks);
+  // Hands the queued tasks of the worker |index| to the others, or drops
+  // them when there are none left. The task it was running is dropped.
+  void RemoveWorker(size_t index);
+
+  // Queues |message| for the next worker, returns the id of the task or -1
+  // when the pool has no workers left.
+  int PostTask(std::unique_ptr<WorkerMessage> message);
+  // Returns the next task of the worker |index|, or nullptr once there is
+  // nothing left to do and the worker goes idle. The worker must call
+  // DidRunTask once it has sent the result of the task.
+  std::unique_ptr<Task> TakeTask(size_t index);
+  void DidRunTask(size_t index);
+
+  // Drops the queued tasks and posts |stop_worker| to every worker.
+  void Close(const base::Closure& stop_worker);
+
+ private:
+  friend class base::RefCountedThreadSafe<WorkerPool>;
+  ~WorkerPool();
+
+  struct Worker {
+    Worker();
+    ~Worker();
+
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner;
+    base::Closure run_tasks;
+    std::deque<std::unique_ptr<Task>> tasks;
+    // The task taken by the worker that it has not finished yet, or 0.
+    int running_task;
+    // Only started workers that wait for tasks are woken.
+    bool started;
+    bool idle;
+    bool removed;
+  };
+
+  // Wakes the worker |index| when it is idle, otherwise another idle worker
+  // that can steal the task. Must be called with |lock_| held.
+  void WakeUp(size_t index);
+  void WakeUpWorker(Worker* worker);
+
+  const int id_;
+  const TaskDroppedCallback task_dropped_;
+
+  base::Lock lock_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t next_worker_;
+  int next_task_id_;
+  bool closed_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_WORKERS_WORKER_POOL_H_
@@ -0,0 +1,64 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/workers/worker_stats.h"
+
+#include "base/values.h"
+
+namespace brave {
+
+WorkerStats::WorkerStats(size_t max_heap_size, size_t max_queue_length)
+    : max_heap_size_(max_heap_size),
+      max_queue_length_(max_queue_length),
+      queue_length_(0),
+      used_heap_size_(0),
+      total_heap_size_(0) {
+}
+
+WorkerStats::~WorkerStats() {
+}
+
+bool WorkerStats::CanPostMessage() const {
+  base::AutoLock lock(lock_);
+  return !max_queue_length_ || queue_length_ < max_queue_length_;
+}
+
+void WorkerStats::DidPostMessage() {
+  base::AutoLock lock(lock_);
+  ++queue_length_;
+}
+
+bool WorkerStats::DidTakeMessage() {
+  base::AutoLock lock(lock_);
+  if (!queue_length_)
+    return false;
+  bool was_full = max_queue_length_ && queue_length_ == max_queue_length_;
+  --queue_length_;
+  return was_full;
+}
+
+void WorkerStats::SetCpuTime(base::TimeDelta cpu_time) {
+  base::AutoLock lock(lock_);
+  cpu_time_ = cpu_time;
+}
+
+void WorkerStats::SetHeapSize(size_t used_heap_size, size_t total_heap_size) {
+  base::AutoLock lock(lock_);
+  used_heap_size_ = used_heap_size;
+  total_heap_size_ = total_heap_size;
+}
+
+std::unique_ptr<base::DictionaryValue> WorkerStats::ToValue() const {
+  base::AutoLock lock(lock_);
+  auto value = std::make_unique<base::DictionaryValue>();
+  value->SetDouble("cpuTime", cpu_time_.InMillisecondsF());
+  value->SetInteger("queueLength", static_cast<int>(queue_length_));
+  value->SetInteger("maxQueueLength", static_cast<int>(max_queue_length_));
+  value->SetDouble("usedHeapSize", static_cast<double>(used_heap_size_));
+  value->SetDouble("totalHeapSize", static_cast<double>(total_heap_size_));
+  value->SetDouble("maxHeapSize", static_cast<double>(max_heap_size_));
+  return value;
+}
+
+}  // namespace brave
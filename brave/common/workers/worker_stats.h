@@ -0,0 +1,60 @@
+// Copyright (c) 2017 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_WORKERS_WORKER_STATS_H_
+#define BRAVE_COMMON_WORKERS_WORKER_STATS_H_
+
+#include <memory>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+namespace base {
+class DictionaryValue;
+}
+
+namespace brave {
+
+// The limits and the resource usage of a worker. The worker updates the
+// usage, the browser reads it and keeps the queue of the messages posted to
+// the worker within |max_queue_length|.
+class WorkerStats : public base::RefCountedThreadSafe<WorkerStats> {
+ public:
+  // A limit of 0 means none.
+  WorkerStats(size_t max_heap_size, size_t max_queue_length);
+
+  size_t max_heap_size() const { return max_heap_size_; }
+
+  // Called by the browser, returns false while the queue is full.
+  bool CanPostMessage() const;
+  void DidPostMessage();
+  // Called by the worker, returns true when the queue was full until now.
+  bool DidTakeMessage();
+
+  void SetCpuTime(base::TimeDelta cpu_time);
+  void SetHeapSize(size_t used_heap_size, size_t total_heap_size);
+
+  std::unique_ptr<base::DictionaryValue> ToValue() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<WorkerStats>;
+  ~WorkerStats();
+
+  const size_t max_heap_size_;
+  const size_t max_queue_length_;
+
+  mutable base::Lock lock_;
+  size_t queue_length_;
+  base::TimeDelta cpu_time_;
+  size_t used_heap_size_;
+  size_t total_heap_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerStats);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_WORKERS_WORKER_STATS_H_
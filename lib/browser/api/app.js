@@ -59,8 +59,9 @@ app.postMessage = function (message) {
   app.emit('app-post-message', {}, message)
 }
 
-function Worker (module_name) {
+function Worker (module_name, options) {
   this.module_name = module_name
+  this.options = options || {}
   this.lastError = null
   this.__onerror = null
   this.onmessage = null
@@ -68,18 +69,28 @@ function Worker (module_name) {
 
 Worker.prototype.start = function (cb) {
   cb && this.once('start', cb)
-  this.id = app._startWorker(this.module_name)
+  this.id = app._startWorker(this.module_name, this.options)
 }
 
-Worker.prototype.postMessage = function (message) {
+// Returns false while the queue of the worker is full, 'drain' is emitted
+// once it can take messages again.
+Worker.prototype.postMessage = function (message, transferList) {
   const evt = {data: message}
-  app._postMessage(this.id, evt)
+  return app._postMessage(this.id, evt, transferList)
+}
+
+Worker.prototype.getStats = function () {
+  return app.getWorkerStats(this.id)
 }
 
 Worker.prototype.terminate = function () {
   app.stopWorker(this.id)
 }
 
+Worker.prototype.createChannel = function (capacity) {
+  return new WorkerChannel(this.id, capacity)
+}
+
 Object.defineProperty(Worker.prototype, 'onerror', {
   get: function () { return this.__onerror },
   set: function (cb) {
@@ -90,14 +101,15 @@ Object.defineProperty(Worker.prototype, 'onerror', {
 
 Object.setPrototypeOf(Worker.prototype, EventEmitter.prototype)
 
-app.createWorker = function (module_name) {
-  const worker = new Worker(module_name)
+app.createWorker = function (module_name, options) {
+  const worker = new Worker(module_name, options)
 
   // It is always safe to call the worker methods because
   // WorkerThreadRegistry will return a dummy task runner
-  app.on('worker-start', (e, worker_id) => {
+  app.on('worker-start', (e, worker_id, metrics) => {
     if (worker.id === worker_id) {
-      worker.emit('start', {})
+      worker.startupMetrics = metrics
+      worker.emit('start', {metrics})
     }
   })
   app.on('worker-stop', (e, worker_id) => {
@@ -105,6 +117,11 @@ app.createWorker = function (module_name) {
       worker.emit('stop', {})
     }
   })
+  app.on('worker-drain', (e, worker_id) => {
+    if (worker.id === worker_id) {
+      worker.emit('drain', {})
+    }
+  })
   app.on('worker-post-message', (e, worker_id, message) => {
     if (worker.id === worker_id) {
       const event = {data: message}
@@ -125,6 +142,113 @@ app.createWorker = function (module_name) {
   return worker
 }
 
+const workerPools = new Map()
+
+function WorkerPool (module_name, size) {
+  this.module_name = module_name
+  this.id = app._startWorkerPool(module_name, size || 0)
+  this.pendingTasks = new Map()
+  workerPools.set(this.id, this)
+}
+
+WorkerPool.prototype.postTask = function (data, transferList) {
+  return new Promise((resolve, reject) => {
+    const taskId = app._postWorkerTask(this.id, data, transferList)
+    this.pendingTasks.set(taskId, {resolve, reject})
+  })
+}
+
+WorkerPool.prototype.terminate = function () {
+  app._stopWorkerPool(this.id)
+  workerPools.delete(this.id)
+  for (const task of this.pendingTasks.values()) {
+    task.reject(new Error('The worker pool has been terminated'))
+  }
+  this.pendingTasks.clear()
+}
+
+app.on('worker-task-done', (e, pool_id, task_id, error, result) => {
+  const pool = workerPools.get(pool_id)
+  const task = pool && pool.pendingTasks.get(task_id)
+  if (!task) return
+  pool.pendingTasks.delete(task_id)
+  if (error) {
+    task.reject(new Error(error))
+  } else {
+    task.resolve(result)
+  }
+})
+
+app.createWorkerPool = function (module_name, size) {
+  return new WorkerPool(module_name, size)
+}
+
+const workerChannels = new Map()
+
+// Gives the rest of the browser a turn when a channel is busy.
+const MAX_CHANNEL_MESSAGES_PER_TICK = 1024
+
+function WorkerChannel (worker_id, capacity) {
+  this.id = app._createWorkerChannel(worker_id, capacity || 0)
+  this.__onmessage = null
+  // Deliver what was queued while nobody listened.
+  this.on('newListener', (event) => {
+    event === 'message' && setImmediate(() => this._deliver())
+  })
+  workerChannels.set(this.id, this)
+}
+
+Object.setPrototypeOf(WorkerChannel.prototype, EventEmitter.prototype)
+
+Object.defineProperty(WorkerChannel.prototype, 'onmessage', {
+  get: function () { return this.__onmessage },
+  set: function (cb) {
+    this.__onmessage = cb
+    cb && setImmediate(() => this._deliver())
+  }
+})
+
+WorkerChannel.prototype.send = function (message) {
+  return app._sendWorkerChannelMessage(this.id, message)
+}
+
+WorkerChannel.prototype.receive = function () {
+  return app._receiveWorkerChannelMessage(this.id)
+}
+
+WorkerChannel.prototype.close = function () {
+  app._closeWorkerChannel(this.id)
+}
+
+WorkerChannel.prototype._deliver = function () {
+  // Without a listener the messages stay queued for receive().
+  for (let i = 0; i < MAX_CHANNEL_MESSAGES_PER_TICK; i++) {
+    if (!this.onmessage && this.listenerCount('message') === 0) return
+    const message = this.receive()
+    if (message === undefined) return
+    this.emit('message', message)
+    this.onmessage && this.onmessage(message)
+  }
+  setImmediate(() => this._deliver())
+}
+
+app.on('worker-channel-readable', (e, channel_id) => {
+  const channel = workerChannels.get(channel_id)
+  channel && channel._deliver()
+})
+
+app.on('worker-channel-drain', (e, channel_id) => {
+  const channel = workerChannels.get(channel_id)
+  channel && channel.emit('drain')
+})
+
+app.on('worker-channel-close', (e, channel_id) => {
+  const channel = workerChannels.get(channel_id)
+  if (!channel) return
+  workerChannels.delete(channel_id)
+  channel.emit('close')
+})
+
 app.allowNTLMCredentialsForAllDomains = function (allow) {
   if (!process.noDeprecations) {
     deprecate.warn('app.allowNTLMCredentialsForAllDomains', 'session.allowNTLMCredentialsForDomains')
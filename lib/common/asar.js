@@ -31,6 +31,21 @@
     }
   })
 
+  // Read a packed file from the archive's mapping, which avoids a read
+  // syscall per file, decompressing compressed files. Returns false when the
+  // file has to be read through the archive's fd instead, which is never
+  // possible for compressed files.
+  const readFromMappedArchive = function (archive, filePath, encoding) {
+    if (encoding === 'utf8' || encoding === 'utf-8') {
+      return archive.readFileUtf8(filePath)
+    }
+    const buffer = archive.readFile(filePath)
+    if (!buffer) {
+      return false
+    }
+    return encoding ? buffer.toString(encoding) : buffer
+  }
+
   // Separate asar package's path from full path.
   const splitPath = function (p) {
     // shortcut to disable asar.
@@ -156,10 +171,15 @@
   }
 
   // Override APIs that rely on passing file path instead of content to C++.
-  const overrideAPISync = function (module, name, arg) {
+  // Paths returned by `copyFileOutForReading` can only be opened by the
+  // current process, which is all `fs.open` needs.
+  const overrideAPISync = function (module, name, arg, copyFileOut) {
     if (arg == null) {
       arg = 0
     }
+    if (copyFileOut == null) {
+      copyFileOut = 'copyFileOut'
+    }
     const old = module[name]
     module[name] = function () {
       const p = arguments[arg]
@@ -173,7 +193,7 @@
         invalidArchiveError(asarPath)
       }
 
-      const newPath = archive.copyFileOut(filePath)
+      const newPath = archive[copyFileOut](filePath)
       if (!newPath) {
         notFoundError(asarPath, filePath)
       }
@@ -183,10 +203,13 @@
     }
   }
 
-  const overrideAPI = function (module, name, arg) {
+  const overrideAPI = function (module, name, arg, copyFileOut) {
     if (arg == null) {
       arg = 0
     }
+    if (copyFileOut == null) {
+      copyFileOut = 'copyFileOut'
+    }
     const old = module[name]
     module[name] = function () {
       const p = arguments[arg]
@@ -197,7 +220,7 @@
 
       const callback = arguments[arguments.length - 1]
       if (typeof callback !== 'function') {
-        return overrideAPISync(module, name, arg)
+        return overrideAPISync(module, name, arg, copyFileOut)
       }
 
       const archive = getOrCreateArchive(asarPath)
@@ -205,7 +228,7 @@
         return invalidArchiveError(asarPath, callback)
       }
 
-      const newPath = archive.copyFileOut(filePath)
+      const newPath = archive[copyFileOut](filePath)
       if (!newPath) {
         return notFoundError(asarPath, filePath, callback)
       }
@@ -483,12 +506,18 @@
         throw new TypeError('Bad arguments')
       }
       const {encoding} = options
+      logASARAccess(asarPath, filePath, info.offset)
+      const contents = readFromMappedArchive(archive, filePath, encoding)
+      if (contents) {
+        return process.nextTick(function () {
+          callback(null, contents)
+        })
+      }
       const buffer = new Buffer(info.size)
       const fd = archive.getFd()
-      if (!(fd >= 0)) {
+      if (info.compressed || !(fd >= 0)) {
         return notFoundError(asarPath, filePath, callback)
       }
-      logASARAccess(asarPath, filePath, info.offset)
       fs.read(fd, buffer, 0, info.size, info.offset, function (error) {
         callback(error, encoding ? buffer.toString(encoding) : buffer)
       })
@@ -531,12 +560,16 @@
         throw new TypeError('Bad arguments')
       }
       const {encoding} = options
+      logASARAccess(asarPath, filePath, info.offset)
+      const contents = readFromMappedArchive(archive, filePath, encoding)
+      if (contents) {
+        return contents
+      }
       const buffer = new Buffer(info.size)
       const fd = archive.getFd()
-      if (!(fd >= 0)) {
+      if (info.compressed || !(fd >= 0)) {
         notFoundError(asarPath, filePath)
       }
-      logASARAccess(asarPath, filePath, info.offset)
       fs.readSync(fd, buffer, 0, info.size, info.offset)
       if (encoding) {
         return buffer.toString(encoding)
@@ -604,12 +637,16 @@
           encoding: 'utf8'
         })
       }
+      logASARAccess(asarPath, filePath, info.offset)
+      const contents = readFromMappedArchive(archive, filePath, 'utf8')
+      if (contents) {
+        return contents
+      }
       const buffer = new Buffer(info.size)
       const fd = archive.getFd()
-      if (!(fd >= 0)) {
+      if (info.compressed || !(fd >= 0)) {
         return
       }
-      logASARAccess(asarPath, filePath, info.offset)
       fs.readSync(fd, buffer, 0, info.size, info.offset)
       return buffer.toString('utf8')
     }
@@ -684,11 +721,11 @@
       }
     })
 
-    overrideAPI(fs, 'open')
+    overrideAPI(fs, 'open', 0, 'copyFileOutForReading')
     overrideAPI(childProcess, 'execFile')
     overrideAPISync(process, 'dlopen', 1)
     overrideAPISync(require('module')._extensions, '.node', 1)
-    overrideAPISync(fs, 'openSync')
+    overrideAPISync(fs, 'openSync', 0, 'copyFileOutForReading')
     overrideAPISync(childProcess, 'execFileSync')
   }
 })()
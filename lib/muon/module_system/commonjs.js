@@ -1,4 +1,5 @@
 const path = requireNative('path')
+const codeCache = requireNative('code_cache')
 
 const commonjs = function (fn, exports, modulePath, __global__) {
   // convert module.exports to exports.$set
@@ -66,7 +67,8 @@ const commonjs = function (fn, exports, modulePath, __global__) {
     }
 
     try {
-      fn.apply(__global__, [requireProxy, moduleProxy, console])
+      fn.apply(__global__,
+        [moduleProxy.exports, requireProxy, moduleProxy, console])
     } catch (e) {
       if (__global__.onerror) {
         __global__.onerror(e)
@@ -77,3 +79,6 @@ const commonjs = function (fn, exports, modulePath, __global__) {
 }
 
 exports.$set('require', commonjs)
+exports.$set('load', (exports, modulePath, __global__) => {
+  commonjs(codeCache.compile(modulePath), exports, modulePath, __global__)
+})
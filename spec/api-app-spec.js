@@ -335,3 +335,317 @@ describe('app module', function () {
     })
   })
 })
+
+describe('app.createWorker', function () {
+  let worker = null
+
+  afterEach(function () {
+    if (worker) {
+      worker.terminate()
+      worker = null
+    }
+  })
+
+  it('loads modules using the exports shorthand', function (done) {
+    worker = app.createWorker('fixtures/workers/require_exports_shorthand')
+    worker.once('message', function (event) {
+      assert.deepEqual(event.data, {doubled: 42, isModuleExports: true})
+      done()
+    })
+    worker.start(function () {
+      worker.postMessage(21)
+    })
+  })
+})
+
+describe('worker postMessage transfer lists', function () {
+  const transferToWorker = remote.require(
+    path.join(__dirname, 'fixtures', 'module', 'transfer-to-worker.js'))
+
+  it('moves ArrayBuffers to the worker and back', function (done) {
+    transferToWorker.transfer(function (result) {
+      assert.equal(result.byteLengthAfterTransfer, 0)
+      assert.deepEqual(result.received, [1, 2, 3, 4])
+      assert.equal(result.workerByteLengthAfterTransfer, 0)
+      assert.equal(result.returnedByteLength, 4)
+      assert.deepEqual(result.returned, [1, 2, 3, 4])
+      done()
+    })
+  })
+
+  it('rejects invalid transfer lists without detaching', function (done) {
+    transferToWorker.transferErrors(function (result) {
+      assert.equal(result.duplicate,
+          'An ArrayBuffer is listed more than once in `transferList`')
+      assert.equal(result.notArrayBuffer,
+          '`transferList` may only contain ArrayBuffers')
+      assert.equal(result.notArray, '`transferList` must be an Array')
+      assert.equal(result.external,
+          'An ArrayBuffer in `transferList` can not be transferred')
+      assert.equal(result.byteLengthAfterErrors, 4)
+      done()
+    })
+  })
+})
+
+describe('app.createWorkerPool', function () {
+  let pool = null
+
+  afterEach(function () {
+    if (pool) {
+      pool.terminate()
+      pool = null
+    }
+  })
+
+  it('resolves tasks with the result of ontask', function () {
+    pool = app.createWorkerPool('fixtures/workers/task', 2)
+    const tasks = [1, 2, 3, 4].map((value) => pool.postTask({value: value}))
+    return Promise.all(tasks).then(function (results) {
+      assert.deepEqual(results.map((result) => result.value), [2, 4, 6, 8])
+    })
+  })
+
+  it('rejects tasks that throw', function () {
+    pool = app.createWorkerPool('fixtures/workers/task', 1)
+    return pool.postTask({error: 'task failed'}).then(function () {
+      assert.fail('the task should have been rejected')
+    }, function (error) {
+      assert(/task failed/.test(error.message))
+    })
+  })
+
+  it('lets idle workers steal the tasks of busy ones', function (done) {
+    // Both workers are waiting for tasks once they have started.
+    app.once('worker-start', function () {
+      app.once('worker-start', function () {
+        stealTasks().then(done, done)
+      })
+    })
+    pool = app.createWorkerPool('fixtures/workers/task', 2)
+  })
+
+  function stealTasks () {
+    const finished = []
+    const track = (name, promise) => promise.then(function (result) {
+      finished.push(name)
+      return result
+    })
+    // Round robin queues every other task behind the busy one.
+    const busy = track('busy', pool.postTask({value: 0, busy: 1000}))
+    const tasks = [1, 2, 3, 4].map((value) => {
+      return track(value, pool.postTask({value: value}))
+    })
+    return Promise.all([busy].concat(tasks)).then(function (results) {
+      assert.equal(finished[finished.length - 1], 'busy')
+      for (const result of results.slice(1)) {
+        assert.notEqual(result.workerId, results[0].workerId)
+      }
+    })
+  }
+
+  it('rejects pending tasks on terminate', function () {
+    pool = app.createWorkerPool('fixtures/workers/task', 1)
+    const task = pool.postTask({value: 1, busy: 200})
+    pool.terminate()
+    pool = null
+    return task.then(function () {
+      assert.fail('the task should have been rejected')
+    }, function (error) {
+      assert.equal(error.message, 'The worker pool has been terminated')
+    })
+  })
+})
+
+describe('worker channels', function () {
+  // Records of 1500 bytes don't divide the smallest ring of 4096 bytes, so
+  // they wrap around with padding.
+  const capacity = 4096
+  const message = (i) => String.fromCharCode(97 + i % 26).repeat(1500)
+  let worker = null
+
+  function startWorker (moduleName, callback) {
+    worker = app.createWorker(moduleName)
+    worker.start(callback)
+  }
+
+  afterEach(function () {
+    if (worker) {
+      worker.terminate()
+      worker = null
+    }
+  })
+
+  it('delivers messages in order across the end of the ring', function (done) {
+    startWorker('fixtures/workers/channel_echo', function () {
+      const channel = worker.createChannel(capacity)
+      let i = 0
+      channel.on('message', function (echo) {
+        assert.equal(echo, message(i))
+        if (++i === 10) {
+          done()
+        } else {
+          assert.equal(channel.send(message(i)), true)
+        }
+      })
+      assert.equal(channel.send(message(i)), true)
+    })
+  })
+
+  it('refuses messages while the ring is full', function (done) {
+    startWorker('fixtures/workers/channel_queue', function () {
+      const channel = worker.createChannel(capacity)
+      let sent = 0
+      while (sent < 10 && channel.send(message(sent))) sent++
+      assert.equal(sent, 2)
+      worker.once('message', function (event) {
+        assert.equal(event.data, 2)
+        assert.equal(channel.send(message(sent)), true)
+        done()
+      })
+      worker.postMessage('receive')
+    })
+  })
+
+  it('emits drain once the worker frees space', function (done) {
+    startWorker('fixtures/workers/channel_queue', function () {
+      const channel = worker.createChannel(capacity)
+      let sent = 0
+      while (channel.send(message(sent))) sent++
+      channel.once('drain', function () {
+        assert.equal(channel.send(message(sent)), true)
+        done()
+      })
+      worker.postMessage('receive')
+    })
+  })
+
+  it('calls ondrain once the browser frees space', function (done) {
+    startWorker('fixtures/workers/channel_drain', function () {
+      const channel = worker.createChannel(capacity)
+      worker.once('message', function (event) {
+        assert.equal(event.data, 2)
+        worker.once('message', function (event) {
+          assert.equal(event.data, 'drained')
+          done()
+        })
+        let received = 0
+        while (channel.receive() !== undefined) received++
+        // The worker may send again before the loop ends.
+        assert(received >= 2)
+      })
+    })
+  })
+
+  it('rejects messages larger than half of the ring', function (done) {
+    startWorker('fixtures/workers/channel_queue', function () {
+      const channel = worker.createChannel(capacity)
+      assert.throws(function () {
+        channel.send('a'.repeat(capacity))
+      }, /larger than half of the channel capacity/)
+      done()
+    })
+  })
+
+  it('emits close once the messages left are received', function (done) {
+    startWorker('fixtures/workers/channel_close', function () {
+      const channel = worker.createChannel(capacity)
+      const messages = []
+      channel.on('close', function () {
+        assert.deepEqual(messages, ['message 0', 'message 1', 'message 2'])
+        done()
+      })
+      channel.on('message', function (data) {
+        messages.push(data)
+      })
+    })
+  })
+})
+
+describe('worker module code cache', function () {
+  const moduleName = 'fixtures/workers/code_cache'
+  const cacheDir = path.join(app.getPath('userData'), 'Module Code Cache')
+
+  function startWorker (callback) {
+    const worker = app.createWorker(moduleName)
+    worker.start(function (event) {
+      worker.terminate()
+      callback(event.metrics)
+    })
+  }
+
+  // The code caches are written in the background, one file per module
+  // holding its key.
+  function waitForCacheFile (callback) {
+    const files = fs.existsSync(cacheDir) ? fs.readdirSync(cacheDir) : []
+    const found = files.some(function (file) {
+      try {
+        const contents = fs.readFileSync(path.join(cacheDir, file))
+        return contents.indexOf(moduleName) !== -1
+      } catch (error) {
+        // A temporary file that was renamed meanwhile.
+        return false
+      }
+    })
+    if (found) {
+      callback()
+    } else {
+      setTimeout(waitForCacheFile, 50, callback)
+    }
+  }
+
+  it('keeps the code cache of worker modules on disk', function (done) {
+    startWorker(function () {
+      waitForCacheFile(function () {
+        startWorker(function (metrics) {
+          assert(metrics.codeCacheHits > 0)
+          done()
+        })
+      })
+    })
+  })
+})
+
+describe('worker limits', function () {
+  let worker = null
+
+  afterEach(function () {
+    if (worker) {
+      worker.terminate()
+      worker = null
+    }
+  })
+
+  it('stops workers that exceed maxHeapSize', function (done) {
+    worker = app.createWorker('fixtures/workers/allocate', {maxHeapSize: 16})
+    let error = null
+    worker.onerror = function (message) {
+      error = message
+    }
+    worker.once('stop', function () {
+      assert.equal(error, 'The worker exceeded its heap limit of 16 MB')
+      worker = null
+      done()
+    })
+    worker.start(function () {
+      assert.equal(worker.getStats().maxHeapSize, 16 * 1024 * 1024)
+      worker.postMessage(null)
+    })
+  })
+
+  it('refuses messages while the queue is full', function (done) {
+    worker = app.createWorker('fixtures/workers/busy', {maxQueueLength: 2})
+    worker.start(function () {
+      assert.equal(worker.getStats().maxQueueLength, 2)
+      assert.equal(worker.postMessage(500), true)
+      // The worker takes at most the first message before the queue fills.
+      let posted = 0
+      while (posted < 10 && worker.postMessage(0)) posted++
+      assert(posted === 1 || posted === 2)
+      worker.once('drain', function () {
+        assert.equal(worker.postMessage(0), true)
+        done()
+      })
+    })
+  })
+})
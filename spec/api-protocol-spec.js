@@ -236,6 +236,56 @@ describe('protocol module', function () {
       })
     })
 
+    it('sends typed array in object as response', function (done) {
+      var handler = function (request, callback) {
+        callback({
+          mimeType: 'text/plain',
+          data: new Uint8Array(buffer)
+        })
+      }
+      protocol.registerBufferProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function (data, status, request) {
+            assert.equal(data, text)
+            assert.equal(request.getResponseHeader('Content-Type'), 'text/plain')
+            done()
+          },
+          error: function (xhr, errorType, error) {
+            done(error)
+          }
+        })
+      })
+    })
+
+    it('is not affected by changes to the Buffer after the callback', function (done) {
+      var handler = function (request, callback) {
+        var data = Buffer.from(text)
+        callback(data)
+        data.fill(0)
+      }
+      protocol.registerBufferProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function (data) {
+            assert.equal(data, text)
+            done()
+          },
+          error: function (xhr, errorType, error) {
+            done(error)
+          }
+        })
+      })
+    })
+
     it('sets Access-Control-Allow-Origin', function (done) {
       var handler = function (request, callback) {
         callback(buffer)
@@ -308,6 +358,227 @@ describe('protocol module', function () {
     })
   })
 
+  describe('protocol response cache', function () {
+    var get = function (url) {
+      return new Promise(function (resolve, reject) {
+        $.ajax({
+          url: url,
+          success: resolve,
+          error: function (xhr, errorType, error) {
+            reject(error)
+          }
+        })
+      })
+    }
+
+    afterEach(function (done) {
+      protocol.invalidateResponseCache(done)
+    })
+
+    it('serves cached responses without calling the handler', function (done) {
+      var calls = 0
+      var handler = function (request, callback) {
+        calls++
+        callback({data: text, cache: {maxAge: 60}})
+      }
+      protocol.registerStringProtocol(protocolName, handler, function (error) {
+        if (error) return done(error)
+        var url = protocolName + '://fake-host/cached'
+        get(url).then(function (data) {
+          assert.equal(data, text)
+          return get(url)
+        }).then(function (data) {
+          assert.equal(data, text)
+          assert.equal(calls, 1)
+          done()
+        }).catch(done)
+      })
+    })
+
+    it('revalidates stale responses with their etag', function (done) {
+      var requests = []
+      var handler = function (request, callback) {
+        requests.push(request)
+        if (request.ifNoneMatch === 'v1') {
+          callback({notModified: true})
+        } else {
+          callback({data: new Buffer(text), cache: {maxAge: 0.01, etag: 'v1'}})
+        }
+      }
+      protocol.registerBufferProtocol(protocolName, handler, function (error) {
+        if (error) return done(error)
+        var url = protocolName + '://fake-host/etag'
+        get(url).then(function () {
+          return new Promise(function (resolve) {
+            setTimeout(resolve, 50)
+          })
+        }).then(function () {
+          return get(url)
+        }).then(function (data) {
+          assert.equal(data, text)
+          assert.equal(requests.length, 2)
+          assert.equal(requests[0].ifNoneMatch, undefined)
+          assert.equal(requests[1].ifNoneMatch, 'v1')
+          done()
+        }).catch(done)
+      })
+    })
+
+    it('drops invalidated responses', function (done) {
+      var calls = 0
+      var handler = function (request, callback) {
+        calls++
+        callback({data: text, cache: {maxAge: 60}})
+      }
+      protocol.registerStringProtocol(protocolName, handler, function (error) {
+        if (error) return done(error)
+        var url = protocolName + '://fake-host/invalidated'
+        get(url).then(function () {
+          return new Promise(function (resolve) {
+            protocol.invalidateResponseCache(protocolName + '://fake-host/', resolve)
+          })
+        }).then(function () {
+          return get(url)
+        }).then(function () {
+          assert.equal(calls, 2)
+          done()
+        }).catch(done)
+      })
+    })
+  })
+
+  describe('protocol.registerStreamProtocol', function () {
+    var PassThrough = remote.require('stream').PassThrough
+
+    var getStream = function (data) {
+      var body = new PassThrough()
+      body.end(data)
+      return body
+    }
+
+    it('sends the stream as response', function (done) {
+      var handler = function (request, callback) {
+        callback({data: getStream(text)})
+      }
+      protocol.registerStreamProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function (data) {
+            assert.equal(data, text)
+            done()
+          },
+          error: function (xhr, errorType, error) {
+            done(error)
+          }
+        })
+      })
+    })
+
+    it('sends status code and headers', function (done) {
+      var handler = function (request, callback) {
+        callback({
+          statusCode: 201,
+          mimeType: 'text/plain',
+          headers: {'X-Great-Header': 'sure'},
+          data: getStream(text)
+        })
+      }
+      protocol.registerStreamProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function (data, status, request) {
+            assert.equal(data, text)
+            assert.equal(request.status, 201)
+            assert.equal(request.getResponseHeader('X-Great-Header'), 'sure')
+            assert.equal(request.getResponseHeader('Content-Type'), 'text/plain')
+            done()
+          },
+          error: function (xhr, errorType, error) {
+            done(error)
+          }
+        })
+      })
+    })
+
+    it('serves a byte range when the length is known', function (done) {
+      var handler = function (request, callback) {
+        callback({length: text.length, data: getStream(text)})
+      }
+      protocol.registerStreamProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          headers: {Range: 'bytes=6-11'},
+          success: function (data, status, request) {
+            assert.equal(data, 'morghu')
+            assert.equal(request.status, 206)
+            assert.equal(request.getResponseHeader('Content-Range'),
+                         'bytes 6-11/' + text.length)
+            done()
+          },
+          error: function (xhr, errorType, error) {
+            done(error)
+          }
+        })
+      })
+    })
+
+    it('fails when the stream ends before the length', function (done) {
+      var handler = function (request, callback) {
+        callback({length: text.length + 10, data: getStream(text)})
+      }
+      protocol.registerStreamProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function () {
+            done('request succeeded but it should not')
+          },
+          error: function (xhr, errorType) {
+            assert.equal(errorType, 'error')
+            done()
+          }
+        })
+      })
+    })
+
+    it('fails when data is not a stream', function (done) {
+      var handler = function (request, callback) {
+        callback({data: text})
+      }
+      protocol.registerStreamProtocol(protocolName, handler, function (error) {
+        if (error) {
+          return done(error)
+        }
+        $.ajax({
+          url: protocolName + '://fake-host',
+          cache: false,
+          success: function () {
+            done('request succeeded but it should not')
+          },
+          error: function (xhr, errorType) {
+            assert.equal(errorType, 'error')
+            done()
+          }
+        })
+      })
+    })
+  })
+
   describe('protocol.registerFileProtocol', function () {
     var filePath = path.join(__dirname, 'fixtures', 'asar', 'a.asar', 'file1')
     var fileContent = require('fs').readFileSync(filePath)
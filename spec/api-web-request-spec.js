@@ -6,11 +6,23 @@ const session = remote.session
 
 describe('webRequest module', function () {
   var ses = session.defaultSession
+  var requestCount = 0
   var server = http.createServer(function (req, res) {
+    requestCount++
     if (req.url === '/serverRedirect') {
       res.statusCode = 301
       res.setHeader('Location', 'http://' + req.rawHeaders[1])
       res.end()
+    } else if (req.url === '/slow') {
+      setTimeout(function () {
+        res.end('/slow')
+      }, 200)
+    } else if (req.url === '/large') {
+      res.end(Buffer.alloc(4 * 1024 * 1024))
+    } else if (req.url === '/binary') {
+      var bytes = Buffer.alloc(256)
+      for (var i = 0; i < bytes.length; i++) bytes[i] = i
+      res.end(bytes)
     } else {
       res.setHeader('Custom', ['Header'])
       var content = req.url
@@ -34,6 +46,215 @@ describe('webRequest module', function () {
     server.close()
   })
 
+  describe('webRequest.setRules', function () {
+    afterEach(function () {
+      ses.webRequest.setRules(null)
+    })
+
+    it('can cancel requests', function (done) {
+      ses.webRequest.setRules([{urls: [defaultURL + 'blocked/*'], cancel: true}])
+      $.ajax({
+        url: defaultURL + 'allowed',
+        success: function (data) {
+          assert.equal(data, '/allowed')
+          $.ajax({
+            url: defaultURL + 'blocked/test',
+            success: function () {
+              done('unexpected success')
+            },
+            error: function () {
+              done()
+            }
+          })
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('can redirect requests', function (done) {
+      ses.webRequest.setRules([{urls: [defaultURL + 'old'], redirectURL: defaultURL + 'new'}])
+      $.ajax({
+        url: defaultURL + 'old',
+        success: function (data) {
+          assert.equal(data, '/new')
+          done()
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('can set request headers', function (done) {
+      ses.webRequest.setRules([{requestHeaders: {Accept: '*/*;test/header'}}])
+      $.ajax({
+        url: defaultURL,
+        success: function (data) {
+          assert.equal(data, '/header/received')
+          done()
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('can change response headers', function (done) {
+      ses.webRequest.setRules([{
+        urls: [defaultURL + '*'],
+        responseHeaders: {'X-Rule': 'applied'},
+        removeResponseHeaders: ['Custom']
+      }])
+      $.ajax({
+        url: defaultURL,
+        success: function (data, status, xhr) {
+          assert.equal(xhr.getResponseHeader('X-Rule'), 'applied')
+          assert.equal(xhr.getResponseHeader('Custom'), null)
+          done()
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('throws for invalid rules', function () {
+      assert.throws(function () {
+        ses.webRequest.setRules([{urls: ['not a pattern'], cancel: true}])
+      }, /Invalid rule 0/)
+      assert.throws(function () {
+        ses.webRequest.setRules([{cancel: true}, {urls: ['<all_urls>']}])
+      }, /Invalid rule 1: rule has no action/)
+    })
+  })
+
+  describe('webRequest.getStats', function () {
+    afterEach(function () {
+      ses.webRequest.onBeforeRequest(null)
+    })
+
+    it('reports the timing of blocking listeners', function (done) {
+      ses.webRequest.onBeforeRequest(function (details, callback) {
+        setTimeout(function () {
+          callback({})
+        }, 20)
+      })
+      $.ajax({
+        url: defaultURL,
+        success: function () {
+          ses.webRequest.getStats(function (stats) {
+            assert.equal(stats.blockedRequests, 0)
+            assert(stats.maxBlockedRequests >= 1)
+            var events = stats.events.onBeforeRequest
+            ;['queueTime', 'listenerTime', 'returnTime'].forEach(function (phase) {
+              assert(events[phase].count >= 1)
+              assert.equal(events[phase].buckets.length, 12)
+            })
+            assert(events.listenerTime.maxMs >= 15)
+            done()
+          })
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+  })
+
+  describe('webRequest.fetch', function () {
+    it('returns the body as a string by default', function (done) {
+      ses.webRequest.fetch(defaultURL + 'text', function (error, response, body) {
+        assert.equal(error, null)
+        assert.equal(response.statusCode, 200)
+        assert.equal(body, '/text')
+        done()
+      })
+    })
+
+    it('returns binary bodies as a Buffer', function (done) {
+      ses.webRequest.fetch(defaultURL + 'binary', {responseType: 'buffer'}, function (error, response, body) {
+        assert.equal(error, null)
+        assert(Buffer.isBuffer(body))
+        assert.equal(body.length, 256)
+        for (var i = 0; i < body.length; i++) assert.equal(body[i], i)
+        done()
+      })
+    })
+
+    it('streams the body to onData', function (done) {
+      var chunks = []
+      ses.webRequest.fetch(defaultURL + 'binary', {
+        onData: function (chunk) {
+          chunks.push(Buffer.from(chunk))
+        }
+      }, function (error, response, body) {
+        assert.equal(error, null)
+        assert.equal(body, null)
+        var result = Buffer.concat(chunks)
+        assert.equal(result.length, 256)
+        assert.equal(result[255], 255)
+        done()
+      })
+    })
+
+    it('shares the response of identical GETs', function (done) {
+      var count = requestCount
+      var bodies = []
+      var onResponse = function (error, response, body) {
+        assert.equal(error, null)
+        bodies.push(body)
+        if (bodies.length === 2) {
+          assert.equal(requestCount - count, 1)
+          assert.equal(bodies[0], '/slow')
+          assert(Buffer.isBuffer(bodies[1]))
+          assert.equal(bodies[1].toString(), '/slow')
+          done()
+        }
+      }
+      ses.webRequest.fetch(defaultURL + 'slow', onResponse)
+      ses.webRequest.fetch(defaultURL + 'slow', {responseType: 'buffer'}, onResponse)
+    })
+
+    it('can be cancelled', function (done) {
+      var id = ses.webRequest.fetch(defaultURL + 'slow', function (error, response, body) {
+        assert.equal(error.errorCode, -3)
+        assert.equal(body, '')
+        assert.equal(ses.webRequest.cancelFetch(id), false)
+        done()
+      })
+      assert.equal(ses.webRequest.cancelFetch(id), true)
+    })
+
+    it('stops calling onData once cancelled', function (done) {
+      var cancelled = false
+      var id = ses.webRequest.fetch(defaultURL + 'large', {
+        onData: function (chunk) {
+          assert.equal(cancelled, false)
+          cancelled = true
+          assert.equal(ses.webRequest.cancelFetch(id), true)
+        }
+      }, function (error, response, body) {
+        assert.equal(error.errorCode, -3)
+        // Let the chunks that were queued reach onData if they would.
+        setTimeout(done, 200)
+      })
+    })
+
+    it('throws for an invalid priority', function () {
+      assert.throws(function () {
+        ses.webRequest.fetch(defaultURL, {priority: 'urgent'}, function () {})
+      }, /priority must be/)
+    })
+
+    it('throws for an invalid responseType', function () {
+      assert.throws(function () {
+        ses.webRequest.fetch(defaultURL, {responseType: 'json'}, function () {})
+      }, /responseType must be 'text' or 'buffer'/)
+    })
+  })
+
   describe('webRequest.onBeforeRequest', function () {
     afterEach(function () {
       ses.webRequest.onBeforeRequest(null)
@@ -85,6 +306,46 @@ describe('webRequest module', function () {
       })
     })
 
+    it('can filter URLs with a large filter list', function () {
+      this.timeout(60000)
+      // Resembles a blocklist: mostly subdomain wildcards of distinct hosts,
+      // some exact hosts with paths and a few patterns for any host.
+      var urls = []
+      for (var i = 0; i < 5000; i++) {
+        urls.push('*://*.ads' + i + '.example.com/*')
+        urls.push('https://tracker' + i + '.example.net/pixel/*')
+      }
+      urls.push('*://*/*/banner.gif')
+      urls.push(defaultURL + 'filter/*')
+      ses.webRequest.onBeforeRequest({urls: urls}, function (details, callback) {
+        callback({cancel: true})
+      })
+      var request = function (url) {
+        return new Promise(function (resolve) {
+          $.ajax({
+            url: url,
+            success: function () { resolve(true) },
+            error: function () { resolve(false) }
+          })
+        })
+      }
+      var requests = []
+      for (var j = 0; j < 20; j++) {
+        requests.push(request(defaultURL + 'nofilter/' + j))
+      }
+      return Promise.all(requests).then(function (results) {
+        results.forEach(function (passed) {
+          assert(passed)
+        })
+        return Promise.all([
+          request(defaultURL + 'filter/test'),
+          request(defaultURL + 'images/banner.gif')
+        ])
+      }).then(function (results) {
+        assert.deepEqual(results, [false, false])
+      })
+    })
+
     it('receives details object', function (done) {
       ses.webRequest.onBeforeRequest(function (details, callback) {
         assert.equal(typeof details.id, 'number')
@@ -107,6 +368,79 @@ describe('webRequest module', function () {
       })
     })
 
+    it('only fills the requested fields of details object', function (done) {
+      var filter = {fields: ['url', 'resourceType']}
+      ses.webRequest.onBeforeRequest(filter, function (details, callback) {
+        assert.deepEqual(Object.keys(details).sort(), ['resourceType', 'url'])
+        assert.equal(details.url, defaultURL)
+        assert.equal(details.resourceType, 'xhr')
+        callback({})
+      })
+      $.ajax({
+        url: defaultURL,
+        success: function (data) {
+          assert.equal(data, '/')
+          done()
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('throws for unknown fields of details object', function () {
+      assert.throws(function () {
+        ses.webRequest.onBeforeRequest({fields: ['nope']}, function () {})
+      }, /Unknown details field nope/)
+    })
+
+    it('continues the request when the listener times out', function (done) {
+      var answer = null
+      ses.webRequest.onBeforeRequest({timeout: 50}, function (details, callback) {
+        answer = callback
+      })
+      $.ajax({
+        url: defaultURL,
+        success: function (data) {
+          assert.equal(data, '/')
+          answer({cancel: true})
+          setTimeout(function () {
+            ses.webRequest.getStats(function (stats) {
+              assert(stats.events.onBeforeRequest.timeouts >= 1)
+              assert(stats.events.onBeforeRequest.lateAnswers >= 1)
+              done()
+            })
+          }, 50)
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('can cancel the request when the listener times out', function (done) {
+      var filter = {timeout: 50, timeoutAction: 'cancel'}
+      ses.webRequest.onBeforeRequest(filter, function () {})
+      $.ajax({
+        url: defaultURL,
+        success: function () {
+          done('unexpected success')
+        },
+        error: function () {
+          done()
+        }
+      })
+    })
+
+    it('throws for invalid timeout options', function () {
+      assert.throws(function () {
+        ses.webRequest.onBeforeRequest({timeout: 10, timeoutAction: 'wait'}, function () {})
+      }, /Invalid timeout options/)
+      assert.throws(function () {
+        ses.webRequest.onCompleted({timeout: 10}, function () {})
+      }, /Only blocking events can time out/)
+    })
+
     it('receives post data in details object', function (done) {
       var postData = {
         name: 'post test',
@@ -431,6 +765,47 @@ describe('webRequest module', function () {
         }
       })
     })
+
+    it('delivers details in batches', function (done) {
+      var urls = []
+      var filter = {fields: ['url'], batch: {interval: 50}}
+      ses.webRequest.onCompleted(filter, function (list, dropped) {
+        assert(Array.isArray(list))
+        assert.equal(dropped, 0)
+        list.forEach(function (details) {
+          assert.deepEqual(Object.keys(details), ['url'])
+          urls.push(details.url)
+        })
+        if (urls.length === 3) {
+          assert.deepEqual(urls.sort(), [
+            defaultURL + 'a', defaultURL + 'b', defaultURL + 'c'
+          ])
+          done()
+        }
+      })
+      ;['a', 'b', 'c'].forEach(function (path) {
+        $.ajax({url: defaultURL + path})
+      })
+    })
+
+    it('counts the events dropped from full batches', function (done) {
+      var count = 0
+      var filter = {batch: {interval: 0, maxSize: 1}}
+      ses.webRequest.onCompleted(filter, function (list, dropped) {
+        assert(list.length <= 1)
+        count += list.length + dropped
+        if (count === 3) done()
+      })
+      ;['a', 'b', 'c'].forEach(function (path) {
+        $.ajax({url: defaultURL + path})
+      })
+    })
+
+    it('throws when batching blocking events', function () {
+      assert.throws(function () {
+        ses.webRequest.onBeforeRequest({batch: {}}, function () {})
+      }, /Only non-blocking events can be batched/)
+    })
   })
 
   describe('webRequest.onErrorOccurred', function () {
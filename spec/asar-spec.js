@@ -49,6 +49,20 @@ describe('asar package', function () {
         assert.equal(fs.readFileSync(p).toString().trim(), 'file1')
       })
 
+      it('reads a normal file with an encoding', function () {
+        var file1 = path.join(fixtures, 'asar', 'a.asar', 'file1')
+        assert.equal(fs.readFileSync(file1, 'utf8').trim(), 'file1')
+        assert.equal(fs.readFileSync(file1, {encoding: 'hex'}), new Buffer('file1\n').toString('hex'))
+      })
+
+      it('returns a buffer that can be modified', function () {
+        var file1 = path.join(fixtures, 'asar', 'a.asar', 'file1')
+        var buffer = fs.readFileSync(file1)
+        buffer[0] = 'F'.charCodeAt(0)
+        assert.equal(buffer.toString().trim(), 'File1')
+        assert.equal(fs.readFileSync(file1).toString().trim(), 'file1')
+      })
+
       it('reads a file from linked directory', function () {
         var p = path.join(fixtures, 'asar', 'a.asar', 'link2', 'file1')
         assert.equal(fs.readFileSync(p).toString().trim(), 'file1')
@@ -78,6 +92,27 @@ describe('asar package', function () {
         var p = path.join(fixtures, 'asar', 'unpack.asar', 'a.txt')
         assert.equal(fs.readFileSync(p).toString().trim(), 'a')
       })
+
+      it('reads a compressed file', function () {
+        var expected = ''
+        for (var i = 0; i < 1000; i++) {
+          expected += 'line ' + i + '\n'
+        }
+        var p = path.join(fixtures, 'asar', 'compressed.asar', 'big.txt')
+        assert.equal(fs.readFileSync(p).toString(), expected)
+        assert.equal(fs.readFileSync(p, 'utf8'), expected)
+        p = path.join(fixtures, 'asar', 'compressed.asar', 'hello.txt')
+        assert.equal(fs.readFileSync(p, 'utf8'), 'hello compressed\n')
+        p = path.join(fixtures, 'asar', 'compressed.asar', 'plain.txt')
+        assert.equal(fs.readFileSync(p, 'utf8'), 'plain\n')
+      })
+
+      it('throws ENOENT error for a file of an unknown compression', function () {
+        var p = path.join(fixtures, 'asar', 'compressed.asar', 'unknown.txt')
+        assert.throws(function () {
+          fs.readFileSync(p)
+        }, /ENOENT/)
+      })
     })
 
     describe('fs.readFile', function () {
@@ -489,6 +524,15 @@ describe('asar package', function () {
         }
       })
 
+      it('opens a compressed file', function () {
+        var p = path.join(fixtures, 'asar', 'compressed.asar', 'big.txt')
+        var fd = fs.openSync(p, 'r')
+        var buffer = new Buffer(9)
+        fs.readSync(fd, buffer, 0, 9, 1015)
+        assert.equal(String(buffer), 'line 125\n')
+        fs.closeSync(fd)
+      })
+
       it('throws ENOENT error when can not find file', function () {
         var p = path.join(fixtures, 'asar', 'a.asar', 'not-exist')
         var throws = function () {
@@ -790,6 +834,74 @@ describe('asar package', function () {
       })
     })
 
+    var requestBuffer = function (p, headers) {
+      return new Promise(function (resolve, reject) {
+        var xhr = new XMLHttpRequest()
+        xhr.open('GET', 'file://' + p)
+        xhr.responseType = 'arraybuffer'
+        Object.keys(headers || {}).forEach(function (name) {
+          xhr.setRequestHeader(name, headers[name])
+        })
+        xhr.onload = function () {
+          resolve(Buffer.from(xhr.response))
+        }
+        xhr.onerror = reject
+        xhr.send()
+      })
+    }
+
+    it('can request a range of a file in package', function () {
+      var p = path.resolve(fixtures, 'asar', 'video.asar', 'video.mp4')
+      var expected = fs.readFileSync(p).slice(1000, 300001)
+      return requestBuffer(p, {Range: 'bytes=1000-300000'}).then(function (data) {
+        assert(expected.equals(data))
+      })
+    })
+
+    it('can request a range of a compressed file in package', function () {
+      var p = path.resolve(fixtures, 'asar', 'compressed.asar', 'big.txt')
+      // The range spans the boundary of the first two compressed blocks.
+      var expected = fs.readFileSync(p).slice(1000, 2500)
+      return requestBuffer(p, {Range: 'bytes=1000-2499'}).then(function (data) {
+        assert(expected.equals(data))
+      })
+    })
+
+    it('returns 304 for a conditional request of an unchanged file', function (done) {
+      var p = path.resolve(fixtures, 'asar', 'a.asar', 'file1')
+      $.ajax({
+        url: 'file://' + p,
+        success: function (data, status, xhr) {
+          var etag = xhr.getResponseHeader('ETag')
+          assert(etag)
+          assert(xhr.getResponseHeader('Last-Modified'))
+          $.ajax({
+            url: 'file://' + p,
+            headers: {'If-None-Match': etag},
+            complete: function (xhr) {
+              assert.equal(xhr.status, 304)
+              done()
+            }
+          })
+        }
+      })
+    })
+
+    it('serves parallel requests for a large file in package', function () {
+      this.timeout(60000)
+      var p = path.resolve(fixtures, 'asar', 'video.asar', 'video.mp4')
+      var expected = fs.readFileSync(p)
+      var requests = []
+      for (var i = 0; i < 20; i++) {
+        requests.push(requestBuffer(p))
+      }
+      return Promise.all(requests).then(function (results) {
+        results.forEach(function (data) {
+          assert(expected.equals(data))
+        })
+      })
+    })
+
     it('gets 404 when file is not found', function (done) {
       var p = path.resolve(fixtures, 'asar', 'a.asar', 'no-exist')
       $.ajax({
@@ -0,0 +1,91 @@
+// Measures the throughput of requests for files in asar archives and the
+// overhead of matching webRequest URL filters.
+const http = require('http')
+const path = require('path')
+const {ipcRenderer, remote} = require('electron')
+
+const fixtures = path.join(__dirname, '..', 'fixtures')
+
+function request (url, responseType) {
+  return new Promise(function (resolve, reject) {
+    const xhr = new XMLHttpRequest()
+    xhr.open('GET', url)
+    xhr.responseType = responseType || 'text'
+    xhr.onload = function () {
+      resolve(xhr)
+    }
+    xhr.onerror = function () {
+      reject(new Error('Request for ' + url + ' failed'))
+    }
+    xhr.send()
+  })
+}
+
+function benchmarkAsar () {
+  const p = path.join(fixtures, 'asar', 'video.asar', 'video.mp4')
+  const count = 200
+  const start = Date.now()
+  const requests = []
+  for (let i = 0; i < count; i++) {
+    requests.push(request('file://' + p, 'arraybuffer'))
+  }
+  return Promise.all(requests).then(function (xhrs) {
+    const bytes = xhrs.reduce(function (total, xhr) {
+      return total + xhr.response.byteLength
+    }, 0)
+    const seconds = (Date.now() - start) / 1000
+    return 'asar protocol: ' + count + ' requests, ' +
+        (bytes / 1024 / 1024 / seconds).toFixed(1) + ' MB/s'
+  })
+}
+
+function benchmarkWebRequest () {
+  const server = http.createServer(function (req, res) {
+    res.end(req.url)
+  })
+  const webRequest = remote.session.defaultSession.webRequest
+  return new Promise(function (resolve) {
+    server.listen(0, '127.0.0.1', resolve)
+  }).then(function () {
+    // Resembles a blocklist: mostly subdomain wildcards of distinct hosts,
+    // some exact hosts with paths and a few patterns for any host.
+    const urls = []
+    for (let i = 0; i < 5000; i++) {
+      urls.push('*://*.ads' + i + '.example.com/*')
+      urls.push('https://tracker' + i + '.example.net/pixel/*')
+    }
+    urls.push('*://*/*/banner.gif')
+    webRequest.onBeforeRequest({urls: urls}, function (details, callback) {
+      callback({cancel: true})
+    })
+
+    const url = 'http://127.0.0.1:' + server.address().port + '/'
+    const count = 2000
+    const start = Date.now()
+    const requests = []
+    for (let i = 0; i < count; i++) {
+      requests.push(request(url + 'nofilter/' + i))
+    }
+    return Promise.all(requests).then(function () {
+      const seconds = (Date.now() - start) / 1000
+      return 'webRequest filter: ' + urls.length + ' patterns, ' +
+          (count / seconds).toFixed(0) + ' requests/s'
+    })
+  }).then(function (result) {
+    webRequest.onBeforeRequest(null)
+    server.close()
+    return result
+  })
+}
+
+const benchmarks = [benchmarkAsar, benchmarkWebRequest]
+
+benchmarks.reduce(function (previous, benchmark) {
+  return previous.then(benchmark).then(function (result) {
+    ipcRenderer.send('benchmark-result', result)
+  })
+}, Promise.resolve()).then(function () {
+  ipcRenderer.send('benchmark-done')
+}, function (error) {
+  ipcRenderer.send('benchmark-error', error.stack)
+})
@@ -0,0 +1,34 @@
+// Runs the benchmarks of index.html in a hidden window and prints their
+// results.
+const {app, BrowserWindow, ipcMain} = require('electron')
+const path = require('path')
+const url = require('url')
+
+let window = null
+
+ipcMain.on('benchmark-result', function (event, result) {
+  console.log(result)
+})
+
+ipcMain.on('benchmark-done', function () {
+  app.quit()
+})
+
+ipcMain.on('benchmark-error', function (event, stack) {
+  console.error(stack)
+  app.exit(1)
+})
+
+app.on('ready', function () {
+  window = new BrowserWindow({
+    show: false,
+    webPreferences: {
+      backgroundThrottling: false
+    }
+  })
+  window.loadURL(url.format({
+    pathname: path.join(__dirname, 'index.html'),
+    protocol: 'file',
+    slashes: true
+  }))
+})
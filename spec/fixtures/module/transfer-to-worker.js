@@ -0,0 +1,56 @@
+// Runs in the browser, where ArrayBuffers can be transferred to workers.
+const {app} = require('electron')
+
+function startWorker (callback) {
+  const worker = app.createWorker('fixtures/workers/transfer')
+  worker.start(() => callback(worker))
+}
+
+function getError (fn) {
+  try {
+    fn()
+  } catch (error) {
+    return error.message
+  }
+  return null
+}
+
+exports.transfer = function (callback) {
+  startWorker((worker) => {
+    const buffer = new ArrayBuffer(4)
+    new Uint8Array(buffer).set([1, 2, 3, 4])
+    const replies = []
+    worker.on('message', (event) => {
+      replies.push(event.data)
+      if (replies.length < 2) return
+      worker.terminate()
+      callback({
+        byteLengthAfterTransfer: buffer.byteLength,
+        received: replies[0].bytes,
+        returnedByteLength: replies[0].buffer.byteLength,
+        returned: Array.from(new Uint8Array(replies[0].buffer)),
+        workerByteLengthAfterTransfer: replies[1].byteLengthAfterTransfer
+      })
+    })
+    worker.postMessage(buffer, [buffer])
+  })
+}
+
+exports.transferErrors = function (callback) {
+  startWorker((worker) => {
+    const buffer = new ArrayBuffer(4)
+    const transferred = new ArrayBuffer(4)
+    worker.postMessage(transferred, [transferred])
+    const errors = {
+      duplicate: getError(() => worker.postMessage(buffer, [buffer, buffer])),
+      notArrayBuffer: getError(() => {
+        worker.postMessage(buffer, [new Uint8Array(buffer)])
+      }),
+      notArray: getError(() => worker.postMessage(buffer, buffer)),
+      external: getError(() => worker.postMessage(transferred, [transferred])),
+      byteLengthAfterErrors: buffer.byteLength
+    }
+    worker.terminate()
+    callback(errors)
+  })
+}
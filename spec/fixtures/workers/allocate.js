@@ -0,0 +1,5 @@
+// Allocates until the worker is stopped.
+self.onmessage = function () {
+  const list = []
+  while (true) list.push(new Array(1024).fill(list.length))
+}
@@ -0,0 +1,5 @@
+// Keeps the worker busy for the number of milliseconds posted.
+self.onmessage = function (msg) {
+  const end = Date.now() + msg.data
+  while (Date.now() < end) {}
+}
@@ -0,0 +1,4 @@
+self.onchannel = function (channel) {
+  for (let i = 0; i < 3; i++) channel.send('message ' + i)
+  channel.close()
+}
@@ -0,0 +1,13 @@
+// Fills the channel, then sends once more when it drains.
+const message = 'a'.repeat(1500)
+let channel = null
+
+self.onchannel = function (newChannel) {
+  channel = newChannel
+  channel.ondrain = function () {
+    postMessage(channel.send(message) ? 'drained' : 'still full')
+  }
+  let sent = 0
+  while (channel.send(message)) sent++
+  postMessage(sent)
+}
@@ -0,0 +1,5 @@
+self.onchannel = function (channel) {
+  channel.onmessage = function (message) {
+    channel.send(message)
+  }
+}
@@ -0,0 +1,12 @@
+// Leaves the messages of the channel queued until asked to receive them.
+let channel = null
+
+self.onchannel = function (newChannel) {
+  channel = newChannel
+}
+
+self.onmessage = function () {
+  let count = 0
+  while (channel.receive() !== undefined) count++
+  postMessage(count)
+}
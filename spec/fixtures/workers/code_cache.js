@@ -0,0 +1,3 @@
+self.onmessage = function (msg) {
+  postMessage(msg.data)
+}
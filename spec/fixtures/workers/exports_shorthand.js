@@ -0,0 +1,7 @@
+exports.double = function (value) {
+  return value * 2
+}
+
+exports.isModuleExports = function () {
+  return exports === module.exports
+}
@@ -0,0 +1,8 @@
+const shorthand = require('./exports_shorthand')
+
+self.onmessage = function (msg) {
+  postMessage({
+    doubled: shorthand.double(msg.data),
+    isModuleExports: shorthand.isModuleExports()
+  })
+}
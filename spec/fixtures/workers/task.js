@@ -0,0 +1,9 @@
+// Tells the workers of a pool apart.
+const workerId = Math.random()
+
+self.ontask = function (task) {
+  if (task.error) throw new Error(task.error)
+  const end = Date.now() + (task.busy || 0)
+  while (Date.now() < end) {}
+  return {workerId: workerId, value: task.value * 2}
+}
@@ -0,0 +1,7 @@
+// Sends every ArrayBuffer back, transferred, with what arrived in it.
+self.onmessage = function (msg) {
+  const buffer = msg.data
+  const bytes = Array.from(new Uint8Array(buffer))
+  postMessage({buffer: buffer, bytes: bytes}, [buffer])
+  postMessage({byteLengthAfterTransfer: buffer.byteLength})
+}